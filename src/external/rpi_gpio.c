@@ -14,11 +14,20 @@
  * limitations under the License.
  */
 
+#include <errno.h>
 #include <fcntl.h>
 #include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <unistd.h>
+#if defined(__QNX__)
 #include <sys/neutrino.h>
+#else
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#endif
 #include "external/public/rpi_gpio.h"
 
 // File descriptor to communicate with resource manager
@@ -27,6 +36,86 @@ static int gpio_fd = -1;
 // Mutex protecting the GPIO message file descriptor
 static pthread_mutex_t gpio_fd_mutex;
 
+// Set when the resource manager failed the mask probe on connect, pins are then sent one by one
+static int gpio_mask_unsupported = 0;
+
+// GPIO registers once rpi_gpio_map_registers mapped them. Levels are then read from GPLEV0 and
+// written through GPSET0/GPCLR0 without a message or a lock, those registers only act on the bits
+// written so concurrent writers never undo each other
+uint32_t volatile *rpi_gpio_regs = NULL;
+
+#if !defined(__QNX__)
+// Connect to the mock resource manager, RPI_GPIO_MOCK_PATH in the environment overrides the socket
+static int gpio_socket_connect()
+{
+  const char *path = getenv("RPI_GPIO_MOCK_PATH");
+  struct sockaddr_un addr = {.sun_family = AF_UNIX};
+  strncpy(addr.sun_path, path ? path : RPI_GPIO_MOCK_PATH, sizeof(addr.sun_path) - 1);
+
+  int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+  if (fd == -1)
+  {
+    return -1;
+  }
+
+  if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1)
+  {
+    close(fd);
+    return -1;
+  }
+
+  return fd;
+}
+
+// Stand-in for the kernel call, the mock replies with a status followed by the reply buffer
+static int MsgSend(int coid, const void *smsg, size_t sbytes, void *rmsg, size_t rbytes)
+{
+  if (send(coid, smsg, sbytes, MSG_NOSIGNAL) != (ssize_t)sbytes)
+  {
+    return -1;
+  }
+
+  int status;
+  struct iovec iov[2] = {{&status, sizeof(status)}, {rmsg, rbytes}};
+  struct msghdr reply = {.msg_iov = iov, .msg_iovlen = rbytes ? 2 : 1};
+  if (recvmsg(coid, &reply, 0) < (ssize_t)sizeof(status))
+  {
+    return -1;
+  }
+
+  if (status != 0)
+  {
+    errno = status;
+    return -1;
+  }
+
+  return 0;
+}
+
+// Events need no registration, the mock runs in this process and writes to the descriptor itself
+static int MsgRegisterEvent(struct sigevent *event, int coid)
+{
+  (void)event;
+  (void)coid;
+  return 0;
+}
+#endif
+
+// Read no pins with a mask message. Whatever the manager fails it with, or a reply that does not
+// clear the levels like a mask read does, means it does not know mask messages. Called with the
+// descriptor lock held
+static int gpio_probe_mask()
+{
+  rpi_gpio_msg_t msg = {
+    .hdr.type = _IO_MSG,
+    .hdr.subtype = RPI_GPIO_READ_MASK,
+    .hdr.mgrid = RPI_GPIO_IOMGR,
+    .gpio = 0,
+    .value = ~0u};
+
+  return MsgSend(gpio_fd, &msg, sizeof(msg), &msg, sizeof(msg)) == 0 && msg.value == 0;
+}
+
 // Connect to the GPIO resource manager
 static int gpio_msg_connect()
 {
@@ -36,12 +125,20 @@ static int gpio_msg_connect()
 
   if (gpio_fd == -1)
   {
+#if defined(__QNX__)
     gpio_fd = open("/dev/gpio/msg", O_RDWR);
+#else
+    gpio_fd = gpio_socket_connect();
+#endif
     if (gpio_fd == -1)
     {
       perror("open");
       status = GPIO_ERROR_NOT_CONNECTED;
     }
+    else
+    {
+      gpio_mask_unsupported = !gpio_probe_mask();
+    }
   }
 
   pthread_mutex_unlock(&gpio_fd_mutex);
@@ -103,10 +200,28 @@ static int gpio_msg_register_event(struct sigevent *event)
   return GPIO_SUCCESS;
 }
 
+int rpi_gpio_map_registers()
+{
+  if (!rpi_gpio_map_regs(RPI_4_PERIPHERALS))
+  {
+    perror("mmap");
+    return GPIO_ERROR_NOT_CONNECTED;
+  }
+
+  return GPIO_SUCCESS;
+}
+
 int rpi_gpio_cleanup()
 {
   int status = GPIO_SUCCESS;
 
+  if (!rpi_gpio_unmap_regs())
+  {
+    perror("munmap");
+    status = GPIO_ERROR_CLEANING_UP;
+  }
+  rpi_gpio_regs = NULL;
+
   pthread_mutex_lock(&gpio_fd_mutex);
 
   if (gpio_fd != -1)
@@ -265,6 +380,17 @@ int rpi_gpio_get_setup(int gpio_pin, unsigned *configuration)
 
 int rpi_gpio_output(int gpio_pin, unsigned level)
 {
+  if (rpi_gpio_regs != NULL)
+  {
+    if (gpio_pin < 0 || gpio_pin >= GPIO_COUNT || (level != GPIO_LOW && level != GPIO_HIGH))
+    {
+      return GPIO_ERROR_INPUT_OUT_OF_RANGE;
+    }
+
+    rpi_gpio_write(gpio_pin, level == GPIO_HIGH);
+    return GPIO_SUCCESS;
+  }
+
   // Connect to the GPIO resource manager, if not connected already
   if (gpio_msg_connect())
   {
@@ -310,6 +436,17 @@ int rpi_gpio_output(int gpio_pin, unsigned level)
 
 int rpi_gpio_input(int gpio_pin, unsigned *level)
 {
+  if (rpi_gpio_regs != NULL)
+  {
+    if (gpio_pin < 0 || gpio_pin >= GPIO_COUNT)
+    {
+      return GPIO_ERROR_INPUT_OUT_OF_RANGE;
+    }
+
+    *level = rpi_gpio_read(gpio_pin) ? GPIO_HIGH : GPIO_LOW;
+    return GPIO_SUCCESS;
+  }
+
   // Connect to the GPIO resource manager, if not connected already
   if (gpio_msg_connect())
   {
@@ -354,6 +491,130 @@ int rpi_gpio_input(int gpio_pin, unsigned *level)
   return GPIO_SUCCESS;
 }
 
+int rpi_gpio_output_mask(unsigned gpio_mask, unsigned levels)
+{
+  if (rpi_gpio_regs != NULL)
+  {
+    if (gpio_mask >> GPIO_COUNT)
+    {
+      return GPIO_ERROR_INPUT_OUT_OF_RANGE;
+    }
+
+    // Pins going high first, so switching keypad rows never has two driven low at once
+    rpi_gpio_regs[RPI_GPIO_REG_GPSET0] = levels & gpio_mask;
+    rpi_gpio_regs[RPI_GPIO_REG_GPCLR0] = ~levels & gpio_mask;
+    return GPIO_SUCCESS;
+  }
+
+  // Connect to the GPIO resource manager, if not connected already
+  if (gpio_msg_connect())
+  {
+    perror("gpio_msg_connect");
+    return GPIO_ERROR_NOT_CONNECTED;
+  }
+
+  if (gpio_mask >> GPIO_COUNT)
+  {
+    return GPIO_ERROR_INPUT_OUT_OF_RANGE;
+  }
+
+  // Set every pin in the mask high or low in one message
+  if (!gpio_mask_unsupported)
+  {
+    rpi_gpio_msg_t msg = {
+      .hdr.type = _IO_MSG,
+      .hdr.subtype = RPI_GPIO_WRITE_MASK,
+      .hdr.mgrid = RPI_GPIO_IOMGR,
+      .gpio = gpio_mask,
+      .value = levels & gpio_mask};
+
+    if (gpio_send_msg(&msg, sizeof(msg)) == GPIO_SUCCESS)
+    {
+      return GPIO_SUCCESS;
+    }
+  }
+
+  // Pin by pin when the manager has no mask messages, or this one failed
+
+  for (int gpio_pin = 0; gpio_pin < GPIO_COUNT; gpio_pin++)
+  {
+    if (gpio_mask & (1u << gpio_pin))
+    {
+      int status = rpi_gpio_output(gpio_pin, (levels & (1u << gpio_pin)) ? GPIO_HIGH : GPIO_LOW);
+      if (status != GPIO_SUCCESS)
+      {
+        return status;
+      }
+    }
+  }
+
+  return GPIO_SUCCESS;
+}
+
+int rpi_gpio_input_mask(unsigned gpio_mask, unsigned *levels)
+{
+  if (rpi_gpio_regs != NULL)
+  {
+    if (gpio_mask >> GPIO_COUNT)
+    {
+      return GPIO_ERROR_INPUT_OUT_OF_RANGE;
+    }
+
+    *levels = rpi_gpio_regs[RPI_GPIO_REG_GPLEV0] & gpio_mask;
+    return GPIO_SUCCESS;
+  }
+
+  // Connect to the GPIO resource manager, if not connected already
+  if (gpio_msg_connect())
+  {
+    perror("gpio_msg_connect");
+    return GPIO_ERROR_NOT_CONNECTED;
+  }
+
+  if (gpio_mask >> GPIO_COUNT)
+  {
+    return GPIO_ERROR_INPUT_OUT_OF_RANGE;
+  }
+
+  // Query every pin in the mask in one message
+  if (!gpio_mask_unsupported)
+  {
+    rpi_gpio_msg_t msg = {
+      .hdr.type = _IO_MSG,
+      .hdr.subtype = RPI_GPIO_READ_MASK,
+      .hdr.mgrid = RPI_GPIO_IOMGR,
+      .gpio = gpio_mask};
+
+    if (gpio_send_receive_msg(&msg, sizeof(msg)) == GPIO_SUCCESS)
+    {
+      *levels = msg.value & gpio_mask;
+      return GPIO_SUCCESS;
+    }
+  }
+
+  // Pin by pin when the manager has no mask messages, or this one failed
+
+  *levels = 0;
+  for (int gpio_pin = 0; gpio_pin < GPIO_COUNT; gpio_pin++)
+  {
+    if (gpio_mask & (1u << gpio_pin))
+    {
+      unsigned level;
+      int status = rpi_gpio_input(gpio_pin, &level);
+      if (status != GPIO_SUCCESS)
+      {
+        return status;
+      }
+      if (level == GPIO_HIGH)
+      {
+        *levels |= 1u << gpio_pin;
+      }
+    }
+  }
+
+  return GPIO_SUCCESS;
+}
+
 int rpi_gpio_add_event_detect(int gpio_pin, int coid, unsigned event, unsigned event_id)
 {
   // Connect to the GPIO resource manager, if not connected already
@@ -0,0 +1,357 @@
+#if !defined(__QNX__)
+
+#include "external/rpi_gpio.h"
+#include "external/rpi_gpio_mock.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+
+#define RPI_GPIO_MOCK_MAX_CLIENTS 8
+#define RPI_GPIO_MOCK_MAX_MSG 256
+
+typedef struct {
+  bool output;
+  unsigned pull;
+  bool high;
+  bool level;
+  // Where a column is heading and since when, it reads the old level until it has settled
+  bool target;
+  long target_us;
+  unsigned detect;
+  int event_fd;
+  int event_id;
+} rpi_gpio_mock_pin_t;
+
+static pthread_mutex_t g_mutex = PTHREAD_MUTEX_INITIALIZER;
+static rpi_gpio_mock_pin_t g_pins[GPIO_COUNT];
+static int g_rows[4] = {-1, -1, -1, -1};
+static int g_cols[4] = {-1, -1, -1, -1};
+static bool g_keys[16];
+static long g_fall_us;
+static long g_rise_us;
+static rpi_gpio_mock_stats_t g_stats;
+static bool g_ready;
+
+static pthread_t g_server;
+static int g_listen_fd = -1;
+static int g_stop_fds[2] = {-1, -1};
+static char g_path[sizeof(((struct sockaddr_un*)0)->sun_path)];
+
+static void* serve(void* args);
+static int handle_msg(void* buffer, size_t size);
+static void init_pins(void);
+static long get_us(void);
+static bool input_level(int pin);
+static void settle_pin(rpi_gpio_mock_pin_t* pin, long now_us);
+static void update_levels(void);
+
+int rpi_gpio_mock_start(const char* path) {
+  if (g_listen_fd != -1) {
+    return -1;
+  }
+
+  struct sockaddr_un addr = {.sun_family = AF_UNIX};
+  snprintf(g_path, sizeof(g_path), "%s", path ? path : RPI_GPIO_MOCK_PATH);
+  memcpy(addr.sun_path, g_path, sizeof(addr.sun_path));
+  unlink(g_path);
+
+  g_listen_fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+  if (g_listen_fd == -1 || bind(g_listen_fd, (struct sockaddr*)&addr, sizeof(addr)) == -1 ||
+      listen(g_listen_fd, RPI_GPIO_MOCK_MAX_CLIENTS) == -1 || pipe(g_stop_fds) == -1) {
+    perror("rpi_gpio_mock_start");
+    rpi_gpio_mock_stop();
+    return -1;
+  }
+
+  pthread_mutex_lock(&g_mutex);
+  init_pins();
+  pthread_mutex_unlock(&g_mutex);
+
+  if (pthread_create(&g_server, NULL, serve, NULL) != 0) {
+    close(g_stop_fds[1]);
+    g_stop_fds[1] = -1;
+    rpi_gpio_mock_stop();
+    return -1;
+  }
+
+  return 0;
+}
+
+void rpi_gpio_mock_stop(void) {
+  if (g_stop_fds[1] != -1) {
+    char stop = 0;
+    if (write(g_stop_fds[1], &stop, 1) == 1) {
+      pthread_join(g_server, NULL);
+    }
+  }
+
+  for (int i = 0; i < 2; ++i) {
+    if (g_stop_fds[i] != -1) {
+      close(g_stop_fds[i]);
+    }
+    g_stop_fds[i] = -1;
+  }
+  if (g_listen_fd != -1) {
+    close(g_listen_fd);
+    unlink(g_path);
+  }
+  g_listen_fd = -1;
+}
+
+void rpi_gpio_mock_wire(const int rows[4], const int cols[4]) {
+  pthread_mutex_lock(&g_mutex);
+  init_pins();
+  memcpy(g_rows, rows, sizeof(g_rows));
+  memcpy(g_cols, cols, sizeof(g_cols));
+  update_levels();
+  pthread_mutex_unlock(&g_mutex);
+}
+
+void rpi_gpio_mock_set_key(int key, bool down) {
+  if (key < 0 || key >= 16) {
+    return;
+  }
+
+  pthread_mutex_lock(&g_mutex);
+  init_pins();
+  g_keys[key] = down;
+  update_levels();
+  pthread_mutex_unlock(&g_mutex);
+}
+
+void rpi_gpio_mock_set_rc(long fall_us, long rise_us) {
+  pthread_mutex_lock(&g_mutex);
+  g_fall_us = fall_us > 0 ? fall_us : 0;
+  g_rise_us = rise_us > 0 ? rise_us : 0;
+  pthread_mutex_unlock(&g_mutex);
+}
+
+void rpi_gpio_mock_get_stats(rpi_gpio_mock_stats_t* stats) {
+  if (!stats) {
+    return;
+  }
+
+  pthread_mutex_lock(&g_mutex);
+  *stats = g_stats;
+  pthread_mutex_unlock(&g_mutex);
+}
+
+static void* serve(void* args) {
+  (void)args;
+
+  // Slot 0 stops the server, slot 1 takes new connections and the rest are clients
+  struct pollfd fds[RPI_GPIO_MOCK_MAX_CLIENTS + 2];
+  fds[0] = (struct pollfd){.fd = g_stop_fds[0], .events = POLLIN};
+  fds[1] = (struct pollfd){.fd = g_listen_fd, .events = POLLIN};
+  int count = 2;
+
+  while (true) {
+    if (poll(fds, count, -1) == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+
+    if (fds[0].revents) {
+      break;
+    }
+
+    if ((fds[1].revents & POLLIN) && count < RPI_GPIO_MOCK_MAX_CLIENTS + 2) {
+      int fd = accept(g_listen_fd, NULL, NULL);
+      if (fd != -1) {
+        fds[count++] = (struct pollfd){.fd = fd, .events = POLLIN};
+      }
+    }
+
+    for (int i = 2; i < count; ++i) {
+      if (!fds[i].revents) {
+        continue;
+      }
+
+      uint8_t buffer[RPI_GPIO_MOCK_MAX_MSG];
+      ssize_t size = recv(fds[i].fd, buffer, sizeof(buffer), 0);
+      if (size <= 0) {
+        close(fds[i].fd);
+        fds[i--] = fds[--count];
+        continue;
+      }
+
+      // Replied like MsgReply or MsgError, a status and then the message as changed
+      int status = handle_msg(buffer, size);
+      struct iovec iov[2] = {{&status, sizeof(status)}, {buffer, size}};
+      struct msghdr reply = {.msg_iov = iov, .msg_iovlen = 2};
+      sendmsg(fds[i].fd, &reply, MSG_NOSIGNAL);
+    }
+  }
+
+  for (int i = 2; i < count; ++i) {
+    close(fds[i].fd);
+  }
+  return NULL;
+}
+
+static int handle_msg(void* buffer, size_t size) {
+  if (size < sizeof(rpi_gpio_msg_t)) {
+    return EINVAL;
+  }
+
+  rpi_gpio_msg_t* msg = buffer;
+  if (msg->hdr.type != _IO_MSG || msg->hdr.mgrid != RPI_GPIO_IOMGR) {
+    return ENOSYS;
+  }
+
+  bool mask = msg->hdr.subtype == RPI_GPIO_READ_MASK || msg->hdr.subtype == RPI_GPIO_WRITE_MASK;
+  if (mask ? msg->gpio >> GPIO_COUNT != 0 : msg->gpio >= GPIO_COUNT) {
+    return EINVAL;
+  }
+
+  int status = 0;
+  pthread_mutex_lock(&g_mutex);
+  g_stats.messages++;
+  rpi_gpio_mock_pin_t* pin = mask ? NULL : &g_pins[msg->gpio];
+  long now_us = get_us();
+
+  switch (msg->hdr.subtype) {
+    case RPI_GPIO_SET_SELECT:
+      pin->output = msg->value == RPI_GPIO_FUNC_OUT;
+      update_levels();
+      break;
+    case RPI_GPIO_GET_SELECT:
+      msg->value = pin->output ? RPI_GPIO_FUNC_OUT : RPI_GPIO_FUNC_IN;
+      break;
+    case RPI_GPIO_PUD:
+      pin->pull = msg->value;
+      update_levels();
+      break;
+    case RPI_GPIO_WRITE:
+      pin->high = msg->value != 0;
+      update_levels();
+      break;
+    case RPI_GPIO_READ:
+      settle_pin(pin, now_us);
+      msg->value = pin->level;
+      break;
+    case RPI_GPIO_WRITE_MASK:
+      for (int i = 0; i < GPIO_COUNT; ++i) {
+        if (msg->gpio & (1u << i)) {
+          g_pins[i].high = (msg->value >> i) & 1;
+        }
+      }
+      update_levels();
+      break;
+    case RPI_GPIO_READ_MASK:
+      msg->value = 0;
+      for (int i = 0; i < GPIO_COUNT; ++i) {
+        if (msg->gpio & (1u << i)) {
+          settle_pin(&g_pins[i], now_us);
+          msg->value |= (unsigned)g_pins[i].level << i;
+        }
+      }
+      break;
+    case RPI_GPIO_ADD_EVENT: {
+      // Only edges are simulated, a level event would fire on every update
+      rpi_gpio_event_t* event = buffer;
+      if (size < sizeof(*event)) {
+        status = EINVAL;
+        break;
+      }
+      pin->detect = event->detect & (RPI_EVENT_EDGE_RISING | RPI_EVENT_EDGE_FALLING);
+      pin->event_fd = event->event.sigev_signo;
+      pin->event_id = event->event.sigev_value.sival_int;
+      break;
+    }
+    case RPI_GPIO_PWM_SETUP:
+    case RPI_GPIO_PWM_DUTY:
+      break;
+    default:
+      status = ENOSYS;
+      break;
+  }
+
+  pthread_mutex_unlock(&g_mutex);
+  return status;
+}
+
+static void init_pins(void) {
+  if (g_ready) {
+    return;
+  }
+
+  for (int i = 0; i < GPIO_COUNT; ++i) {
+    memset(&g_pins[i], 0, sizeof(g_pins[i]));
+    g_pins[i].pull = RPI_GPIO_PUD_OFF;
+    g_pins[i].event_fd = -1;
+  }
+  g_ready = true;
+}
+
+static bool input_level(int pin) {
+  for (int c = 0; c < 4; ++c) {
+    if (g_cols[c] != pin) {
+      continue;
+    }
+
+    for (int r = 0; r < 4; ++r) {
+      int row = g_rows[r];
+      if (row >= 0 && g_keys[c * 4 + r] && g_pins[row].output && !g_pins[row].high) {
+        return false;
+      }
+    }
+  }
+
+  return g_pins[pin].pull == RPI_GPIO_PUD_UP;
+}
+
+static long get_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void settle_pin(rpi_gpio_mock_pin_t* pin, long now_us) {
+  long delay_us = pin->target ? g_rise_us : g_fall_us;
+  if (pin->level != pin->target && now_us - pin->target_us >= delay_us) {
+    pin->level = pin->target;
+  }
+}
+
+static void update_levels(void) {
+  long now_us = get_us();
+  for (int i = 0; i < GPIO_COUNT; ++i) {
+    rpi_gpio_mock_pin_t* pin = &g_pins[i];
+    settle_pin(pin, now_us);
+
+    // Outputs switch at once, inputs charge through the matrix like an RC and settle later
+    bool level = pin->output ? pin->high : input_level(i);
+    if (level == pin->target) {
+      continue;
+    }
+
+    pin->target = level;
+    pin->target_us = now_us;
+    if (pin->output) {
+      pin->level = level;
+    }
+    settle_pin(pin, now_us);
+
+    unsigned edge = level ? RPI_EVENT_EDGE_RISING : RPI_EVENT_EDGE_FALLING;
+    if ((pin->detect & edge) && pin->event_fd >= 0) {
+      // Dropped like a pulse nobody receives if the reader fell behind
+      ssize_t rc = write(pin->event_fd, &pin->event_id, sizeof(pin->event_id));
+      (void)rc;
+      g_stats.events++;
+    }
+  }
+}
+
+#endif // !__QNX__
@@ -189,6 +189,32 @@ int rpi_gpio_output(int gpio_pin, unsigned level);
  */
 int rpi_gpio_input(int gpio_pin, unsigned *level);
 
+/**
+ * Turn several GPIO PINs on/off in one message
+ *
+ * @param    gpio_mask  GPIO pins as bits, bit n for GPIO n
+ * @param    levels     bit set for high, clear for low, for each pin in gpio_mask
+ *
+ * @returns  GPIO_SUCCESS                  on success
+ *           GPIO_ERROR_NOT_CONNECTED      if the GPIO resource manager not available to connect to
+ *           GPIO_ERROR_MSG_NOT_SENT       if command message is not sent to the GPIO resource manager
+ *           GPIO_ERROR_INPUT_OUT_OF_RANGE invalid pin in gpio_mask
+ */
+int rpi_gpio_output_mask(unsigned gpio_mask, unsigned levels);
+
+/**
+ * Read the levels of several GPIO PINs in one message
+ *
+ * @param    gpio_mask  GPIO pins as bits, bit n for GPIO n
+ * @param    levels     bit set for high, clear for low, for each pin in gpio_mask (output)
+ *
+ * @returns  GPIO_SUCCESS                  on success
+ *           GPIO_ERROR_NOT_CONNECTED      if the GPIO resource manager not available to connect to
+ *           GPIO_ERROR_MSG_NOT_SENT       if command message is not sent to the GPIO resource manager
+ *           GPIO_ERROR_INPUT_OUT_OF_RANGE invalid pin in gpio_mask
+ */
+int rpi_gpio_input_mask(unsigned gpio_mask, unsigned *levels);
+
 /**
  * Report on a GPIO event asynchronously
  *
@@ -205,12 +231,26 @@ int rpi_gpio_input(int gpio_pin, unsigned *level);
  */
 int rpi_gpio_add_event_detect(int gpio_pin, int coid, unsigned event, unsigned event_id);
 
+/**
+ * Map the GPIO registers and access them directly from now on
+ *
+ * rpi_gpio_input, rpi_gpio_output and the mask calls then read GPLEV0 and write GPSET0/GPCLR0
+ * without a message or a lock, everything else still goes to the GPIO resource manager. Call it
+ * before other threads use the API. Off the target an anonymous mapping stands in for the
+ * registers, it only holds what is written to it.
+ *
+ * @returns  GPIO_SUCCESS                  on success
+ *           GPIO_ERROR_NOT_CONNECTED      if the registers cannot be mapped
+ */
+int rpi_gpio_map_registers();
+
 /**
  * Cleanup GPIO API resources
  *
  * @returns  GPIO_SUCCESS                  on success
  *           GPIO_ERROR_NOT_CONNECTED      if resource manager not available to connect to
  *           GPIO_ERROR_CLEANING_UP        if there is a failure disconnecting from the resource manager
+ *                                         or unmapping the registers
  */
 int rpi_gpio_cleanup();
 
@@ -0,0 +1,31 @@
+#ifndef RPI_GPIO_MOCK_H_
+#define RPI_GPIO_MOCK_H_
+
+#include <stdbool.h>
+
+// Linux stand-in for the GPIO resource manager. rpi_gpio_mock_start serves the rpi_gpio messages
+// on a Unix socket, the path the client connects to unless RPI_GPIO_MOCK_PATH in the environment
+// says otherwise, so every rpi_gpio call costs a send and a reply like MsgSend does on QNX.
+//
+// It simulates a 4x4 key matrix: key k connects row k % 4 to column k / 4, the same order the
+// keypad reads it, and a pulled up column reads low while a row driven low has a key down on it.
+// Columns take fall_us to be pulled low and rise_us to recover, like the RC of a real matrix, so a
+// short settle misreads.
+//
+// Edge events registered with rpi_gpio_add_event_detect are delivered like the pulses on QNX,
+// except that the connection is a file descriptor the event id is written to as an int. The
+// server runs in the client process so the descriptor is valid on both ends.
+
+typedef struct {
+  unsigned long messages;
+  unsigned long events;
+} rpi_gpio_mock_stats_t;
+
+int rpi_gpio_mock_start(const char* path);
+void rpi_gpio_mock_stop(void);
+void rpi_gpio_mock_wire(const int rows[4], const int cols[4]);
+void rpi_gpio_mock_set_key(int key, bool down);
+void rpi_gpio_mock_set_rc(long fall_us, long rise_us);
+void rpi_gpio_mock_get_stats(rpi_gpio_mock_stats_t* stats);
+
+#endif // !RPI_GPIO_MOCK_H_
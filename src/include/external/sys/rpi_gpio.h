@@ -23,8 +23,58 @@
 #ifndef RPI_GPIO_H
 #define RPI_GPIO_H
 
+#if defined(__QNX__)
 #include <sys/iomsg.h>
 #include <sys/iomgr.h>
+#else
+/*
+ * Off the target the client talks to the mock resource manager over a Unix
+ * socket. Only what the messages need is defined, the values just have to
+ * match between the client and the mock. The mock runs in the client process,
+ * so an event carries the connection as a file descriptor the value is
+ * written to instead of a pulse.
+ */
+#include <stdint.h>
+#include <signal.h>
+
+struct _io_msg
+{
+    uint16_t type;
+    uint16_t combine_len;
+    uint16_t mgrid;
+    uint16_t subtype;
+};
+
+#define _IO_MSG                 0x0106
+#define _IOMGR_PRIVATE_BASE     0xf000
+#define _PULSE_CODE_MINAVAIL    0
+
+#define RPI_GPIO_MOCK_PATH      "/tmp/rpi_gpio_mock.sock"
+
+#define SIGEV_PULSE_INIT(__e, __f, __p, __c, __v) \
+    ((__e)->sigev_notify = SIGEV_NONE, (__e)->sigev_signo = (__f), \
+     (__e)->sigev_value.sival_int = (__v))
+
+/* Lets the register helpers build, a mapping is anonymous memory standing in for the block */
+#include <sys/mman.h>
+#include <time.h>
+
+#define __PAGESIZE              4096
+#define PROT_NOCACHE            0
+#define MAP_PHYS                MAP_ANONYMOUS
+#define NOFD                    (-1)
+
+static inline void
+nanospin_ns(unsigned long ns)
+{
+    struct timespec start, now;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    do {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+    } while ((now.tv_sec - start.tv_sec) * 1000000000L + (now.tv_nsec - start.tv_nsec) <
+             (long)ns);
+}
+#endif
 #include "external/aarch64/rpi_gpio.h"
 
 #define RPI_GPIO_IOMGR  (_IOMGR_PRIVATE_BASE + 35)
@@ -56,6 +106,10 @@ enum
     RPI_GPIO_SPI_INIT,
     /** Write/read data to/from the SPI interface. */
     RPI_GPIO_SPI_WRITE_READ,
+    /** Read the levels of several GPIO PINs */
+    RPI_GPIO_READ_MASK,
+    /** Turn several GPIO PINs on/off */
+    RPI_GPIO_WRITE_MASK,
 };
 
 /**
@@ -89,6 +143,8 @@ enum
  * RPI_GPIO_SET: Ignored
  * RPI_GPIO_CLEAR: Ignored
  * RPI_GPIO_LEVEL: [out] PIN state
+ * RPI_GPIO_READ_MASK: gpio is a mask of PINs, [out] their levels as bits
+ * RPI_GPIO_WRITE_MASK: gpio is a mask of PINs, [in] their levels as bits
  */
 typedef struct
 {
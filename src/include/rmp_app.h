@@ -2,18 +2,31 @@
 #define RMP_APP_H_
 
 #include "rmp_vec2.h"
+#include "rmp_grid.h"
+#include "rmp_sched.h"
+#include "rmp_input.h"
 
+#include <stdio.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
 #include <pthread.h>
+#include <time.h>
 
 #define SCREEN_WIDTH_P(a) ((a)->SCREEN_END.x - (a)->SCREEN_START.x)
 #define SCREEN_WIDTH(a) ((a).SCREEN_END.x - (a).SCREEN_START.x)
 #define SCREEN_HEIGHT_P(a) ((a)->SCREEN_END.y - (a)->SCREEN_START.y)
 #define SCREEN_HEIGHT(a) ((a).SCREEN_END.y - (a).SCREEN_START.y)
 
+#define RMP_APP_SNAPSHOT_MAX_BALLS 1024
+
+// FNV-1a offset basis, where rmp_app_hash_bytes chains start
+#define RMP_APP_HASH_SEED 0xcbf29ce484222325ull
+
 typedef enum {
   RMP_APP_OK,
-  RMP_APP_BAD_ARGS
+  RMP_APP_BAD_ARGS,
+  RMP_APP_BAD_INIT
 } rmp_appRet_e;
 
 typedef struct {
@@ -22,8 +35,61 @@ typedef struct {
   rmp_vec2_t size;
 } rmp_app_entity_t;
 
+// Extra balls for multi-ball mode, one array per component
+typedef struct {
+  int count;
+  int capacity;
+  float size;
+
+  float* x;
+  float* y;
+  float* vx;
+  float* vy;
+} rmp_app_balls_t;
+
 typedef struct {
-  bool running;
+  unsigned long steps;
+  unsigned long wakeups;
+  unsigned long overruns;
+  unsigned long catchup_steps;
+  unsigned long dropped_steps;
+  time_t jitter_max_us;
+  time_t jitter_total_us;
+  // Input events applied by the sim and how long they waited in the queue
+  unsigned long input_events;
+  time_t input_latency_total_us;
+  time_t input_latency_max_us;
+} rmp_app_stats_t;
+
+// Compact copy of everything the renderer needs, published by the sim thread after each step
+typedef struct {
+  unsigned long generation;
+  time_t step_time_us;
+
+  bool paused;
+  bool recalibrating;
+  bool ai_is_playing;
+
+  rmp_vec2_t SCREEN_START;
+  rmp_vec2_t SCREEN_END;
+
+  rmp_app_entity_t pad_a;
+  rmp_app_entity_t pad_b;
+  rmp_app_entity_t ball;
+
+  rmp_app_entity_t prev_pad_a;
+  rmp_app_entity_t prev_pad_b;
+  rmp_app_entity_t prev_ball;
+
+  // Multi-ball positions, capped so the snapshot stays cheap to copy
+  int ball_count;
+  float ball_size;
+  float ball_x[RMP_APP_SNAPSHOT_MAX_BALLS];
+  float ball_y[RMP_APP_SNAPSHOT_MAX_BALLS];
+} rmp_app_snapshot_t;
+
+typedef struct {
+  atomic_bool running;
   bool paused;
   bool recalibrating;
   bool ai_is_playing;
@@ -31,23 +97,99 @@ typedef struct {
   pthread_mutex_t mutex;
   pthread_cond_t cond;
 
+  // Idle governor, loops block on wake while paused or recalibrating instead of polling
+  pthread_cond_t wake;
+  bool governor;
+  bool idle;
+
   rmp_vec2_t SCREEN_START;
   rmp_vec2_t SCREEN_END;
 
   int pad_speed;
   int pad_padding;
+  // Keys down as of the last event applied, bit n for key n. Pad velocity follows from them
+  unsigned keys_held;
   rmp_vec2_t pad_size;
   rmp_app_entity_t pad_a;
   rmp_app_entity_t pad_b;
 
   int ball_size;
   rmp_app_entity_t ball;
+
+  rmp_app_balls_t balls;
+  rmp_grid_t grid;
+
+  unsigned long tick;
+  int score_a;
+  int score_b;
+  uint32_t rng_state;
+
+  // Input recording, see rmp_record.h
+  FILE* record_file;
+  unsigned long record_tick;
+
+  // AI intercept for the current ball trajectory, dropped whenever the ball or field changes
+  bool ai_intercept_valid;
+  float ai_intercept_y;
+
+  // State before the last step and when it was due, used to interpolate renders
+  rmp_app_entity_t prev_pad_a;
+  rmp_app_entity_t prev_pad_b;
+  rmp_app_entity_t prev_ball;
+  time_t step_time_us;
+  time_t next_step_us;
+
+  rmp_app_stats_t stats;
+  rmp_sched_probe_t probe;
+
+  // Wake-ups of every component loop and quit time, to compare the threaded and reactor modes
+  atomic_ulong loop_wakeups;
+  time_t start_us;
+  time_t quit_us;
+
+  // Time from the last keypad scan being due to its keys being dispatched, -1 before the first
+  atomic_long input_latency_us;
+
+  // Keypad events on their way to the sim, which applies them at the start of each step
+  rmp_input_t input;
+  // Keys from the screen's own keyboard. Their own queue keeps one producer per queue, the sim only
+  // sleeps on input and a push here wakes it through that one
+  rmp_input_t keyboard_input;
+
+  // Seqlock guarding snapshot, odd while the sim thread is writing it
+  atomic_uint snapshot_seq;
+  rmp_app_snapshot_t snapshot;
 } rmp_app_t;
 
 rmp_appRet_e rmp_app_init(rmp_app_t* app);
 rmp_appRet_e rmp_app_free(rmp_app_t* app);
 void* rmp_app_run(void* args);
+time_t rmp_app_tick(rmp_app_t* app, time_t now_us);
+void rmp_app_quit(rmp_app_t* app);
+void rmp_app_step(rmp_app_t* app);
+void rmp_app_seed(rmp_app_t* app, uint32_t seed);
+void rmp_app_handle_event(rmp_app_t* app, uint8_t event);
+bool rmp_app_post_event(rmp_app_t* app, uint8_t event);
+bool rmp_app_post_keyboard_event(rmp_app_t* app, uint8_t event);
+void rmp_app_notify(rmp_app_t* app);
+bool rmp_app_is_idle(rmp_app_t* app);
+void rmp_app_wait_for_change(rmp_app_t* app, unsigned long generation);
+uint64_t rmp_app_hash_state(const rmp_app_t* app);
+// FNV-1a over size bytes, continuing from hash
+uint64_t rmp_app_hash_bytes(uint64_t hash, const void* data, size_t size);
+rmp_appRet_e rmp_app_spawn_balls(rmp_app_t* app, int count);
+void rmp_app_clear_balls(rmp_app_t* app);
 void rmp_app_log_entity(const char* name, rmp_app_entity_t entity);
 void rmp_app_recalibrate(rmp_app_t* app);
+// Centre height at which the ball reaches pad B, folded off the walls. False, with the ball's
+// current centre, when it is moving away or the flight cannot be followed. Never cached
+bool rmp_app_predict_intercept(const rmp_app_t* app, float* intercept_y);
+void rmp_app_invalidate_prediction(rmp_app_t* app);
+bool rmp_app_is_running(rmp_app_t* app);
+void rmp_app_read_snapshot(rmp_app_t* app, rmp_app_snapshot_t* dst);
+double rmp_app_get_alpha(const rmp_app_snapshot_t* snapshot, time_t now_us);
+void rmp_app_lerp_entity(rmp_app_entity_t* dst, rmp_app_entity_t prev, rmp_app_entity_t cur,
+                         double alpha);
+void rmp_app_log_stats(const rmp_app_t* app);
 
 #endif // !RMP_APP_H_
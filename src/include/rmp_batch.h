@@ -0,0 +1,65 @@
+#ifndef RMP_BATCH_H_
+#define RMP_BATCH_H_
+
+#include "rmp_app.h"
+
+#include <stdint.h>
+
+typedef enum {
+  RMP_BATCH_OK,
+  RMP_BATCH_BAD_ARGS,
+  RMP_BATCH_BAD_INIT
+} rmp_batchRet_e;
+
+// Field and rules every match in a batch plays with. Plain values only, each worker sets them on
+// its own scratch app
+typedef struct {
+  rmp_vec2_t screen_start;
+  rmp_vec2_t screen_end;
+  rmp_vec2_t pad_size;
+  int pad_padding;
+  int pad_speed;
+  int ball_size;
+  // Every serve leaves the centre at a random speed along x in this range, the AI misses fast ones
+  double serve_speed_min;
+  double serve_speed_max;
+  // Speed of the ball follower playing pad A, as a fraction of pad_speed
+  double opponent_speed;
+} rmp_batch_params_t;
+
+// Independent headless matches, one array per field so workers stream through them
+typedef struct {
+  int count;
+  uint32_t seed;
+  rmp_batch_params_t params;
+
+  double* pad_a_y;
+  double* pad_b_y;
+  double* ball_x;
+  double* ball_y;
+  double* ball_vx;
+  double* ball_vy;
+  uint32_t* rng_state;
+  int* score_a;
+  int* score_b;
+} rmp_batch_t;
+
+typedef struct {
+  long score_a;
+  long score_b;
+  // Matches each side finished ahead in, and level ones
+  int wins_a;
+  int wins_b;
+  int draws;
+  uint64_t checksum;
+} rmp_batch_result_t;
+
+// The field and sizes of an initialized app, serving at its ball speed up to four times that
+rmp_batchRet_e rmp_batch_params_from_app(rmp_batch_params_t* params, const rmp_app_t* app);
+rmp_batchRet_e rmp_batch_init(rmp_batch_t* batch, const rmp_batch_params_t* params, int count,
+                              uint32_t seed);
+rmp_batchRet_e rmp_batch_free(rmp_batch_t* batch);
+rmp_batchRet_e rmp_batch_run(rmp_batch_t* batch, int steps, int threads);
+void rmp_batch_summarize(const rmp_batch_t* batch, rmp_batch_result_t* result);
+
+#endif // !RMP_BATCH_H_
@@ -0,0 +1,88 @@
+#ifndef RMP_CAPTURE_H_
+#define RMP_CAPTURE_H_
+
+#include "rmp_fb.h"
+#include "rmp_cmd.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+#define RMP_CAPTURE_MAX_SLOTS 32
+#define RMP_CAPTURE_MAX_RECTS 64
+
+typedef enum {
+  RMP_CAPTURE_OK,
+  RMP_CAPTURE_BAD_ARGS,
+  RMP_CAPTURE_BAD_INIT
+} rmp_captureRet_e;
+
+// PPM takes a printf pattern for the frame number, e.g. frames/%06lu.ppm. Y4M is a single 4:4:4
+// stream that repeats the last frame over vblanks nothing was posted in. DELTA is a single stream
+// of the spans that changed against the previous frame, see tools/capture_decode.c
+typedef enum {
+  RMP_CAPTURE_PPM,
+  RMP_CAPTURE_Y4M,
+  RMP_CAPTURE_DELTA
+} rmp_capture_format_e;
+
+// The rects of a frame that changed since the previous one, their pixels packed one after another
+typedef struct {
+  rmp_rect_t rects[RMP_CAPTURE_MAX_RECTS];
+  int rect_count;
+  uint32_t* pixels;
+  unsigned long frame;
+} rmp_capture_slot_t;
+
+typedef struct {
+  unsigned long captured;
+  unsigned long dropped;
+  unsigned long written;
+  unsigned long long bytes;
+} rmp_capture_stats_t;
+
+// Frames are copied into a preallocated ring by the render thread and written out by a background
+// thread. Only what changed is copied, the writer keeps the whole image. A full ring drops the
+// frame and the next one is copied whole, pushing never waits on the writer
+typedef struct {
+  rmp_capture_format_e format;
+  const char* path;
+  int width;
+  int height;
+  int refresh_hz;
+
+  rmp_capture_slot_t slots[RMP_CAPTURE_MAX_SLOTS];
+  int slot_count;
+  atomic_ulong head;
+  atomic_ulong tail;
+  sem_t ready;
+  atomic_bool stopping;
+  pthread_t writer;
+  bool running;
+  bool resync;
+
+  // Writer side only
+  FILE* file;
+  uint32_t* image;
+  uint8_t* scratch;
+  unsigned long last_frame;
+  bool has_prev;
+
+  rmp_capture_stats_t stats;
+} rmp_capture_t;
+
+rmp_captureRet_e rmp_capture_init(rmp_capture_t* capture, const char* path, int width, int height,
+                                  int refresh_hz, int slots);
+rmp_captureRet_e rmp_capture_free(rmp_capture_t* capture);
+
+// Copies the damaged rects of frame into a free slot, NULL damage copies the whole frame. Returns
+// false when the ring is full, the frame is dropped and the next push is a whole one again
+bool rmp_capture_push(rmp_capture_t* capture, const rmp_fb_t* frame, const rmp_rect_t* damage,
+                      int count, unsigned long number);
+int rmp_capture_pending(rmp_capture_t* capture);
+void rmp_capture_log_stats(const rmp_capture_t* capture);
+
+#endif // !RMP_CAPTURE_H_
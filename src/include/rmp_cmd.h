@@ -0,0 +1,69 @@
+#ifndef RMP_CMD_H_
+#define RMP_CMD_H_
+
+#include <stdint.h>
+
+// Limits of the packed sort keys
+#define RMP_CMD_MAX_LAYERS 16
+#define RMP_CMD_MAX_SIZE 16384
+
+typedef enum {
+  RMP_CMD_OK,
+  RMP_CMD_BAD_ARGS,
+  RMP_CMD_BAD_INIT
+} rmp_cmdRet_e;
+
+typedef struct {
+  int x;
+  int y;
+  int width;
+  int height;
+} rmp_rect_t;
+
+// Solid fill of a rect, or a copy into it from src rows src_stride pixels apart when src is set,
+// both in the pixel format of the target. Layers are painted in order, commands inside one layer
+// must either not overlap or share a color, so the list is free to reorder and merge them
+typedef struct {
+  rmp_rect_t rect;
+  uint32_t color;
+  uint16_t layer;
+  const void* src;
+  int src_stride;
+} rmp_cmd_t;
+
+typedef struct {
+  unsigned long long pushed;
+  unsigned long long submitted;
+} rmp_cmd_stats_t;
+
+// Preallocated per-frame command buffer clipped to a width x height target of pixel_bytes per
+// pixel. by_top and active are scratch
+// for backends walking the list scanline by scanline, see rmp_cmd_list_finish
+typedef struct {
+  rmp_cmd_t* cmds;
+  int count;
+  int capacity;
+  int width;
+  int height;
+  int pixel_bytes;
+
+  int* by_top;
+  rmp_cmd_t* active;
+
+  // Sort scratch
+  uint64_t* keys;
+  uint64_t* keys_spare;
+  rmp_cmd_t* cmds_spare;
+
+  rmp_cmd_stats_t stats;
+} rmp_cmd_list_t;
+
+rmp_cmdRet_e rmp_cmd_list_init(rmp_cmd_list_t* list, int capacity);
+rmp_cmdRet_e rmp_cmd_list_free(rmp_cmd_list_t* list);
+void rmp_cmd_list_reset(rmp_cmd_list_t* list, int width, int height, int pixel_bytes);
+unsigned long rmp_cmd_fill(rmp_cmd_list_t* list, int layer, rmp_rect_t rect, uint32_t color);
+unsigned long rmp_cmd_blit(rmp_cmd_list_t* list, int layer, rmp_rect_t rect, const void* src,
+                           int src_stride);
+void rmp_cmd_list_finish(rmp_cmd_list_t* list);
+
+#endif // !RMP_CMD_H_
@@ -1,5 +1,65 @@
 #ifndef RMP_CONFIG_H_
+#define RMP_CONFIG_H_
 
 #define RMP_USE_KEYBOARD 0
 
+#define RMP_CONFIG_MULTIBALL_COUNT 256
+
+// Size of the software framebuffer used when there is no QNX Screen to draw on
+#define RMP_CONFIG_FB_WIDTH 1920
+#define RMP_CONFIG_FB_HEIGHT 1080
+#define RMP_CONFIG_FB_REFRESH_HZ 60
+
+// Share of the window area the software framebuffer draws, 1 for all of it, 2 for half or 4 for
+// a quarter. The frame is scaled back up to the window on present
+#define RMP_CONFIG_FB_RENDER_SCALE 1
+
+// Threads the software framebuffer draws a frame on, tiles are shared out when it covers enough
+// pixels
+#define RMP_CONFIG_FB_RENDER_THREADS 1
+
+// Pixel format drawn in, RMP_FB_RGBA8888 or RMP_FB_RGB565 for half the memory traffic
+#define RMP_CONFIG_PIXEL_FORMAT RMP_FB_RGBA8888
+
+// Buffers the screen renders into, 2 for the least latency or 3 to ride out a slow frame
+#define RMP_CONFIG_SWAPCHAIN_BUFFERS 3
+
+// Where the display reports vsync, the screen wakes this long before the one it expects and blocks
+// on it, so a late wake-up costs the margin rather than a frame
+#define RMP_CONFIG_SCREEN_VSYNC_MARGIN_US 2000
+
+// Frames the capture ring holds before the writer falling behind drops them
+#define RMP_CONFIG_CAPTURE_SLOTS 8
+
+// Time a keypad row is given to settle before its columns are read, per board. Run the app with
+// -k and a key held down to find the shortest stable one
+#define RMP_CONFIG_KEYPAD_SETTLE_US 50
+
+// With no key down the keypad holds its rows low and sleeps until a column falls instead of
+// scanning at 60 Hz, 0 keeps it scanning. Only the threaded keypad waits, the reactor scans
+#define RMP_CONFIG_KEYPAD_EDGE_WAIT 1
+
+// The keypad reads and writes the mapped GPIO registers instead of sending a message per access.
+// Needs the rights to map physical memory, 1 is the same as running with -G
+#define RMP_CONFIG_KEYPAD_GPIO_REGS 0
+
+// Input events the sim can fall behind by before the producer drops them, a power of two. The sim
+// drains them once a step, and a step's worth of key changes from 16 keys is far below this. Both
+// queues live inline in rmp_app_t, so this also keeps the app small enough for a thread stack
+#define RMP_CONFIG_INPUT_QUEUE_SIZE 256
+
+// Scheduling used with -P fifo|rr. Core 0 is left to the rest of the system and input gets the
+// highest priority since its work per wakeup is the shortest
+#define RMP_CONFIG_SCHED_APP_PRIORITY 20
+#define RMP_CONFIG_SCHED_APP_CPU 1
+#define RMP_CONFIG_SCHED_APP_NICE -5
+
+#define RMP_CONFIG_SCHED_KEYPAD_PRIORITY 30
+#define RMP_CONFIG_SCHED_KEYPAD_CPU 2
+#define RMP_CONFIG_SCHED_KEYPAD_NICE -10
+
+#define RMP_CONFIG_SCHED_SCREEN_PRIORITY 25
+#define RMP_CONFIG_SCHED_SCREEN_CPU 3
+#define RMP_CONFIG_SCHED_SCREEN_NICE -10
+
 #endif // !RMP_CONFIG_H_
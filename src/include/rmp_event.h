@@ -0,0 +1,45 @@
+#ifndef RMP_EVENT_H_
+#define RMP_EVENT_H_
+
+// Input events are a key index with the RMP_KEYDOWN bit set on press
+
+#define RMP_KEYDOWN    0x10
+#define RMP_KEYUP      0x00
+
+#define RMP_KEY0       0x00
+#define RMP_KEY1       0x01
+#define RMP_KEY2       0x02
+#define RMP_KEY3       0x03
+#define RMP_KEY4       0x04
+#define RMP_KEY5       0x05
+#define RMP_KEY6       0x06
+#define RMP_KEY7       0x07
+#define RMP_KEY8       0x08
+#define RMP_KEY9       0x09
+#define RMP_KEYA       0x0a
+#define RMP_KEYB       0x0b
+#define RMP_KEYC       0x0c
+#define RMP_KEYD       0x0d
+#define RMP_KEYE       0x0e
+#define RMP_KEYF       0x0f
+
+#define RMP_EVENT_QUIT             RMP_KEY3
+#define RMP_EVENT_PLAY_PAUSE       RMP_KEYC
+#define RMP_EVENT_PAD_A_UP         RMP_KEY0
+#define RMP_EVENT_PAD_A_DOWN       RMP_KEY4
+#define RMP_EVENT_PAD_B_UP         RMP_KEYB
+#define RMP_EVENT_PAD_B_DOWN       RMP_KEYF
+#define RMP_EVENT_TOGGLE_AI        RMP_KEYD
+#define RMP_EVENT_TOGGLE_MULTIBALL RMP_KEYA
+
+#define RMP_EVENT_TOGGLE_RECAL     RMP_KEYE
+#define RMP_EVENT_RECAL_TL_LEFT    RMP_KEY0
+#define RMP_EVENT_RECAL_TL_DOWN    RMP_KEY1
+#define RMP_EVENT_RECAL_TL_UP      RMP_KEY2
+#define RMP_EVENT_RECAL_TL_RIGHT   RMP_KEY3
+#define RMP_EVENT_RECAL_BR_LEFT    RMP_KEY4
+#define RMP_EVENT_RECAL_BR_DOWN    RMP_KEY5
+#define RMP_EVENT_RECAL_BR_UP      RMP_KEY6
+#define RMP_EVENT_RECAL_BR_RIGHT   RMP_KEY7
+
+#endif // !RMP_EVENT_H_
@@ -0,0 +1,66 @@
+#ifndef RMP_FB_H_
+#define RMP_FB_H_
+
+#include "rmp_cmd.h"
+
+#include <stdint.h>
+
+// Rows start on a cache line so span fills never split one between two rows
+#define RMP_FB_ROW_ALIGN 64
+
+typedef enum {
+  RMP_FB_OK,
+  RMP_FB_BAD_ARGS,
+  RMP_FB_BAD_INIT
+} rmp_fbRet_e;
+
+// RGBA8888 pixels are packed 0xAARRGGBB like QNX Screen colors, RGB565 halves the bytes written
+// and scanned out at the cost of color depth
+typedef enum {
+  RMP_FB_RGBA8888,
+  RMP_FB_RGB565
+} rmp_fb_format_e;
+
+// Framebuffer in memory, stride is in pixels
+typedef struct {
+  void* pixels;
+  int width;
+  int height;
+  int stride;
+  rmp_fb_format_e format;
+} rmp_fb_t;
+
+rmp_fbRet_e rmp_fb_init(rmp_fb_t* fb, int width, int height, rmp_fb_format_e format);
+rmp_fbRet_e rmp_fb_free(rmp_fb_t* fb);
+
+// Colors below are pixel values of the buffer's format, converted once with rmp_fb_pack
+void rmp_fb_clear(rmp_fb_t* fb, uint32_t color);
+void rmp_fb_fill_rect(rmp_fb_t* fb, int x, int y, int width, int height, uint32_t color);
+void rmp_fb_fill_span(uint32_t* dst, int count, uint32_t color);
+void rmp_fb_fill_span16(uint16_t* dst, int count, uint16_t color);
+
+// Conversions between 0xAARRGGBB colors and pixel values of a format
+uint32_t rmp_fb_pack(rmp_fb_format_e format, uint32_t argb);
+uint32_t rmp_fb_unpack(rmp_fb_format_e format, uint32_t pixel);
+int rmp_fb_bytes_per_pixel(rmp_fb_format_e format);
+const char* rmp_fb_format_name(rmp_fb_format_e format);
+rmp_fbRet_e rmp_fb_parse_format(const char* name, rmp_fb_format_e* format);
+
+// Copies count pixels from row y starting at x into dst as 0xAARRGGBB
+void rmp_fb_read_row(const rmp_fb_t* fb, int x, int y, int count, uint32_t* dst);
+
+// Executes a finished command list, see rmp_cmd_list_finish. Rects must lie inside the buffer
+void rmp_fb_draw(rmp_fb_t* fb, const rmp_cmd_list_t* list);
+
+// Executes one command of a finished list, only the part of it inside clip
+void rmp_fb_draw_cmd(rmp_fb_t* fb, const rmp_cmd_t* cmd, rmp_rect_t clip);
+
+// Nearest neighbour copy of rect of src into dst scaled by scale_x and scale_y, both in one format
+void rmp_fb_upscale(rmp_fb_t* dst, const rmp_fb_t* src, rmp_rect_t rect, int scale_x, int scale_y);
+
+// Hashes the pixels as 0xAARRGGBB, so a frame hashes the same whatever it was stored as
+uint64_t rmp_fb_hash(const rmp_fb_t* fb);
+rmp_fbRet_e rmp_fb_write_ppm(const rmp_fb_t* fb, const char* path);
+const char* rmp_fb_simd_name(void);
+
+#endif // !RMP_FB_H_
@@ -0,0 +1,32 @@
+#ifndef RMP_GRID_H_
+#define RMP_GRID_H_
+
+#include "rmp_vec2.h"
+
+typedef enum {
+  RMP_GRID_OK,
+  RMP_GRID_BAD_ARGS,
+  RMP_GRID_BAD_INIT
+} rmp_gridRet_e;
+
+// Uniform grid over the field, rebuilt every step with a counting sort of the items by cell
+typedef struct {
+  rmp_vec2_t origin;
+  double cell_size;
+  int cols;
+  int rows;
+
+  int capacity;
+  int* cell_start;
+  int* cell_count;
+  int* items;
+  int* item_cell;
+} rmp_grid_t;
+
+rmp_gridRet_e rmp_grid_init(rmp_grid_t* grid, rmp_vec2_t start, rmp_vec2_t end, double cell_size,
+                            int capacity);
+rmp_gridRet_e rmp_grid_free(rmp_grid_t* grid);
+rmp_gridRet_e rmp_grid_build(rmp_grid_t* grid, const float* x, const float* y, int count);
+int rmp_grid_cell(const rmp_grid_t* grid, double x, double y);
+
+#endif // !RMP_GRID_H_
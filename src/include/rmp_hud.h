@@ -0,0 +1,73 @@
+#ifndef RMP_HUD_H_
+#define RMP_HUD_H_
+
+#include "rmp_fb.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+// Characters on the overlay line and the glyph cell, a 5x7 glyph plus spacing scaled up
+#define RMP_HUD_MAX_CHARS 40
+#define RMP_HUD_SCALE 2
+#define RMP_HUD_CELL_WIDTH (6 * RMP_HUD_SCALE)
+#define RMP_HUD_CELL_HEIGHT (9 * RMP_HUD_SCALE)
+
+// Render times kept for the percentile and how often the text is refreshed
+#define RMP_HUD_SAMPLES 256
+#define RMP_HUD_UPDATE_US 500000
+
+typedef enum {
+  RMP_HUD_OK,
+  RMP_HUD_BAD_ARGS,
+  RMP_HUD_BAD_INIT
+} rmp_hudRet_e;
+
+typedef struct {
+  unsigned long updates;
+  time_t update_total_us;
+} rmp_hud_stats_t;
+
+// Performance overlay. The glyphs are rasterized once into an atlas of opaque cells side by side,
+// in the pixel format of the target, a line of text is then a row of atlas cells the renderer
+// copies as they are
+typedef struct {
+  void* atlas;
+  int atlas_stride;
+  rmp_fb_format_e format;
+
+  // Text and the atlas cell of each of its characters
+  char text[RMP_HUD_MAX_CHARS + 1];
+  int glyphs[RMP_HUD_MAX_CHARS];
+  int length;
+
+  // Render times of the last frames, a ring
+  time_t samples[RMP_HUD_SAMPLES];
+  int sample_count;
+  int sample_next;
+
+  // Current measuring window
+  time_t window_start_us;
+  unsigned long window_frames;
+  unsigned long window_generation;
+
+  rmp_hud_stats_t stats;
+} rmp_hud_t;
+
+rmp_hudRet_e rmp_hud_init(rmp_hud_t* hud, rmp_fb_format_e format);
+rmp_hudRet_e rmp_hud_free(rmp_hud_t* hud);
+
+// Accounts a rendered frame and the time it took
+void rmp_hud_record_frame(rmp_hud_t* hud, time_t render_us);
+
+// Refreshes the text once per RMP_HUD_UPDATE_US, returns true when it changed. generation counts
+// sim steps and input_latency_us is negative while unknown
+bool rmp_hud_update(rmp_hud_t* hud, time_t now_us, unsigned long generation,
+                    long input_latency_us);
+
+// Atlas cell of text[index], RMP_HUD_CELL_WIDTH x RMP_HUD_CELL_HEIGHT with atlas_stride
+const void* rmp_hud_glyph(const rmp_hud_t* hud, int index);
+
+void rmp_hud_log_stats(const rmp_hud_t* hud);
+
+#endif // !RMP_HUD_H_
@@ -0,0 +1,56 @@
+#ifndef RMP_INPUT_H_
+#define RMP_INPUT_H_
+
+#include "rmp_config.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <semaphore.h>
+#include <time.h>
+
+#define RMP_INPUT_CACHE_LINE 64
+
+typedef enum {
+  RMP_INPUT_OK,
+  RMP_INPUT_BAD_ARGS,
+  RMP_INPUT_BAD_INIT
+} rmp_inputRet_e;
+
+// An rmp_event.h key event and when it was pushed
+typedef struct {
+  time_t time_us;
+  uint8_t event;
+} rmp_input_event_t;
+
+// Single producer, single consumer ring of input events. The producer never waits: a full ring
+// drops the event. A consumer with nothing else to do can sleep until the next push or a wake.
+// The head and tail counters each have a cache line, so the two threads do not share one
+typedef struct {
+  _Alignas(RMP_INPUT_CACHE_LINE) atomic_ulong head;
+  unsigned long pushed;
+  unsigned long dropped;
+
+  _Alignas(RMP_INPUT_CACHE_LINE) atomic_ulong tail;
+  atomic_bool sleeping;
+  sem_t ready;
+
+  rmp_input_event_t events[RMP_CONFIG_INPUT_QUEUE_SIZE];
+} rmp_input_t;
+
+rmp_inputRet_e rmp_input_init(rmp_input_t* input);
+rmp_inputRet_e rmp_input_free(rmp_input_t* input);
+// Producer side
+bool rmp_input_push(rmp_input_t* input, uint8_t event, time_t time_us);
+// Consumer side
+bool rmp_input_pop(rmp_input_t* input, rmp_input_event_t* event);
+bool rmp_input_is_empty(rmp_input_t* input);
+// The consumer announces it is about to sleep, then checks whatever else could wake it and
+// either waits or cancels. A push or rmp_input_wake in between is not lost
+void rmp_input_prepare_wait(rmp_input_t* input);
+void rmp_input_wait(rmp_input_t* input);
+void rmp_input_cancel_wait(rmp_input_t* input);
+// Any thread, ends a wait for another reason than a push
+void rmp_input_wake(rmp_input_t* input);
+
+#endif // !RMP_INPUT_H_
@@ -3,21 +3,72 @@
 
 #include "rmp_app.h"
 
+#include <stdbool.h>
+
 typedef enum {
   RMP_KEYPAD_OK,
   RMP_KEYPAD_BAD_ARGS,
   RMP_KEYPAD_BAD_INIT
 } rmp_keypadRet_e;
 
+typedef struct {
+  unsigned long scans;
+  time_t scan_total_us;
+  time_t scan_max_us;
+  // From the scan being due, or the edge that woke it, to a key down reaching the game
+  unsigned long keydowns;
+  time_t keydown_total_us;
+  time_t keydown_max_us;
+  unsigned long edge_waits;
+  unsigned long edge_wakes;
+} rmp_keypad_stats_t;
+
 typedef struct {
   int keys[16];
   int row_pins[4];
   int col_pins[4];
+  // The same pins as GPIO bits, a row or all columns are then read or written in one message
+  unsigned row_mask;
+  unsigned col_mask;
+
+  // Scan in progress. Rows settle for settle_us each, short settles are spun through in one step
+  // and longer ones take a step per row so the caller never blocks on them
+  time_t settle_us;
+  int scan_row;
+  unsigned scan_cols;
+  int scan_keys[16];
+  time_t scan_due_us;
+  time_t scan_start_us;
+  time_t next_scan_us;
+  rmp_sched_probe_t probe;
+
+  // Idle mode of rmp_keypad_run: with no key down all rows are held low and the thread blocks
+  // until a column falls, then scans only the columns that did
+  bool edge_wait;
+  bool edge_armed;
+#if defined(__QNX__)
+  int chid;
+  int coid;
+#else
+  int event_fds[2];
+#endif
+  rmp_keypad_stats_t stats;
 
   rmp_app_t* app;
 } rmp_keypad_t;
 
 rmp_keypadRet_e rmp_keypad_init(rmp_keypad_t* keypad, rmp_app_t* app);
+rmp_keypadRet_e rmp_keypad_free(rmp_keypad_t* keypad);
+rmp_keypadRet_e rmp_keypad_set_settle(rmp_keypad_t* keypad, time_t settle_us);
+// Self-test, with a key held down finds the shortest settle that scans it the same every time
+rmp_keypadRet_e rmp_keypad_calibrate(rmp_keypad_t* keypad, time_t* settle_us);
+rmp_keypadRet_e rmp_keypad_set_edge_wait(rmp_keypad_t* keypad, bool enabled);
+// Scans through the mapped GPIO registers instead of messages to the resource manager, for the
+// whole process and before the keypad thread starts
+rmp_keypadRet_e rmp_keypad_map_gpio(rmp_keypad_t* keypad);
+void rmp_keypad_wake(rmp_keypad_t* keypad);
+void rmp_keypad_log_stats(const rmp_keypad_t* keypad);
 void* rmp_keypad_run(void* args);
+time_t rmp_keypad_step(rmp_keypad_t* keypad, time_t now_us);
 
 #endif // !RMP_KEYPAD_H_
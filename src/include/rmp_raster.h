@@ -0,0 +1,68 @@
+#ifndef RMP_RASTER_H_
+#define RMP_RASTER_H_
+
+#include "rmp_fb.h"
+#include "rmp_cmd.h"
+
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+// A 64x64 tile is 16 KiB of RGBA8888 and stays in L1 while every command over it is drawn
+#define RMP_RASTER_TILE 64
+#define RMP_RASTER_MAX_THREADS 8
+
+// Frames covering fewer pixels than this are drawn on the calling thread alone, waking the pool
+// costs more than it saves on a few small damaged rects
+#define RMP_RASTER_MIN_PARALLEL_PIXELS (16 * RMP_RASTER_TILE * RMP_RASTER_TILE)
+
+typedef enum {
+  RMP_RASTER_OK,
+  RMP_RASTER_BAD_ARGS,
+  RMP_RASTER_BAD_INIT
+} rmp_rasterRet_e;
+
+typedef struct {
+  unsigned long parallel_frames;
+  unsigned long single_frames;
+  unsigned long long tiles;
+} rmp_raster_stats_t;
+
+// Tile-parallel executor of finished command lists. Each list is binned by the tiles its commands
+// touch, keeping list order inside a bin, and the tiles are handed out to a persistent pool of
+// workers plus the calling thread. Draw returns once every tile is done
+typedef struct {
+  int thread_count;
+  pthread_t workers[RMP_RASTER_MAX_THREADS - 1];
+  pthread_mutex_t mutex;
+  pthread_cond_t start;
+  pthread_cond_t done;
+  unsigned long job;
+  int busy;
+  bool stopping;
+
+  // Bins, the commands of tile t are items[first[t]] up to items[first[t + 1]]
+  int tiles_x;
+  int tiles_y;
+  int* first;
+  int* items;
+  int item_capacity;
+  int* queue;
+  int queue_count;
+  atomic_int next;
+
+  // Frame being drawn
+  rmp_fb_t* fb;
+  const rmp_cmd_list_t* list;
+
+  rmp_raster_stats_t stats;
+} rmp_raster_t;
+
+// Tiles for a width x height buffer, threads counts the calling thread
+rmp_rasterRet_e rmp_raster_init(rmp_raster_t* raster, int width, int height, int threads);
+rmp_rasterRet_e rmp_raster_free(rmp_raster_t* raster);
+
+// Same result as rmp_fb_draw, on the pool when the list covers enough pixels
+void rmp_raster_draw(rmp_raster_t* raster, rmp_fb_t* fb, const rmp_cmd_list_t* list);
+
+#endif // !RMP_RASTER_H_
@@ -0,0 +1,57 @@
+#ifndef RMP_REACTOR_H_
+#define RMP_REACTOR_H_
+
+#include "rmp_app.h"
+#include "rmp_sched.h"
+
+#include <time.h>
+
+#define RMP_REACTOR_MAX_SOURCES 8
+
+typedef enum {
+  RMP_REACTOR_OK,
+  RMP_REACTOR_BAD_ARGS,
+  RMP_REACTOR_BAD_INIT
+} rmp_reactorRet_e;
+
+// Runs one unit of work for a component and returns the absolute time (us) it wants to run next,
+// RMP_TIME_NEVER parks the source until rmp_reactor_kick
+typedef time_t (*rmp_reactor_fn)(void* ctx, time_t now_us);
+
+typedef struct {
+  rmp_reactor_fn fn;
+  void* ctx;
+  time_t deadline;
+  rmp_sched_probe_t* probe;
+#if defined(__QNX__)
+  timer_t timer;
+#else
+  int timer_fd;
+#endif
+} rmp_reactor_source_t;
+
+// Multiplexes component deadlines on the calling thread: timer pulses on a private channel on
+// QNX, timerfds and an eventfd under epoll on Linux
+typedef struct {
+  rmp_app_t* app;
+  int count;
+  rmp_reactor_source_t sources[RMP_REACTOR_MAX_SOURCES];
+
+#if defined(__QNX__)
+  int chid;
+  int coid;
+#else
+  int epoll_fd;
+  int wake_fd;
+#endif
+} rmp_reactor_t;
+
+rmp_reactorRet_e rmp_reactor_init(rmp_reactor_t* reactor, rmp_app_t* app);
+rmp_reactorRet_e rmp_reactor_free(rmp_reactor_t* reactor);
+rmp_reactorRet_e rmp_reactor_add(rmp_reactor_t* reactor, rmp_reactor_fn fn, void* ctx,
+                                 rmp_sched_probe_t* probe);
+rmp_reactorRet_e rmp_reactor_run(rmp_reactor_t* reactor);
+void rmp_reactor_wake(rmp_reactor_t* reactor);
+void rmp_reactor_kick(rmp_reactor_t* reactor);
+
+#endif // !RMP_REACTOR_H_
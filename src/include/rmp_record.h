@@ -0,0 +1,33 @@
+#ifndef RMP_RECORD_H_
+#define RMP_RECORD_H_
+
+#include "rmp_app.h"
+
+#include <stdint.h>
+
+// File layout: header with the RNG seed and initial game state, then one record per input event
+// made of the varint tick delta since the previous record and the event byte. A final record
+// with RMP_RECORD_END marks the last simulated tick.
+
+#define RMP_RECORD_MAGIC   "RMPR"
+#define RMP_RECORD_VERSION 1
+#define RMP_RECORD_END     0xff
+
+typedef enum {
+  RMP_RECORD_OK,
+  RMP_RECORD_BAD_ARGS,
+  RMP_RECORD_BAD_FILE,
+  RMP_RECORD_BAD_FORMAT
+} rmp_recordRet_e;
+
+typedef struct {
+  unsigned long events;
+  unsigned long ticks;
+} rmp_record_stats_t;
+
+rmp_recordRet_e rmp_record_start(rmp_app_t* app, const char* path);
+rmp_recordRet_e rmp_record_event(rmp_app_t* app, uint8_t event);
+rmp_recordRet_e rmp_record_stop(rmp_app_t* app);
+rmp_recordRet_e rmp_record_replay(rmp_app_t* app, const char* path, rmp_record_stats_t* stats);
+
+#endif // !RMP_RECORD_H_
@@ -0,0 +1,66 @@
+#ifndef RMP_RENDER_H_
+#define RMP_RENDER_H_
+
+#include "rmp_app.h"
+#include "rmp_cmd.h"
+#include "rmp_fb.h"
+#include "rmp_raster.h"
+#include "rmp_swapchain.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+typedef enum {
+  RMP_RENDER_OK,
+  RMP_RENDER_BAD_ARGS,
+  RMP_RENDER_BAD_INIT
+} rmp_renderRet_e;
+
+typedef struct rmp_render_s rmp_render_t;
+
+// Drawing backend under the screen. A frame selects one of the buffers, submits its finished
+// command list in one call, then presents. Present gets the rects that changed since the previous
+// present, a count of 0 means the whole window. view maps a buffer for reading on the CPU, or
+// returns false where it cannot. width and height are the size of the buffers drawn into, each
+// of their pixels covers scale_x by scale_y pixels of the window. Command colors and blits are in
+// the buffers' format. A backend whose platform owns the buffers sets acquire, which returns the
+// buffer the platform hands back for the next frame or -1, and wait_vsync, which blocks until the
+// display's next vsync and returns when it was or -1
+struct rmp_render_s {
+  const char* name;
+  int width;
+  int height;
+  int scale_x;
+  int scale_y;
+  rmp_fb_format_e format;
+  int buffer_count;
+  int refresh_hz;
+  void* impl;
+
+  int (*acquire)(rmp_render_t* render);
+  time_t (*wait_vsync)(rmp_render_t* render);
+  void (*select)(rmp_render_t* render, int buffer);
+  void (*submit)(rmp_render_t* render, const rmp_cmd_list_t* list);
+  void (*present)(rmp_render_t* render, const rmp_rect_t* damage, int count);
+  bool (*view)(rmp_render_t* render, int buffer, rmp_fb_t* view);
+  void (*poll)(rmp_render_t* render, rmp_app_t* app);
+  void (*free)(rmp_render_t* render);
+};
+
+#if defined(__QNX__)
+rmp_renderRet_e rmp_render_qnx_init(rmp_render_t* render, int buffers, rmp_fb_format_e format);
+#endif // __QNX__
+
+// Software rasterizer into in-memory framebuffers, present does not leave the process and vblank
+// is simulated at refresh_hz. scale divides the area drawn into, 1, 2 or 4, and present scales it
+// back up to a width x height window. rmp_render_fb_get returns what the window shows
+rmp_renderRet_e rmp_render_fb_init(rmp_render_t* render, int width, int height, int buffers,
+                                   int refresh_hz, int scale, rmp_fb_format_e format);
+rmp_fb_t* rmp_render_fb_get(rmp_render_t* render);
+
+// Draws on threads threads from now on, see rmp_raster_t. Stats are NULL while single threaded
+rmp_renderRet_e rmp_render_fb_set_threads(rmp_render_t* render, int threads);
+const rmp_raster_stats_t* rmp_render_fb_raster_stats(rmp_render_t* render);
+
+#endif // !RMP_RENDER_H_
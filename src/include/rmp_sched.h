@@ -0,0 +1,53 @@
+#ifndef RMP_SCHED_H_
+#define RMP_SCHED_H_
+
+#include <pthread.h>
+#include <time.h>
+
+#define RMP_SCHED_PROBE_BUCKETS 16
+
+typedef enum {
+  RMP_SCHED_OK,
+  RMP_SCHED_BAD_ARGS,
+  RMP_SCHED_BAD_INIT
+} rmp_schedRet_e;
+
+typedef enum {
+  RMP_SCHED_POLICY_NONE,
+  RMP_SCHED_POLICY_FIFO,
+  RMP_SCHED_POLICY_RR
+} rmp_sched_policy_e;
+
+// Scheduling of a single component thread, cpu -1 leaves the thread unpinned and nice is only
+// used when the real-time policy is refused
+typedef struct {
+  const char* name;
+  int priority;
+  int cpu;
+  int nice;
+} rmp_sched_thread_t;
+
+typedef struct {
+  rmp_sched_policy_e policy;
+  rmp_sched_thread_t app;
+  rmp_sched_thread_t keypad;
+  rmp_sched_thread_t screen;
+} rmp_sched_profile_t;
+
+// Wake-up lateness of a periodic thread, bucket i counts wakeups in [2^(i-1), 2^i) us late
+typedef struct {
+  unsigned long wakeups;
+  time_t late_total_us;
+  time_t late_max_us;
+  unsigned long buckets[RMP_SCHED_PROBE_BUCKETS];
+} rmp_sched_probe_t;
+
+rmp_schedRet_e rmp_sched_profile_init(rmp_sched_profile_t* profile, const char* policy);
+rmp_schedRet_e rmp_sched_apply(rmp_sched_policy_e policy, const rmp_sched_thread_t* thread);
+rmp_schedRet_e rmp_sched_spawn(pthread_t* tid, rmp_sched_policy_e policy,
+                               const rmp_sched_thread_t* thread, void* (*fn)(void*), void* arg);
+
+void rmp_sched_probe_record(rmp_sched_probe_t* probe, time_t deadline_us, time_t now_us);
+void rmp_sched_probe_log(const char* author, const rmp_sched_probe_t* probe);
+
+#endif // !RMP_SCHED_H_
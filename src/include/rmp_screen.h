@@ -2,8 +2,9 @@
 #define RMP_SCREEN_H_
 
 #include "rmp_app.h"
-
-#include <screen/screen.h>
+#include "rmp_render.h"
+#include "rmp_capture.h"
+#include "rmp_hud.h"
 
 typedef enum {
   RMP_SCREEN_OK,
@@ -11,17 +12,96 @@ typedef enum {
   RMP_SCREEN_BAD_INIT
 } rmp_screenRet_e;
 
+// Pads, ball, calibration markers, every multi-ball and the overlay glyphs
+#define RMP_SCREEN_MAX_ITEMS (5 + RMP_APP_SNAPSHOT_MAX_BALLS + RMP_HUD_MAX_CHARS)
+#define RMP_SCREEN_MAX_DAMAGE (2 * RMP_SCREEN_MAX_ITEMS)
+
+// Solid rect, or a copy of image rows when image is set
+typedef struct {
+  rmp_rect_t rect;
+  uint32_t color;
+  int layer;
+  const void* image;
+} rmp_screen_item_t;
+
+// What a swapchain buffer holds, compared against the next frame drawn into it to find the damage
+typedef struct {
+  rmp_screen_item_t items[RMP_SCREEN_MAX_ITEMS];
+  int count;
+  int width;
+  int height;
+  bool recalibrating;
+} rmp_screen_frame_t;
+
+// Colors packed into the pixel format of the render target once at init
+typedef struct {
+  uint32_t background;
+  uint32_t pad;
+  uint32_t ai_pad;
+  uint32_t ball;
+  uint32_t marker;
+} rmp_screen_palette_t;
+
+// Window to render target transform, target = offset + window * factor on each axis
+typedef struct {
+  double offset_x;
+  double offset_y;
+  double factor_x;
+  double factor_y;
+} rmp_screen_map_t;
+
+typedef struct {
+  unsigned long frames;
+  unsigned long rendered;
+  unsigned long full_frames;
+  unsigned long long pixels_total;
+  unsigned long pixels_max;
+} rmp_screen_stats_t;
+
 typedef struct {
-  screen_context_t ctx;
-  screen_window_t win;
-  screen_buffer_t buf;
-  screen_event_t event;
+  rmp_render_t render;
+  rmp_swapchain_t swapchain;
+  time_t next_frame_us;
+
+  rmp_screen_item_t items[RMP_SCREEN_MAX_ITEMS];
+  rmp_screen_map_t map;
+  rmp_screen_palette_t palette;
+  rmp_screen_frame_t drawn[RMP_SWAPCHAIN_MAX_BUFFERS];
+  int front;
+  bool damage_tracking;
+
+  // Generation of the last snapshot drawn and whether its interpolation had finished
+  unsigned long generation;
+  bool settled;
+  bool idle;
+
+  // Damage against the buffer drawn into, and the rects changed since the previous frame
+  rmp_rect_t damage[RMP_SCREEN_MAX_DAMAGE];
+  int damage_count;
+  rmp_rect_t changed[RMP_SCREEN_MAX_DAMAGE];
+  unsigned long frame_pixels;
+  rmp_cmd_list_t commands;
+
+  rmp_screen_stats_t stats;
+  rmp_sched_probe_t probe;
+
+  // Optional, every presented frame is pushed here
+  rmp_capture_t* capture;
+
+  // Optional performance overlay drawn over the game
+  rmp_hud_t* hud;
 
   rmp_app_t* app;
 } rmp_screen_t;
 
-rmp_screenRet_e rmp_screen_init(rmp_screen_t* screen, rmp_app_t* app);
+// render_scale divides the area drawn into, see rmp_render_fb_init. format is the pixel format of
+// the buffers drawn into
+rmp_screenRet_e rmp_screen_init(rmp_screen_t* screen, rmp_app_t* app, int render_scale,
+                                rmp_fb_format_e format);
 rmp_screenRet_e rmp_screen_free(rmp_screen_t* screen);
 void* rmp_screen_run(void* args);
+time_t rmp_screen_step(rmp_screen_t* screen, time_t now_us);
+void rmp_screen_render(rmp_screen_t* screen, time_t now_us);
+void rmp_screen_log_stats(const rmp_screen_t* screen);
 
 #endif // !RMP_SCREEN_H_
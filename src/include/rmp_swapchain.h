@@ -0,0 +1,56 @@
+#ifndef RMP_SWAPCHAIN_H_
+#define RMP_SWAPCHAIN_H_
+
+#include <stdbool.h>
+#include <time.h>
+
+#define RMP_SWAPCHAIN_MAX_BUFFERS 3
+
+typedef enum {
+  RMP_SWAPCHAIN_OK,
+  RMP_SWAPCHAIN_BAD_ARGS,
+  RMP_SWAPCHAIN_BAD_INIT
+} rmp_swapchainRet_e;
+
+typedef enum {
+  RMP_SWAPCHAIN_FREE,
+  RMP_SWAPCHAIN_ACQUIRED,
+  RMP_SWAPCHAIN_QUEUED,
+  RMP_SWAPCHAIN_DISPLAYED
+} rmp_swapchain_state_e;
+
+typedef struct {
+  unsigned long presented;
+  unsigned long dropped;
+  unsigned long late;
+} rmp_swapchain_stats_t;
+
+// Buffer rotation paced by a vblank clock. A presented buffer is scanned out at the next vblank and
+// stays on screen until another one replaces it, only then can it be rendered into again.
+// An external swapchain does not decide that: the platform hands back the buffers it is done with
+// through rmp_swapchain_adopt, and its vsyncs move the clock through rmp_swapchain_vsync
+typedef struct {
+  int count;
+  bool external;
+  rmp_swapchain_state_e state[RMP_SWAPCHAIN_MAX_BUFFERS];
+  int queued;
+  int displayed;
+
+  time_t period_us;
+  time_t next_vblank_us;
+  time_t target_us;
+
+  rmp_swapchain_stats_t stats;
+} rmp_swapchain_t;
+
+rmp_swapchainRet_e rmp_swapchain_init(rmp_swapchain_t* swapchain, int count, int refresh_hz,
+                                      time_t now_us);
+time_t rmp_swapchain_vblank(rmp_swapchain_t* swapchain, time_t now_us);
+time_t rmp_swapchain_vsync(rmp_swapchain_t* swapchain, time_t vsync_us);
+time_t rmp_swapchain_resume(rmp_swapchain_t* swapchain, time_t now_us);
+int rmp_swapchain_acquire(rmp_swapchain_t* swapchain);
+int rmp_swapchain_adopt(rmp_swapchain_t* swapchain, int buffer);
+void rmp_swapchain_present(rmp_swapchain_t* swapchain, int buffer, time_t now_us);
+void rmp_swapchain_log_stats(const rmp_swapchain_t* swapchain);
+
+#endif // !RMP_SWAPCHAIN_H_
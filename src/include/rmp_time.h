@@ -4,7 +4,15 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <time.h>
+#include <stdint.h>
+
+// Deadline for a loop that has nothing scheduled and waits to be woken instead
+#define RMP_TIME_NEVER ((time_t)INT64_MAX)
 
 time_t rmp_time_get_us(void);
+void rmp_time_sleep_until_us(time_t deadline_us);
+
+// Busy-waits instead of sleeping, for waits shorter than a scheduler wakeup
+void rmp_time_spin_until_us(time_t deadline_us);
 
 #endif // !RMP_TIME_H_
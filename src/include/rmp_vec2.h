@@ -1,17 +1,72 @@
 #ifndef RMP_VEC2_H_
 #define RMP_VEC2_H_
 
+#include <math.h>
+
 typedef struct {
   double x, y;
 } rmp_vec2_t;
 
-void rmp_vec2_set(rmp_vec2_t* vec, double x, double y);
-void rmp_vec2_add(rmp_vec2_t* dst, rmp_vec2_t vec1, rmp_vec2_t vec2);
-void rmp_vec2_sub(rmp_vec2_t* dst, rmp_vec2_t vec1, rmp_vec2_t vec2);
-void rmp_vec2_scale(rmp_vec2_t* dst, rmp_vec2_t vec, double s);
-double rmp_vec2_dot(rmp_vec2_t a, rmp_vec2_t b);
-double rmp_vec2_len(rmp_vec2_t vec);
-void rmp_vec2_normalize(rmp_vec2_t* dst, rmp_vec2_t vec);
-void rmp_vec2_clamp(rmp_vec2_t* dst, rmp_vec2_t vec, rmp_vec2_t min, rmp_vec2_t max);
+// Single vector operations are inline, they sit on every hot path of the simulation
+
+static inline void rmp_vec2_set(rmp_vec2_t* vec, double x, double y) {
+  if (!vec) return;
+  vec->x = x;
+  vec->y = y;
+}
+
+static inline void rmp_vec2_add(rmp_vec2_t* dst, rmp_vec2_t vec1, rmp_vec2_t vec2) {
+  if (!dst) return;
+  dst->x = vec1.x + vec2.x;
+  dst->y = vec1.y + vec2.y;
+}
+
+static inline void rmp_vec2_sub(rmp_vec2_t* dst, rmp_vec2_t vec1, rmp_vec2_t vec2) {
+  if (!dst) return;
+  dst->x = vec1.x - vec2.x;
+  dst->y = vec1.y - vec2.y;
+}
+
+static inline void rmp_vec2_scale(rmp_vec2_t* dst, rmp_vec2_t vec, double s) {
+  if (!dst) return;
+  dst->x = vec.x * s;
+  dst->y = vec.y * s;
+}
+
+static inline double rmp_vec2_dot(rmp_vec2_t a, rmp_vec2_t b) {
+  return a.x * b.x + a.y * b.y;
+}
+
+static inline double rmp_vec2_len(rmp_vec2_t vec) {
+  return sqrt(vec.x * vec.x + vec.y * vec.y);
+}
+
+static inline void rmp_vec2_normalize(rmp_vec2_t* dst, rmp_vec2_t vec) {
+  if (!dst) return;
+  double len = sqrt(vec.x * vec.x + vec.y * vec.y);
+  if (len > 1e-12) {
+    dst->x = vec.x / len;
+    dst->y = vec.y / len;
+  } else {
+    dst->x = 0.0;
+    dst->y = 0.0;
+  }
+}
+
+static inline void rmp_vec2_clamp(rmp_vec2_t* dst, rmp_vec2_t vec, rmp_vec2_t min, rmp_vec2_t max) {
+  if (!dst) return;
+  double x = (vec.x < max.x) ? vec.x : max.x;
+  double y = (vec.y < max.y) ? vec.y : max.y;
+  dst->x = (min.x > x) ? min.x : x;
+  dst->y = (min.y > y) ? min.y : y;
+}
+
+// Batch kernels over x/y component arrays, dst may alias the inputs
+
+const char* rmp_vec2_simd_name(void);
+void rmp_vec2_add_n(float* dst_x, float* dst_y, const float* x1, const float* y1,
+                    const float* x2, const float* y2, int n);
+void rmp_vec2_clamp_n(float* dst_x, float* dst_y, const float* x, const float* y,
+                      rmp_vec2_t min, rmp_vec2_t max, int n);
 
 #endif // !RMP_VEC2_H_
@@ -2,39 +2,107 @@
 #include "rmp_keypad.h"
 #include "rmp_screen.h"
 #include "rmp_log.h"
+#include "rmp_record.h"
+#include "rmp_time.h"
+#include "rmp_reactor.h"
+#include "rmp_sched.h"
+#include "rmp_capture.h"
+#include "rmp_hud.h"
+#include "rmp_config.h"
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdbool.h>
+#include <signal.h>
 #include <unistd.h>
+#include <sys/resource.h>
 
-int main(void) {
-  rmp_log_info("main", "===> Initializing components\n");
-  rmp_app_t app;
-  rmp_app_init(&app);
+static rmp_app_t* g_app;
+static rmp_reactor_t* g_reactor;
 
-  rmp_keypad_t keypad;
-  rmp_keypad_init(&keypad, &app);
+static void usage(const char* prog) {
+  fprintf(stderr, "Usage: %s [-R] [-F] [-K] [-k] [-G] [-H] [-P none|fifo|rr] [-S 1|2|4] "
+          "[-T threads] [-p rgba8888|rgb565] [-r recording] [-c capture]\n", prog);
+  fprintf(stderr, "  -R  Run all components on a single event reactor thread\n");
+  fprintf(stderr, "  -F  Keep the loops free-running while the game is paused\n");
+  fprintf(stderr, "  -K  Keep the keypad scanning while no key is down\n");
+  fprintf(stderr, "  -k  Keypad self-test, hold a key to find the shortest row settle and exit\n");
+  fprintf(stderr, "  -G  Scan the keypad through the mapped GPIO registers\n");
+  fprintf(stderr, "  -H  Show the performance overlay\n");
+  fprintf(stderr, "  -P  Real-time scheduling profile from rmp_config.h (default none)\n");
+  fprintf(stderr, "  -S  Draw 1/1, 1/2 or 1/4 of the window area and scale it up (fb backend)\n");
+  fprintf(stderr, "  -T  Threads drawing a frame in tiles (fb backend)\n");
+  fprintf(stderr, "  -p  Pixel format drawn in (default from rmp_config.h)\n");
+  fprintf(stderr, "  -c  Capture presented frames to a .y4m, .rmpd or numbered .ppm path\n");
+}
 
-  rmp_screen_t screen;
-  rmp_screen_init(&screen, &app);
+static time_t app_source(void* ctx, time_t now_us) {
+  rmp_app_t* app = (rmp_app_t*)ctx;
 
-  printf("\n");
+  unsigned long input_events = app->stats.input_events;
+  time_t deadline = rmp_app_tick(app, now_us);
 
-  rmp_log_info("main", "===> Starting components\n");
+  // Input was applied, loops parked by the governor have something to do again
+  if (app->stats.input_events != input_events) {
+    rmp_reactor_kick(g_reactor);
+  }
+
+  return deadline;
+}
+
+static time_t keypad_source(void* ctx, time_t now_us) {
+  rmp_keypad_t* keypad = (rmp_keypad_t*)ctx;
+
+  time_t deadline = rmp_keypad_step(keypad, now_us);
+
+  // Input is queued, the sim may be parked by the governor and has to drain it
+  if (!rmp_input_is_empty(&keypad->app->input)) {
+    rmp_reactor_kick(g_reactor);
+  }
+
+  return deadline;
+}
+
+static time_t screen_source(void* ctx, time_t now_us) {
+  rmp_screen_t* screen = (rmp_screen_t*)ctx;
+
+  time_t deadline = rmp_screen_step(screen, now_us);
+
+  // Keys from the screen's own keyboard are queued the same way as the keypad's
+  if (!rmp_input_is_empty(&screen->app->keyboard_input)) {
+    rmp_reactor_kick(g_reactor);
+  }
+
+  return deadline;
+}
+
+static void handle_signal(int signo) {
+  (void)signo;
+  // Not a full rmp_app_quit, taking the mutex is not async-signal-safe
+  g_app->quit_us = rmp_time_get_us();
+  atomic_store(&g_app->running, false);
+  rmp_reactor_wake(g_reactor);
+}
+
+static int run_threaded(rmp_app_t* app, rmp_keypad_t* keypad, rmp_screen_t* screen,
+                        const rmp_sched_profile_t* profile) {
   pthread_t app_tid;
-  if (pthread_create(&app_tid, NULL, rmp_app_run, (void*)&app) != 0) {
+  if (rmp_sched_spawn(&app_tid, profile->policy, &profile->app, rmp_app_run, (void*)app) !=
+      RMP_SCHED_OK) {
     rmp_log_error("main", "Failed to create app thread\n");
     return EXIT_FAILURE;
   }
 
   pthread_t keypad_tid;
-  if (pthread_create(&keypad_tid, NULL, rmp_keypad_run, (void*)&keypad) != 0) {
+  if (rmp_sched_spawn(&keypad_tid, profile->policy, &profile->keypad, rmp_keypad_run,
+                      (void*)keypad) != RMP_SCHED_OK) {
     rmp_log_error("main", "Failed to create keypad thread\n");
     return EXIT_FAILURE;
   }
 
   pthread_t screen_tid;
-  if (pthread_create(&screen_tid, NULL, rmp_screen_run, (void*)&screen) != 0) {
+  if (rmp_sched_spawn(&screen_tid, profile->policy, &profile->screen, rmp_screen_run,
+                      (void*)screen) != RMP_SCHED_OK) {
     rmp_log_error("main", "Failed to create screen thread\n");
     return EXIT_FAILURE;
   }
@@ -43,11 +111,14 @@ int main(void) {
   printf("\n");
 
   rmp_log_info("main", "===> Wating for app to close\n");
-  pthread_mutex_lock(&app.mutex);
-  while (app.running) {
-    pthread_cond_wait(&app.cond, &app.mutex);
+  pthread_mutex_lock(&app->mutex);
+  while (rmp_app_is_running(app)) {
+    pthread_cond_wait(&app->cond, &app->mutex);
   }
-  pthread_mutex_unlock(&app.mutex);
+  pthread_mutex_unlock(&app->mutex);
+
+  // The keypad may be blocked waiting for a key
+  rmp_keypad_wake(keypad);
 
   printf("\n");
 
@@ -57,12 +128,216 @@ int main(void) {
   pthread_join(keypad_tid, NULL);
   pthread_join(screen_tid, NULL);
 
+  return EXIT_SUCCESS;
+}
+
+static int run_reactor(rmp_app_t* app, rmp_keypad_t* keypad, rmp_screen_t* screen,
+                       const rmp_sched_profile_t* profile) {
+  rmp_reactor_t reactor;
+  if (rmp_reactor_init(&reactor, app) != RMP_REACTOR_OK) {
+    return EXIT_FAILURE;
+  }
+
+  if (rmp_reactor_add(&reactor, app_source, app, &app->probe) != RMP_REACTOR_OK ||
+      rmp_reactor_add(&reactor, keypad_source, keypad, &keypad->probe) != RMP_REACTOR_OK ||
+      rmp_reactor_add(&reactor, screen_source, screen, &screen->probe) != RMP_REACTOR_OK) {
+    rmp_reactor_free(&reactor);
+    return EXIT_FAILURE;
+  }
+
+  // Everything shares this thread, so it takes the app profile
+  rmp_sched_apply(profile->policy, &profile->app);
+
+  g_app = app;
+  g_reactor = &reactor;
+  signal(SIGINT, handle_signal);
+  signal(SIGTERM, handle_signal);
+
+  rmp_log_info("main", "===> Running reactor until app closes\n");
+  rmp_reactorRet_e ret = rmp_reactor_run(&reactor);
+
+  signal(SIGINT, SIG_DFL);
+  signal(SIGTERM, SIG_DFL);
+  rmp_reactor_free(&reactor);
+
+  return ret == RMP_REACTOR_OK ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int main(int argc, char** argv) {
+  const char* record_path = NULL;
+  bool use_reactor = false;
+  const char* sched_policy = NULL;
+  bool governor = true;
+  bool edge_wait = RMP_CONFIG_KEYPAD_EDGE_WAIT;
+  bool keypad_test = false;
+  bool gpio_regs = RMP_CONFIG_KEYPAD_GPIO_REGS;
+  const char* capture_path = NULL;
+  bool show_hud = false;
+  int render_scale = RMP_CONFIG_FB_RENDER_SCALE;
+  int render_threads = RMP_CONFIG_FB_RENDER_THREADS;
+  rmp_fb_format_e format = RMP_CONFIG_PIXEL_FORMAT;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "RFKkGHP:S:T:p:r:c:h")) != -1) {
+    switch (opt) {
+      case 'R':
+        use_reactor = true;
+        break;
+      case 'F':
+        governor = false;
+        break;
+      case 'K':
+        edge_wait = false;
+        break;
+      case 'k':
+        keypad_test = true;
+        break;
+      case 'G':
+        gpio_regs = true;
+        break;
+      case 'H':
+        show_hud = true;
+        break;
+      case 'P':
+        sched_policy = optarg;
+        break;
+      case 'S':
+        render_scale = atoi(optarg);
+        break;
+      case 'T':
+        render_threads = atoi(optarg);
+        break;
+      case 'p':
+        if (rmp_fb_parse_format(optarg, &format) != RMP_FB_OK) {
+          usage(argv[0]);
+          return EXIT_FAILURE;
+        }
+        break;
+      case 'r':
+        record_path = optarg;
+        break;
+      case 'c':
+        capture_path = optarg;
+        break;
+      default:
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+  }
+
+  rmp_sched_profile_t profile;
+  if (rmp_sched_profile_init(&profile, sched_policy) != RMP_SCHED_OK) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  rmp_log_info("main", "===> Initializing components\n");
+  rmp_app_t app;
+  rmp_app_init(&app);
+  rmp_app_seed(&app, (uint32_t)rmp_time_get_us());
+  app.governor = governor;
+
+  if (record_path && rmp_record_start(&app, record_path) != RMP_RECORD_OK) {
+    return EXIT_FAILURE;
+  }
+
+  rmp_keypad_t keypad;
+  rmp_keypad_init(&keypad, &app);
+  if (gpio_regs && rmp_keypad_map_gpio(&keypad) != RMP_KEYPAD_OK) {
+    rmp_log_error("main", "Keypad GPIO registers are unavailable, sending messages instead\n");
+  }
+  if (keypad_test) {
+    time_t settle_us;
+    if (rmp_keypad_calibrate(&keypad, &settle_us) != RMP_KEYPAD_OK) {
+      return EXIT_FAILURE;
+    }
+    printf("Set RMP_CONFIG_KEYPAD_SETTLE_US to at least %ld\n", (long)settle_us);
+    return EXIT_SUCCESS;
+  }
+
+  if (edge_wait && !use_reactor && rmp_keypad_set_edge_wait(&keypad, true) != RMP_KEYPAD_OK) {
+    rmp_log_error("main", "Keypad edge events are unavailable, scanning instead\n");
+  }
+
+  rmp_screen_t screen;
+  if (rmp_screen_init(&screen, &app, render_scale, format) != RMP_SCREEN_OK) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  if (render_threads != 1 &&
+      rmp_render_fb_set_threads(&screen.render, render_threads) != RMP_RENDER_OK) {
+    rmp_log_error("main", "Cannot draw on %d threads with the %s backend\n", render_threads,
+                  screen.render.name);
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  rmp_capture_t capture;
+  if (capture_path) {
+    if (rmp_capture_init(&capture, capture_path, screen.render.width, screen.render.height,
+                         screen.render.refresh_hz, RMP_CONFIG_CAPTURE_SLOTS) != RMP_CAPTURE_OK) {
+      return EXIT_FAILURE;
+    }
+    screen.capture = &capture;
+  }
+
+  rmp_hud_t hud;
+  if (show_hud) {
+    if (rmp_hud_init(&hud, screen.render.format) != RMP_HUD_OK) {
+      return EXIT_FAILURE;
+    }
+    screen.hud = &hud;
+  }
+
+  printf("\n");
+
+  rmp_log_info("main", "===> Starting components\n");
+  int status = use_reactor ? run_reactor(&app, &keypad, &screen, &profile)
+                           : run_threaded(&app, &keypad, &screen, &profile);
+  if (status != EXIT_SUCCESS) {
+    return status;
+  }
+
+  time_t stop_us = rmp_time_get_us();
+  rmp_app_log_stats(&app);
+  rmp_screen_log_stats(&screen);
+  rmp_keypad_log_stats(&keypad);
+  rmp_sched_probe_log("app", &app.probe);
+  rmp_sched_probe_log("keypad", &keypad.probe);
+  rmp_sched_probe_log("screen", &screen.probe);
+  if (capture_path) {
+    rmp_capture_free(&capture);
+    rmp_capture_log_stats(&capture);
+  }
+  if (show_hud) {
+    rmp_hud_log_stats(&hud);
+  }
+  rmp_log_info("main", "Shutdown latency: %ld us\n", (long)(stop_us - app.quit_us));
+  rmp_log_info("main", "Loop wakeups: %.1f/s\n",
+               atomic_load(&app.loop_wakeups) * 1e6 / (double)(stop_us - app.start_us));
+
+  struct rusage resources;
+  if (getrusage(RUSAGE_SELF, &resources) == 0) {
+    double cpu_us = resources.ru_utime.tv_sec * 1e6 + resources.ru_utime.tv_usec +
+                    resources.ru_stime.tv_sec * 1e6 + resources.ru_stime.tv_usec;
+    rmp_log_info("main", "CPU usage: %.2f%%\n", cpu_us * 100 / (double)(stop_us - app.start_us));
+  }
+
   printf("\n");
 
   rmp_log_info("main", "===> Destroying components\n");
 
+  if (record_path) {
+    rmp_record_stop(&app);
+  }
+
   rmp_app_free(&app);
+  rmp_keypad_free(&keypad);
   rmp_screen_free(&screen);
+  if (show_hud) {
+    rmp_hud_free(&hud);
+  }
 
   printf("\n");
 
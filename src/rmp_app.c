@@ -2,8 +2,13 @@
 #include "rmp_time.h"
 #include "rmp_vec2.h"
 #include "rmp_log.h"
+#include "rmp_event.h"
+#include "rmp_record.h"
+#include "rmp_config.h"
+#include "rmp_sched.h"
 
 #include <stdio.h>
+#include <string.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -13,23 +18,43 @@
 
 #define RMP_APP_TARGET_FPS 30
 #define RMP_APP_FRAME_TIME_US (1000000 / RMP_APP_TARGET_FPS)
+#define RMP_APP_MAX_CATCHUP_STEPS 5
 
 static void step(rmp_app_t* app);
+static void move_ball(rmp_app_t* app);
+static void step_balls(rmp_app_t* app);
+static void collide_ball_pad(rmp_app_balls_t* balls, int i, const rmp_app_entity_t* pad);
+static void collide_balls(rmp_app_balls_t* balls, int i, int j);
+static bool resolve_overlap(const rmp_app_t* app, rmp_app_entity_t* ball,
+                            const rmp_app_entity_t* pad);
+static bool fold_channel(double* y, double* vel_y, double lo, double hi, double t);
 static void reset_ball_pos(rmp_app_t* app);
 static void make_ai_move(rmp_app_t* app);
+static uint32_t next_random(rmp_app_t* app);
+static void apply_event(rmp_app_t* app, uint8_t event);
+static void drain_input(rmp_app_t* app, rmp_input_t* input);
+static void set_pad_vel(rmp_app_t* app, rmp_app_entity_t* pad, int up_key, int down_key);
+static void handle_game_event(uint8_t event, rmp_app_t* app);
+static void handle_recal_event(uint8_t event, rmp_app_t* app);
+static void sync_prev_state(rmp_app_t* app);
+static void publish_snapshot(rmp_app_t* app);
+static void wait_while_idle(rmp_app_t* app);
 
 rmp_appRet_e rmp_app_init(rmp_app_t* app) {
   if (!app) {
     return RMP_APP_BAD_ARGS;
   }
 
-  app->running = true;
+  atomic_init(&app->running, true);
   app->paused = true;
   app->recalibrating = false;
   app->ai_is_playing = true;
 
   pthread_mutex_init(&app->mutex, NULL);
   pthread_cond_init(&app->cond, NULL);
+  pthread_cond_init(&app->wake, NULL);
+  app->governor = true;
+  app->idle = false;
 
   rmp_vec2_set(&app->SCREEN_START, 50, 30);
   rmp_vec2_set(&app->SCREEN_END, 1870, 1050);
@@ -37,6 +62,7 @@ rmp_appRet_e rmp_app_init(rmp_app_t* app) {
   rmp_vec2_set(&app->pad_size, 20, 150);
   app->pad_padding = 50;
   app->pad_speed = 20;
+  app->keys_held = 0;
 
   int pad_pos_y = app->SCREEN_START.y + ((SCREEN_HEIGHT_P(app) / 2.0) - (app->pad_size.y / 2.0));
   rmp_vec2_set(&app->pad_a.size, app->pad_size.x, app->pad_size.y);
@@ -52,6 +78,36 @@ rmp_appRet_e rmp_app_init(rmp_app_t* app) {
   reset_ball_pos(app);
   rmp_vec2_set(&app->ball.vel, 12, 12);
 
+  app->score_a = 0;
+  app->score_b = 0;
+  rmp_app_seed(app, 1);
+
+  memset(&app->balls, 0, sizeof(app->balls));
+  memset(&app->grid, 0, sizeof(app->grid));
+
+  app->tick = 0;
+  app->record_file = NULL;
+  app->record_tick = 0;
+
+  sync_prev_state(app);
+  app->step_time_us = rmp_time_get_us();
+  app->next_step_us = app->step_time_us;
+  memset(&app->stats, 0, sizeof(app->stats));
+  memset(&app->probe, 0, sizeof(app->probe));
+
+  atomic_init(&app->loop_wakeups, 0);
+  atomic_init(&app->input_latency_us, -1);
+  if (rmp_input_init(&app->input) != RMP_INPUT_OK ||
+      rmp_input_init(&app->keyboard_input) != RMP_INPUT_OK) {
+    return RMP_APP_BAD_INIT;
+  }
+  app->start_us = rmp_time_get_us();
+  app->quit_us = 0;
+
+  atomic_init(&app->snapshot_seq, 0);
+  memset(&app->snapshot, 0, sizeof(app->snapshot));
+  publish_snapshot(app);
+
   rmp_log_info("app", "Initialized app\n");
   return RMP_APP_OK;
 }
@@ -61,8 +117,13 @@ rmp_appRet_e rmp_app_free(rmp_app_t* app) {
     return RMP_APP_BAD_ARGS;
   }
 
+  rmp_app_clear_balls(app);
+  rmp_input_free(&app->input);
+  rmp_input_free(&app->keyboard_input);
+
   pthread_mutex_destroy(&app->mutex);
   pthread_cond_destroy(&app->cond);
+  pthread_cond_destroy(&app->wake);
 
   return RMP_APP_OK;
 }
@@ -75,25 +136,258 @@ void* rmp_app_run(void* args) {
   rmp_app_t* app = (rmp_app_t*)args;
 
   rmp_log_info("app", "Started app run\n");
-  while (true) {
-    pthread_mutex_lock(&app->mutex);
-    if (!app->running) {
-      break;
+  time_t deadline = rmp_time_get_us();
+  while (rmp_app_is_running(app)) {
+    time_t now = rmp_time_get_us();
+    rmp_sched_probe_record(&app->probe, deadline, now);
+    atomic_fetch_add(&app->loop_wakeups, 1);
+    deadline = rmp_app_tick(app, now);
+
+    // Paused or recalibrating, nothing to step until input changes that
+    if (deadline == RMP_TIME_NEVER) {
+      wait_while_idle(app);
+      deadline = rmp_time_get_us();
+      continue;
     }
-    pthread_mutex_unlock(&app->mutex);
 
-    time_t frame_start = rmp_time_get_us();
+    rmp_time_sleep_until_us(deadline);
+  }
 
-    step(app);
+  return NULL;
+}
+
+time_t rmp_app_tick(rmp_app_t* app, time_t now_us) {
+  if (!app) {
+    return now_us;
+  }
+
+  // Back from idle, the schedule restarts now instead of catching up on the pause
+  if (app->idle) {
+    app->idle = false;
+    app->next_step_us = now_us;
+  }
 
-    time_t frame_duration = rmp_time_get_us() - frame_start;
-    if (frame_duration < RMP_APP_FRAME_TIME_US) {
-      usleep(RMP_APP_FRAME_TIME_US - frame_duration);
+  // Lateness of this wake-up against the deadline handed out last time
+  time_t jitter = now_us - app->next_step_us;
+  if (jitter >= 0) {
+    app->stats.wakeups++;
+    app->stats.jitter_total_us += jitter;
+    if (jitter > app->stats.jitter_max_us) {
+      app->stats.jitter_max_us = jitter;
     }
   }
+
+  // Run every step that is due, catching up after an overrun up to a limit
+  int steps = 0;
+  pthread_mutex_lock(&app->mutex);
+  unsigned long input_events = app->stats.input_events;
+  while (now_us >= app->next_step_us && steps < RMP_APP_MAX_CATCHUP_STEPS) {
+    app->step_time_us = app->next_step_us;
+    step(app);
+    app->next_step_us += RMP_APP_FRAME_TIME_US;
+    ++steps;
+  }
+  if (app->stats.input_events != input_events) {
+    rmp_app_notify(app);
+  }
+  else if (steps > 0) {
+    publish_snapshot(app);
+  }
   pthread_mutex_unlock(&app->mutex);
 
-  return NULL;
+  app->stats.steps += steps;
+  if (steps > 1) {
+    app->stats.overruns++;
+    app->stats.catchup_steps += steps - 1;
+  }
+
+  // Too far behind to catch up, drop the backlog and re-anchor the schedule
+  if (now_us >= app->next_step_us) {
+    app->stats.dropped_steps += (now_us - app->next_step_us) / RMP_APP_FRAME_TIME_US + 1;
+    app->next_step_us = now_us + RMP_APP_FRAME_TIME_US;
+  }
+
+  if (app->governor && rmp_app_is_idle(app)) {
+    app->idle = true;
+    return RMP_TIME_NEVER;
+  }
+
+  return app->next_step_us;
+}
+
+void rmp_app_quit(rmp_app_t* app) {
+  if (!app) {
+    return;
+  }
+
+  // Callers hold app->mutex, so main cannot miss the signal
+  app->quit_us = rmp_time_get_us();
+  atomic_store(&app->running, false);
+  pthread_cond_signal(&app->cond);
+  pthread_cond_broadcast(&app->wake);
+  rmp_input_wake(&app->input);
+}
+
+void rmp_app_step(rmp_app_t* app) {
+  if (!app) {
+    return;
+  }
+
+  step(app);
+}
+
+void rmp_app_handle_event(rmp_app_t* app, uint8_t event) {
+  if (!app) {
+    return;
+  }
+
+  pthread_mutex_lock(&app->mutex);
+  apply_event(app, event);
+  rmp_app_notify(app);
+  pthread_mutex_unlock(&app->mutex);
+}
+
+bool rmp_app_post_event(rmp_app_t* app, uint8_t event) {
+  if (!app) {
+    return false;
+  }
+
+  // Never takes app->mutex, the sim applies the event at the start of its next step
+  return rmp_input_push(&app->input, event, rmp_time_get_us());
+}
+
+bool rmp_app_post_keyboard_event(rmp_app_t* app, uint8_t event) {
+  if (!app) {
+    return false;
+  }
+
+  // Nobody sleeps on this queue. The push fences before the wake, and the sim looks at this queue
+  // after announcing its sleep on the keypad one, so one of them sees the other
+  bool pushed = rmp_input_push(&app->keyboard_input, event, rmp_time_get_us());
+  rmp_input_wake(&app->input);
+  return pushed;
+}
+
+void rmp_app_notify(rmp_app_t* app) {
+  if (!app) {
+    return;
+  }
+
+  // Callers hold app->mutex. Input can change what is on screen while the sim is not stepping,
+  // so publish it and wake every loop blocked by the governor
+  publish_snapshot(app);
+  pthread_cond_broadcast(&app->wake);
+  rmp_input_wake(&app->input);
+}
+
+bool rmp_app_is_idle(rmp_app_t* app) {
+  return app->paused || app->recalibrating;
+}
+
+void rmp_app_wait_for_change(rmp_app_t* app, unsigned long generation) {
+  if (!app) {
+    return;
+  }
+
+  pthread_mutex_lock(&app->mutex);
+  while (rmp_app_is_running(app) && rmp_app_is_idle(app) &&
+         app->snapshot.generation == generation) {
+    pthread_cond_wait(&app->wake, &app->mutex);
+  }
+  pthread_mutex_unlock(&app->mutex);
+}
+
+uint64_t rmp_app_hash_state(const rmp_app_t* app) {
+  if (!app) {
+    return 0;
+  }
+
+  uint64_t hash = RMP_APP_HASH_SEED;
+  hash = rmp_app_hash_bytes(hash, &app->tick, sizeof(app->tick));
+  hash = rmp_app_hash_bytes(hash, &app->pad_a, sizeof(app->pad_a));
+  hash = rmp_app_hash_bytes(hash, &app->pad_b, sizeof(app->pad_b));
+  hash = rmp_app_hash_bytes(hash, &app->ball, sizeof(app->ball));
+  hash = rmp_app_hash_bytes(hash, &app->score_a, sizeof(app->score_a));
+  hash = rmp_app_hash_bytes(hash, &app->score_b, sizeof(app->score_b));
+  hash = rmp_app_hash_bytes(hash, &app->rng_state, sizeof(app->rng_state));
+  hash = rmp_app_hash_bytes(hash, &app->SCREEN_START, sizeof(app->SCREEN_START));
+  hash = rmp_app_hash_bytes(hash, &app->SCREEN_END, sizeof(app->SCREEN_END));
+  hash = rmp_app_hash_bytes(hash, app->balls.x, app->balls.count * sizeof(float));
+  hash = rmp_app_hash_bytes(hash, app->balls.y, app->balls.count * sizeof(float));
+  hash = rmp_app_hash_bytes(hash, app->balls.vx, app->balls.count * sizeof(float));
+  hash = rmp_app_hash_bytes(hash, app->balls.vy, app->balls.count * sizeof(float));
+
+  return hash;
+}
+
+uint64_t rmp_app_hash_bytes(uint64_t hash, const void* data, size_t size) {
+  const unsigned char* bytes = (const unsigned char*)data;
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= bytes[i];
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
+
+void rmp_app_seed(rmp_app_t* app, uint32_t seed) {
+  if (!app) {
+    return;
+  }
+
+  // xorshift gets stuck on zero
+  app->rng_state = seed ? seed : 0x9e3779b9u;
+}
+
+rmp_appRet_e rmp_app_spawn_balls(rmp_app_t* app, int count) {
+  if (!app || count <= 0) {
+    return RMP_APP_BAD_ARGS;
+  }
+
+  rmp_app_clear_balls(app);
+
+  rmp_app_balls_t* balls = &app->balls;
+  balls->size = app->ball_size;
+  balls->x = malloc(count * sizeof(float));
+  balls->y = malloc(count * sizeof(float));
+  balls->vx = malloc(count * sizeof(float));
+  balls->vy = malloc(count * sizeof(float));
+
+  if (!balls->x || !balls->y || !balls->vx || !balls->vy ||
+      rmp_grid_init(&app->grid, app->SCREEN_START, app->SCREEN_END, balls->size, count) !=
+      RMP_GRID_OK) {
+    rmp_log_error("app", "Failed to allocate %d balls\n", count);
+    rmp_app_clear_balls(app);
+    return RMP_APP_BAD_INIT;
+  }
+
+  // Scatter over the field, never faster than half a ball per step
+  float width = SCREEN_WIDTH_P(app) - balls->size;
+  float height = SCREEN_HEIGHT_P(app) - balls->size;
+  float max_speed = balls->size / 2;
+  for (int i = 0; i < count; ++i) {
+    balls->x[i] = app->SCREEN_START.x + (next_random(app) % 10000) / 10000.0f * width;
+    balls->y[i] = app->SCREEN_START.y + (next_random(app) % 10000) / 10000.0f * height;
+    balls->vx[i] = ((next_random(app) % 2001) / 1000.0f - 1) * max_speed;
+    balls->vy[i] = ((next_random(app) % 2001) / 1000.0f - 1) * max_speed;
+  }
+
+  balls->capacity = count;
+  balls->count = count;
+  return RMP_APP_OK;
+}
+
+void rmp_app_clear_balls(rmp_app_t* app) {
+  if (!app) {
+    return;
+  }
+
+  free(app->balls.x);
+  free(app->balls.y);
+  free(app->balls.vx);
+  free(app->balls.vy);
+  memset(&app->balls, 0, sizeof(app->balls));
+
+  rmp_grid_free(&app->grid);
 }
 
 void rmp_app_log_entity(const char* name, rmp_app_entity_t entity) {
@@ -116,9 +410,175 @@ void rmp_app_recalibrate(rmp_app_t* app) {
   rmp_vec2_set(&app->pad_b.size, app->pad_size.x, app->pad_size.y);
   rmp_vec2_set(&app->pad_b.pos, app->SCREEN_END.x - app->pad_padding - app->pad_size.x, pad_pos_y);
   rmp_vec2_set(&app->pad_b.vel, 0, 0);
+
+  // The broadphase grid is sized from the field
+  if (app->balls.count > 0) {
+    rmp_grid_free(&app->grid);
+    rmp_grid_init(&app->grid, app->SCREEN_START, app->SCREEN_END, app->balls.size,
+                  app->balls.capacity);
+  }
+
+  rmp_app_invalidate_prediction(app);
+  sync_prev_state(app);
+}
+
+bool rmp_app_predict_intercept(const rmp_app_t* app, float* intercept_y) {
+  if (!app || !intercept_y) {
+    return false;
+  }
+
+  *intercept_y = app->ball.pos.y + app->ball.size.y / 2.0f;
+  if (app->ball.vel.x <= 0) {
+    return false;
+  }
+
+  float dx = app->pad_b.pos.x - (app->ball.pos.x + app->ball.size.x);
+  float time_to_reach = dx / app->ball.vel.x;
+
+  float predicted_y = app->ball.pos.y + app->ball.vel.y * time_to_reach;
+  float ball_center_y = predicted_y + app->ball.size.y / 2.0f;
+
+  float field_height = SCREEN_HEIGHT_P(app);
+  if (!isfinite(ball_center_y) || !(field_height > 0)) {
+    return false;
+  }
+
+  // Reflections off both walls fold the line into a triangle wave with period 2 * height. Within
+  // the first period fmodf would return it unchanged, most flights never leave it
+  float period = 2 * field_height;
+  if (ball_center_y < 0 || ball_center_y >= period) {
+    ball_center_y = fmodf(ball_center_y, period);
+    if (ball_center_y < 0) {
+      ball_center_y += period;
+    }
+  }
+  if (ball_center_y > field_height) {
+    ball_center_y = period - ball_center_y;
+  }
+
+  *intercept_y = ball_center_y;
+  return true;
+}
+
+void rmp_app_invalidate_prediction(rmp_app_t* app) {
+  if (!app) {
+    return;
+  }
+
+  app->ai_intercept_valid = false;
+}
+
+bool rmp_app_is_running(rmp_app_t* app) {
+  return atomic_load_explicit(&app->running, memory_order_acquire);
+}
+
+void rmp_app_read_snapshot(rmp_app_t* app, rmp_app_snapshot_t* dst) {
+  if (!app || !dst) {
+    return;
+  }
+
+  unsigned seq_start, seq_end;
+  do {
+    seq_start = atomic_load_explicit(&app->snapshot_seq, memory_order_acquire);
+    if (seq_start & 1) {
+      seq_end = seq_start + 1;
+      continue;
+    }
+
+    memcpy(dst, &app->snapshot, sizeof(*dst));
+    atomic_thread_fence(memory_order_acquire);
+    seq_end = atomic_load_explicit(&app->snapshot_seq, memory_order_relaxed);
+  } while (seq_start != seq_end);
+}
+
+double rmp_app_get_alpha(const rmp_app_snapshot_t* snapshot, time_t now_us) {
+  if (!snapshot) {
+    return 1.0;
+  }
+
+  double alpha = (double)(now_us - snapshot->step_time_us) / RMP_APP_FRAME_TIME_US;
+  return fmax(0.0, fmin(alpha, 1.0));
+}
+
+void rmp_app_lerp_entity(rmp_app_entity_t* dst, rmp_app_entity_t prev, rmp_app_entity_t cur,
+                         double alpha) {
+  if (!dst) {
+    return;
+  }
+
+  rmp_vec2_t delta;
+  rmp_vec2_sub(&delta, cur.pos, prev.pos);
+  rmp_vec2_scale(&delta, delta, alpha);
+
+  *dst = cur;
+  rmp_vec2_add(&dst->pos, prev.pos, delta);
+}
+
+void rmp_app_log_stats(const rmp_app_t* app) {
+  if (!app) {
+    return;
+  }
+
+  const rmp_app_stats_t* stats = &app->stats;
+  long jitter_avg = stats->wakeups ? (long)(stats->jitter_total_us / (time_t)stats->wakeups) : 0;
+
+  rmp_log_info("app", "Frame pacing\n");
+  printf("    steps   : %lu\n", stats->steps);
+  printf("    overrun : %lu (%lu catch-up steps, %lu dropped)\n",
+         stats->overruns, stats->catchup_steps, stats->dropped_steps);
+  printf("    jitter  : %ld us avg, %ld us max\n", jitter_avg, (long)stats->jitter_max_us);
+  printf("    input   : %lu events, %.1f us avg, %ld us max queued, %lu dropped\n",
+         stats->input_events,
+         stats->input_events ? stats->input_latency_total_us / (double)stats->input_events : 0.0,
+         (long)stats->input_latency_max_us, app->input.dropped + app->keyboard_input.dropped);
+}
+
+static void sync_prev_state(rmp_app_t* app) {
+  app->prev_pad_a = app->pad_a;
+  app->prev_pad_b = app->pad_b;
+  app->prev_ball = app->ball;
+}
+
+static void publish_snapshot(rmp_app_t* app) {
+  unsigned seq = atomic_load_explicit(&app->snapshot_seq, memory_order_relaxed);
+  atomic_store_explicit(&app->snapshot_seq, seq + 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+
+  rmp_app_snapshot_t* snapshot = &app->snapshot;
+  snapshot->generation++;
+  snapshot->step_time_us = app->step_time_us;
+  snapshot->paused = app->paused;
+  snapshot->recalibrating = app->recalibrating;
+  snapshot->ai_is_playing = app->ai_is_playing;
+  snapshot->SCREEN_START = app->SCREEN_START;
+  snapshot->SCREEN_END = app->SCREEN_END;
+  snapshot->pad_a = app->pad_a;
+  snapshot->pad_b = app->pad_b;
+  snapshot->ball = app->ball;
+  snapshot->prev_pad_a = app->prev_pad_a;
+  snapshot->prev_pad_b = app->prev_pad_b;
+  snapshot->prev_ball = app->prev_ball;
+
+  int ball_count = app->balls.count;
+  if (ball_count > RMP_APP_SNAPSHOT_MAX_BALLS) {
+    ball_count = RMP_APP_SNAPSHOT_MAX_BALLS;
+  }
+  snapshot->ball_count = ball_count;
+  snapshot->ball_size = app->balls.size;
+  memcpy(snapshot->ball_x, app->balls.x, ball_count * sizeof(float));
+  memcpy(snapshot->ball_y, app->balls.y, ball_count * sizeof(float));
+
+  atomic_store_explicit(&app->snapshot_seq, seq + 2, memory_order_release);
 }
 
 static void step(rmp_app_t* app) {
+  // Input lands between steps, at the tick a recording pins it to
+  drain_input(app, &app->input);
+  drain_input(app, &app->keyboard_input);
+
+  sync_prev_state(app);
+  app->tick++;
+
   if (app->paused || app->recalibrating) {
     return;
   }
@@ -137,47 +597,306 @@ static void step(rmp_app_t* app) {
   app->pad_b.pos.y = fmaxf(app->SCREEN_START.y,
                            fminf(app->pad_b.pos.y, app->SCREEN_END.y - app->pad_b.size.y));
 
-  // Store previous ball position for proper collision detection
-  float prev_ball_x = app->ball.pos.x;
+  // Update ball position, bouncing off everything it hits along the way
+  move_ball(app);
 
-  // Update ball position
-  rmp_vec2_add(&app->ball.pos, app->ball.pos, app->ball.vel);
+  if (app->balls.count > 0) {
+    step_balls(app);
+  }
 
-  // Top/bottom wall collision
-  if (app->ball.pos.y <= app->SCREEN_START.y) {
-    app->ball.pos.y = app->SCREEN_START.y;
-    app->ball.vel.y = fabs(app->ball.vel.y); // Force downward
+  // Score/reset (left or right boundary)
+  if (app->ball.pos.x < app->SCREEN_START.x ||
+    app->ball.pos.x + app->ball.size.x >= app->SCREEN_END.x) {
+    if (app->ball.pos.x < app->SCREEN_START.x) {
+      app->score_b++;
+    }
+    else {
+      app->score_a++;
+    }
+    reset_ball_pos(app);
+    app->prev_ball = app->ball; // Don't interpolate across the field
   }
-  if (app->ball.pos.y + app->ball.size.y >= app->SCREEN_END.y) {
-    app->ball.pos.y = app->SCREEN_END.y - app->ball.size.y;
-    app->ball.vel.y = -fabs(app->ball.vel.y); // Force upward
+}
+
+static void move_ball(rmp_app_t* app) {
+  rmp_app_entity_t* ball = &app->ball;
+
+  // Paddles move first and can close on the ball, the stepping below only finds contacts ahead
+  bool pushed = resolve_overlap(app, ball, &app->pad_a);
+  pushed = resolve_overlap(app, ball, &app->pad_b) || pushed;
+  if (pushed) {
+    rmp_app_invalidate_prediction(app);
   }
 
-  // Paddle A collision (left paddle)
-  if (app->ball.vel.x < 0 && // Ball moving left
-    prev_ball_x >= app->pad_a.pos.x + app->pad_a.size.x && // Was right of paddle
-    app->ball.pos.x <= app->pad_a.pos.x + app->pad_a.size.x && // Now overlapping
-    app->ball.pos.y + app->ball.size.y > app->pad_a.pos.y && // Vertical overlap check
-    app->ball.pos.y < app->pad_a.pos.y + app->pad_a.size.y) {
-    app->ball.pos.x = app->pad_a.pos.x + app->pad_a.size.x;
-    app->ball.vel.x = fabs(app->ball.vel.x); // Force rightward
+  // The ball only turns around along x at a paddle's side, where it enters the paddle's column.
+  // Between column edges it stays in one channel, the field or the part of it over or under the
+  // paddle it is passing, and bounces inside that fold in O(1). So it moves from edge to edge,
+  // however many times it crosses the channel in a step
+  const rmp_app_entity_t* pads[2] = {&app->pad_a, &app->pad_b};
+  double remaining = 1.0;
+  bool stalled = false;
+  while (remaining > 0) {
+    double lo = app->SCREEN_START.y;
+    double hi = app->SCREEN_END.y - ball->size.y;
+    double toi = remaining;
+    int next = -1;
+    double edge = 0;
+    bool entering = false;
+
+    for (int p = 0; p < 2; ++p) {
+      const rmp_app_entity_t* pad = pads[p];
+      double left = pad->pos.x - ball->size.x;
+      double right = pad->pos.x + pad->size.x;
+      double t = INFINITY;
+      double at = 0;
+      // On an edge it is in the column once it moves inwards
+      bool in_column = (ball->pos.x > left || (ball->pos.x == left && ball->vel.x > 0)) &&
+                       (ball->pos.x < right || (ball->pos.x == right && ball->vel.x < 0));
+
+      if (in_column) {
+        if (ball->pos.y + ball->size.y / 2 < pad->pos.y + pad->size.y / 2) {
+          hi = fmin(hi, pad->pos.y - ball->size.y);
+        }
+        else {
+          lo = fmax(lo, pad->pos.y + pad->size.y);
+        }
+        if (ball->vel.x != 0) {
+          at = ball->vel.x > 0 ? right : left;
+          t = (at - ball->pos.x) / ball->vel.x;
+        }
+      }
+      else if (ball->vel.x > 0 && ball->pos.x <= left) {
+        at = left;
+        t = (at - ball->pos.x) / ball->vel.x;
+      }
+      else if (ball->vel.x < 0 && ball->pos.x >= right) {
+        at = right;
+        t = (at - ball->pos.x) / ball->vel.x;
+      }
+      if (t < toi) {
+        toi = t;
+        next = p;
+        edge = at;
+        entering = !in_column;
+      }
+    }
+
+    if (fold_channel(&ball->pos.y, &ball->vel.y, lo, hi, toi)) {
+      rmp_app_invalidate_prediction(app);
+    }
+    remaining -= toi;
+    if (next < 0) {
+      ball->pos.x += ball->vel.x * toi;
+      break;
+    }
+
+    // Exactly on the edge, so the column test agrees with where the ball is next time round
+    ball->pos.x = edge;
+    const rmp_app_entity_t* pad = pads[next];
+    if (entering && ball->pos.y + ball->size.y > pad->pos.y &&
+        ball->pos.y < pad->pos.y + pad->size.y) {
+      ball->vel.x = -ball->vel.x;
+      rmp_app_invalidate_prediction(app);
+    }
+
+    // Edges keep coming without time passing only at a non-finite speed, give up on the step
+    if (toi == 0 && stalled) {
+      break;
+    }
+    stalled = toi == 0;
   }
+}
+
+static void step_balls(rmp_app_t* app) {
+  rmp_app_balls_t* balls = &app->balls;
+  int count = balls->count;
 
-  // Paddle B collision (right paddle)
-  if (app->ball.vel.x > 0 && // Ball moving right
-    prev_ball_x + app->ball.size.x <= app->pad_b.pos.x && // Was left of paddle
-    app->ball.pos.x + app->ball.size.x >= app->pad_b.pos.x && // Now overlapping
-    app->ball.pos.y + app->ball.size.y > app->pad_b.pos.y && // Vertical overlap check
-    app->ball.pos.y < app->pad_b.pos.y + app->pad_b.size.y) {
-    app->ball.pos.x = app->pad_b.pos.x - app->ball.size.x;
-    app->ball.vel.x = -fabs(app->ball.vel.x); // Force leftward
+  rmp_vec2_add_n(balls->x, balls->y, balls->x, balls->y, balls->vx, balls->vy, count);
+
+  // Extra balls bounce off all four sides and never score. Turn around everything past a
+  // wall, then pull the positions back inside in one batch.
+  rmp_vec2_t min = app->SCREEN_START;
+  rmp_vec2_t max;
+  rmp_vec2_set(&max, app->SCREEN_END.x - balls->size, app->SCREEN_END.y - balls->size);
+  for (int i = 0; i < count; ++i) {
+    if (balls->x[i] < min.x) {
+      balls->vx[i] = fabsf(balls->vx[i]);
+    }
+    else if (balls->x[i] > max.x) {
+      balls->vx[i] = -fabsf(balls->vx[i]);
+    }
+
+    if (balls->y[i] < min.y) {
+      balls->vy[i] = fabsf(balls->vy[i]);
+    }
+    else if (balls->y[i] > max.y) {
+      balls->vy[i] = -fabsf(balls->vy[i]);
+    }
   }
+  rmp_vec2_clamp_n(balls->x, balls->y, balls->x, balls->y, min, max, count);
 
-  // Score/reset (left or right boundary)
-  if (app->ball.pos.x < app->SCREEN_START.x ||
-    app->ball.pos.x + app->ball.size.x >= app->SCREEN_END.x) {
-    reset_ball_pos(app);
+  for (int i = 0; i < count; ++i) {
+    collide_ball_pad(balls, i, &app->pad_a);
+    collide_ball_pad(balls, i, &app->pad_b);
+  }
+
+  // Cells are one ball wide, so overlapping balls sit in the same or a neighbouring cell.
+  // Visiting half of the neighbours tests every pair exactly once.
+  static const int neighbours[4][2] = {{1, 0}, {-1, 1}, {0, 1}, {1, 1}};
+  rmp_grid_t* grid = &app->grid;
+  rmp_grid_build(grid, balls->x, balls->y, count);
+
+  for (int row = 0; row < grid->rows; ++row) {
+    for (int col = 0; col < grid->cols; ++col) {
+      int cell = row * grid->cols + col;
+
+      for (int a = grid->cell_start[cell]; a < grid->cell_start[cell + 1]; ++a) {
+        int i = grid->items[a];
+
+        for (int b = a + 1; b < grid->cell_start[cell + 1]; ++b) {
+          collide_balls(balls, i, grid->items[b]);
+        }
+
+        for (int n = 0; n < 4; ++n) {
+          int ncol = col + neighbours[n][0];
+          int nrow = row + neighbours[n][1];
+          if (ncol < 0 || ncol >= grid->cols || nrow >= grid->rows) {
+            continue;
+          }
+
+          int ncell = nrow * grid->cols + ncol;
+          for (int b = grid->cell_start[ncell]; b < grid->cell_start[ncell + 1]; ++b) {
+            collide_balls(balls, i, grid->items[b]);
+          }
+        }
+      }
+    }
+  }
+}
+
+static void collide_ball_pad(rmp_app_balls_t* balls, int i, const rmp_app_entity_t* pad) {
+  float size = balls->size;
+  float left = balls->x[i] + size - pad->pos.x;
+  float right = pad->pos.x + pad->size.x - balls->x[i];
+  float top = balls->y[i] + size - pad->pos.y;
+  float bottom = pad->pos.y + pad->size.y - balls->y[i];
+
+  if (left <= 0 || right <= 0 || top <= 0 || bottom <= 0) {
+    return;
+  }
+
+  // Push out through the side with the least penetration
+  float depth = fminf(fminf(left, right), fminf(top, bottom));
+  if (depth == left) {
+    balls->x[i] -= left;
+    balls->vx[i] = -fabsf(balls->vx[i]);
+  }
+  else if (depth == right) {
+    balls->x[i] += right;
+    balls->vx[i] = fabsf(balls->vx[i]);
+  }
+  else if (depth == top) {
+    balls->y[i] -= top;
+    balls->vy[i] = -fabsf(balls->vy[i]);
+  }
+  else {
+    balls->y[i] += bottom;
+    balls->vy[i] = fabsf(balls->vy[i]);
+  }
+}
+
+static void collide_balls(rmp_app_balls_t* balls, int i, int j) {
+  float dx = balls->x[j] - balls->x[i];
+  float dy = balls->y[j] - balls->y[i];
+  float overlap_x = balls->size - fabsf(dx);
+  float overlap_y = balls->size - fabsf(dy);
+
+  if (overlap_x <= 0 || overlap_y <= 0) {
+    return;
+  }
+
+  // Separate along the shallower axis and exchange velocities there, equal masses
+  if (overlap_x < overlap_y) {
+    float push = (dx < 0 ? -overlap_x : overlap_x) / 2;
+    balls->x[i] -= push;
+    balls->x[j] += push;
+
+    if ((balls->vx[j] - balls->vx[i]) * dx < 0) {
+      float vx = balls->vx[i];
+      balls->vx[i] = balls->vx[j];
+      balls->vx[j] = vx;
+    }
+  }
+  else {
+    float push = (dy < 0 ? -overlap_y : overlap_y) / 2;
+    balls->y[i] -= push;
+    balls->y[j] += push;
+
+    if ((balls->vy[j] - balls->vy[i]) * dy < 0) {
+      float vy = balls->vy[i];
+      balls->vy[i] = balls->vy[j];
+      balls->vy[j] = vy;
+    }
+  }
+}
+
+static bool resolve_overlap(const rmp_app_t* app, rmp_app_entity_t* ball,
+                            const rmp_app_entity_t* pad) {
+  // How far the ball is in past each side of the pad, it is outside if any is not positive
+  double left = ball->pos.x + ball->size.x - pad->pos.x;
+  double right = pad->pos.x + pad->size.x - ball->pos.x;
+  double top = ball->pos.y + ball->size.y - pad->pos.y;
+  double bottom = pad->pos.y + pad->size.y - ball->pos.y;
+  if (left <= 0 || right <= 0 || top <= 0 || bottom <= 0) {
+    return false;
+  }
+
+  // Out the nearest side and moving away from it. Over or under the pad only if the ball still
+  // fits between it and the wall
+  double push_x = left < right ? -left : right;
+  double push_y = top < bottom ? -top : bottom;
+  double y = ball->pos.y + push_y;
+  if (fabs(push_y) < fabs(push_x) && y >= app->SCREEN_START.y &&
+      y + ball->size.y <= app->SCREEN_END.y) {
+    ball->pos.y = y;
+    ball->vel.y = copysign(ball->vel.y, push_y);
+  }
+  else {
+    ball->pos.x += push_x;
+    ball->vel.x = copysign(ball->vel.x, push_x);
+  }
+
+  return true;
+}
+
+static bool fold_channel(double* y, double* vel_y, double lo, double hi, double t) {
+  // Moves y for t steps between lo and hi, reflecting off both. False if it never reached either
+  double straight = *y + *vel_y * t;
+  double span = hi - lo;
+  if ((straight >= lo && straight <= hi) || !(span > 0)) {
+    *y = span > 0 ? straight : lo;
+    return false;
+  }
+
+  // Reflections fold the line into a triangle wave with period 2 * span, like the AI intercept.
+  // In the second half of a period the ball is on its way back
+  double period = 2 * span;
+  double u = straight - lo;
+  if (u < 0 || u >= period) {
+    u = fmod(u, period);
+    if (u < 0) {
+      u += period;
+    }
+  }
+  if (u > span) {
+    *y = lo + period - u;
+    *vel_y = -*vel_y;
   }
+  else {
+    *y = lo + u;
+  }
+
+  return true;
 }
 
 static void reset_ball_pos(rmp_app_t* app) {
@@ -189,31 +908,24 @@ static void reset_ball_pos(rmp_app_t* app) {
   int ball_pos_y = app->SCREEN_START.y + (SCREEN_HEIGHT_P(app) / 2.0) - (app->ball_size / 2.0);
 
   rmp_vec2_set(&app->ball.pos, ball_pos_x, ball_pos_y);
+  rmp_app_invalidate_prediction(app);
 }
 
 static float predict_ball_intersection(rmp_app_t* app) {
-  if (app->ball.vel.x <= 0) {
-    return app->ball.pos.y + app->ball.size.y / 2.0f;
+  if (app->ball.vel.x > 0 && app->ai_intercept_valid) {
+    return app->ai_intercept_y;
   }
 
-  float dx = app->pad_b.pos.x - (app->ball.pos.x + app->ball.size.x);
-  float time_to_reach = dx / app->ball.vel.x;
-
-  float predicted_y = app->ball.pos.y + app->ball.vel.y * time_to_reach;
-  float ball_center_y = predicted_y + app->ball.size.y / 2.0f;
-
-  float field_height = SCREEN_HEIGHT_P(app);
-
-  while (ball_center_y < 0 || ball_center_y > field_height) {
-    if (ball_center_y < 0) {
-      ball_center_y = -ball_center_y;
-    }
-    else if (ball_center_y > field_height) {
-      ball_center_y = 2 * field_height - ball_center_y;
-    }
+  float intercept_y;
+  if (!rmp_app_predict_intercept(app, &intercept_y)) {
+    return intercept_y;
   }
 
-  return ball_center_y;
+  // The intercept holds for the whole straight flight, until the next bounce or reset
+  app->ai_intercept_y = intercept_y;
+  app->ai_intercept_valid = true;
+
+  return intercept_y;
 }
 
 static void make_ai_move(rmp_app_t* app) {
@@ -224,7 +936,7 @@ static void make_ai_move(rmp_app_t* app) {
   float predicted_y = predict_ball_intersection(app);
 
   float error_margin = 5.0f;
-  predicted_y += (rand() % (int)(error_margin * 2)) - error_margin;
+  predicted_y += (int)(next_random(app) % (int)(error_margin * 2)) - error_margin;
 
   float paddle_center = app->pad_b.pos.y + app->pad_b.size.y / 2.0f;
   float target_y = predicted_y;
@@ -242,3 +954,171 @@ static void make_ai_move(rmp_app_t* app) {
   }
 }
 
+static uint32_t next_random(rmp_app_t* app) {
+  // Own generator instead of rand() so runs are reproducible on every platform
+  uint32_t x = app->rng_state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  app->rng_state = x;
+  return x;
+}
+
+static void apply_event(rmp_app_t* app, uint8_t event) {
+  if (app->record_file) {
+    rmp_record_event(app, event);
+  }
+
+  unsigned key = 1u << (event & ~RMP_KEYDOWN);
+  app->keys_held = (event & RMP_KEYDOWN) ? app->keys_held | key : app->keys_held & ~key;
+
+  if (app->recalibrating) {
+    handle_recal_event(event, app);
+  }
+  else {
+    handle_game_event(event, app);
+  }
+}
+
+static void drain_input(rmp_app_t* app, rmp_input_t* input) {
+  if (rmp_input_is_empty(input)) {
+    return;
+  }
+
+  rmp_input_event_t event;
+  time_t now_us = rmp_time_get_us();
+  while (rmp_input_pop(input, &event)) {
+    time_t latency_us = now_us > event.time_us ? now_us - event.time_us : 0;
+    app->stats.input_events++;
+    app->stats.input_latency_total_us += latency_us;
+    if (latency_us > app->stats.input_latency_max_us) {
+      app->stats.input_latency_max_us = latency_us;
+    }
+
+    apply_event(app, event.event);
+  }
+}
+
+static void set_pad_vel(rmp_app_t* app, rmp_app_entity_t* pad, int up_key, int down_key) {
+  // From what is held rather than adding per event, a lost or repeated event cannot leave it moving
+  int dir = (int)((app->keys_held >> down_key) & 1) - (int)((app->keys_held >> up_key) & 1);
+  rmp_vec2_set(&pad->vel, 0, app->pad_speed * dir);
+}
+
+static void handle_game_event(uint8_t event, rmp_app_t* app) {
+  switch (event) {
+    case RMP_KEYUP | RMP_EVENT_QUIT:
+      rmp_app_quit(app);
+      break;
+
+    case RMP_KEYUP | RMP_EVENT_PLAY_PAUSE:
+      app->paused = !app->paused;
+      break;
+
+    case RMP_KEYUP | RMP_EVENT_TOGGLE_AI:
+      app->ai_is_playing = !app->ai_is_playing;
+      if (!app->ai_is_playing) {
+        set_pad_vel(app, &app->pad_b, RMP_EVENT_PAD_B_UP, RMP_EVENT_PAD_B_DOWN);
+      }
+      break;
+
+    case RMP_KEYUP | RMP_EVENT_TOGGLE_RECAL:
+      app->recalibrating = !app->recalibrating;
+      break;
+
+    case RMP_KEYUP | RMP_EVENT_TOGGLE_MULTIBALL:
+      if (app->balls.count > 0) {
+        rmp_app_clear_balls(app);
+      }
+      else {
+        rmp_app_spawn_balls(app, RMP_CONFIG_MULTIBALL_COUNT);
+      }
+      break;
+
+    case RMP_KEYDOWN | RMP_EVENT_PAD_A_UP:
+    case RMP_KEYUP | RMP_EVENT_PAD_A_UP:
+    case RMP_KEYDOWN | RMP_EVENT_PAD_A_DOWN:
+    case RMP_KEYUP | RMP_EVENT_PAD_A_DOWN:
+      set_pad_vel(app, &app->pad_a, RMP_EVENT_PAD_A_UP, RMP_EVENT_PAD_A_DOWN);
+      break;
+
+    case RMP_KEYDOWN | RMP_EVENT_PAD_B_UP:
+    case RMP_KEYUP | RMP_EVENT_PAD_B_UP:
+    case RMP_KEYDOWN | RMP_EVENT_PAD_B_DOWN:
+    case RMP_KEYUP | RMP_EVENT_PAD_B_DOWN:
+      if (app->ai_is_playing) {
+        break;
+      };
+      set_pad_vel(app, &app->pad_b, RMP_EVENT_PAD_B_UP, RMP_EVENT_PAD_B_DOWN);
+      break;
+  }
+}
+
+static void handle_recal_event(uint8_t event, rmp_app_t* app) {
+  rmp_vec2_t v;
+  const int step = 5;
+
+  switch (event) {
+    case RMP_KEYUP | RMP_EVENT_RECAL_TL_LEFT:
+      rmp_vec2_set(&v, -step, 0);
+      rmp_vec2_add(&app->SCREEN_START, app->SCREEN_START, v);
+      break;
+
+    case RMP_KEYUP | RMP_EVENT_RECAL_TL_DOWN:
+      rmp_vec2_set(&v, 0, step);
+      rmp_vec2_add(&app->SCREEN_START, app->SCREEN_START, v);
+      break;
+
+    case RMP_KEYUP | RMP_EVENT_RECAL_TL_UP:
+      rmp_vec2_set(&v, 0, -step);
+      rmp_vec2_add(&app->SCREEN_START, app->SCREEN_START, v);
+      break;
+
+    case RMP_KEYUP | RMP_EVENT_RECAL_TL_RIGHT:
+      rmp_vec2_set(&v, step, 0);
+      rmp_vec2_add(&app->SCREEN_START, app->SCREEN_START, v);
+      break;
+
+    case RMP_KEYUP | RMP_EVENT_RECAL_BR_LEFT:
+      rmp_vec2_set(&v, -step, 0);
+      rmp_vec2_add(&app->SCREEN_END, app->SCREEN_END, v);
+      break;
+
+    case RMP_KEYUP | RMP_EVENT_RECAL_BR_DOWN:
+      rmp_vec2_set(&v, 0, step);
+      rmp_vec2_add(&app->SCREEN_END, app->SCREEN_END, v);
+      break;
+
+    case RMP_KEYUP | RMP_EVENT_RECAL_BR_UP:
+      rmp_vec2_set(&v, 0, -step);
+      rmp_vec2_add(&app->SCREEN_END, app->SCREEN_END, v);
+      break;
+
+    case RMP_KEYUP | RMP_EVENT_RECAL_BR_RIGHT:
+      rmp_vec2_set(&v, step, 0);
+      rmp_vec2_add(&app->SCREEN_END, app->SCREEN_END, v);
+      break;
+
+    case RMP_KEYUP | RMP_EVENT_TOGGLE_RECAL:
+      app->recalibrating = !app->recalibrating;
+      rmp_app_recalibrate(app);
+      break;
+  }
+}
+
+static void wait_while_idle(rmp_app_t* app) {
+  // Announced before looking, so an event or a notify from here on still ends the wait. Input
+  // comes through the queue, the keypad never takes app->mutex to wake the sim
+  rmp_input_prepare_wait(&app->input);
+  pthread_mutex_lock(&app->mutex);
+  bool idle = rmp_app_is_running(app) && rmp_app_is_idle(app) &&
+              rmp_input_is_empty(&app->keyboard_input);
+  pthread_mutex_unlock(&app->mutex);
+
+  if (idle) {
+    rmp_input_wait(&app->input);
+  }
+  else {
+    rmp_input_cancel_wait(&app->input);
+  }
+}
@@ -0,0 +1,318 @@
+#include "rmp_batch.h"
+#include "rmp_app.h"
+#include "rmp_log.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <math.h>
+
+typedef struct {
+  rmp_batch_t* batch;
+  int begin;
+  int end;
+  int steps;
+  rmp_batchRet_e ret;
+} rmp_batch_worker_t;
+
+static void* run_worker(void* args);
+static void apply_params(rmp_app_t* app, const rmp_batch_params_t* params);
+static void load_match(const rmp_batch_t* batch, int i, rmp_app_t* app);
+static void store_match(rmp_batch_t* batch, int i, const rmp_app_t* app);
+static void move_pad_a(rmp_app_t* app, double speed);
+static void serve(const rmp_batch_params_t* params, uint32_t match_seed, int points,
+                  rmp_vec2_t* vel);
+static uint32_t mix_seed(uint32_t seed, uint32_t i);
+
+rmp_batchRet_e rmp_batch_params_from_app(rmp_batch_params_t* params, const rmp_app_t* app) {
+  if (!params || !app) {
+    return RMP_BATCH_BAD_ARGS;
+  }
+
+  params->screen_start = app->SCREEN_START;
+  params->screen_end = app->SCREEN_END;
+  params->pad_size = app->pad_size;
+  params->pad_padding = app->pad_padding;
+  params->pad_speed = app->pad_speed;
+  params->ball_size = app->ball_size;
+  params->serve_speed_min = fabs(app->ball.vel.x);
+  params->serve_speed_max = fabs(app->ball.vel.x) * 4;
+  params->opponent_speed = 0.6;
+
+  return RMP_BATCH_OK;
+}
+
+rmp_batchRet_e rmp_batch_init(rmp_batch_t* batch, const rmp_batch_params_t* params, int count,
+                              uint32_t seed) {
+  if (!batch || !params || count <= 0 || params->serve_speed_min <= 0 ||
+      params->serve_speed_max < params->serve_speed_min || params->opponent_speed < 0) {
+    return RMP_BATCH_BAD_ARGS;
+  }
+
+  memset(batch, 0, sizeof(*batch));
+  batch->count = count;
+  batch->seed = seed;
+  batch->params = *params;
+
+  batch->pad_a_y = malloc(count * sizeof(double));
+  batch->pad_b_y = malloc(count * sizeof(double));
+  batch->ball_x = malloc(count * sizeof(double));
+  batch->ball_y = malloc(count * sizeof(double));
+  batch->ball_vx = malloc(count * sizeof(double));
+  batch->ball_vy = malloc(count * sizeof(double));
+  batch->rng_state = malloc(count * sizeof(uint32_t));
+  batch->score_a = malloc(count * sizeof(int));
+  batch->score_b = malloc(count * sizeof(int));
+
+  if (!batch->pad_a_y || !batch->pad_b_y || !batch->ball_x || !batch->ball_y ||
+      !batch->ball_vx || !batch->ball_vy || !batch->rng_state ||
+      !batch->score_a || !batch->score_b) {
+    rmp_log_error("batch", "Failed to allocate %d matches\n", count);
+    rmp_batch_free(batch);
+    return RMP_BATCH_BAD_INIT;
+  }
+
+  // Pads level in the middle and the ball in the centre, where rmp_app_init puts them
+  double width = params->screen_end.x - params->screen_start.x;
+  double height = params->screen_end.y - params->screen_start.y;
+  int pad_y = params->screen_start.y + (height / 2.0 - params->pad_size.y / 2.0);
+  int ball_x = params->screen_start.x + (width / 2.0 - params->ball_size / 2.0);
+  int ball_y = params->screen_start.y + (height / 2.0 - params->ball_size / 2.0);
+
+  // Every match serves with its own direction, slope and speed
+  for (int i = 0; i < count; ++i) {
+    uint32_t match_seed = mix_seed(seed, i);
+    rmp_vec2_t vel;
+    serve(params, match_seed, 0, &vel);
+
+    batch->pad_a_y[i] = pad_y;
+    batch->pad_b_y[i] = pad_y;
+    batch->ball_x[i] = ball_x;
+    batch->ball_y[i] = ball_y;
+    batch->ball_vx[i] = vel.x;
+    batch->ball_vy[i] = vel.y;
+    batch->rng_state[i] = match_seed ? match_seed : 1;
+    batch->score_a[i] = 0;
+    batch->score_b[i] = 0;
+  }
+
+  return RMP_BATCH_OK;
+}
+
+rmp_batchRet_e rmp_batch_free(rmp_batch_t* batch) {
+  if (!batch) {
+    return RMP_BATCH_BAD_ARGS;
+  }
+
+  free(batch->pad_a_y);
+  free(batch->pad_b_y);
+  free(batch->ball_x);
+  free(batch->ball_y);
+  free(batch->ball_vx);
+  free(batch->ball_vy);
+  free(batch->rng_state);
+  free(batch->score_a);
+  free(batch->score_b);
+  memset(batch, 0, sizeof(*batch));
+
+  return RMP_BATCH_OK;
+}
+
+rmp_batchRet_e rmp_batch_run(rmp_batch_t* batch, int steps, int threads) {
+  if (!batch || steps < 0 || threads <= 0) {
+    return RMP_BATCH_BAD_ARGS;
+  }
+
+  if (threads > batch->count) {
+    threads = batch->count;
+  }
+
+  pthread_t* tids = malloc(threads * sizeof(pthread_t));
+  rmp_batch_worker_t* workers = malloc(threads * sizeof(rmp_batch_worker_t));
+  if (!tids || !workers) {
+    free(tids);
+    free(workers);
+    return RMP_BATCH_BAD_INIT;
+  }
+
+  // Contiguous partitions, matches never interact so the result is independent of the split
+  rmp_batchRet_e ret = RMP_BATCH_OK;
+  int started = 0;
+  for (int t = 0; t < threads; ++t) {
+    workers[t].batch = batch;
+    workers[t].begin = (int)((long)batch->count * t / threads);
+    workers[t].end = (int)((long)batch->count * (t + 1) / threads);
+    workers[t].steps = steps;
+    workers[t].ret = RMP_BATCH_OK;
+
+    if (pthread_create(&tids[t], NULL, run_worker, &workers[t]) != 0) {
+      rmp_log_error("batch", "Failed to create worker thread\n");
+      ret = RMP_BATCH_BAD_INIT;
+      break;
+    }
+    ++started;
+  }
+
+  for (int t = 0; t < started; ++t) {
+    pthread_join(tids[t], NULL);
+    if (workers[t].ret != RMP_BATCH_OK) {
+      ret = workers[t].ret;
+    }
+  }
+
+  free(tids);
+  free(workers);
+  return ret;
+}
+
+void rmp_batch_summarize(const rmp_batch_t* batch, rmp_batch_result_t* result) {
+  if (!batch || !result) {
+    return;
+  }
+
+  memset(result, 0, sizeof(*result));
+
+  for (int i = 0; i < batch->count; ++i) {
+    result->score_a += batch->score_a[i];
+    result->score_b += batch->score_b[i];
+    if (batch->score_a[i] > batch->score_b[i]) {
+      result->wins_a++;
+    }
+    else if (batch->score_b[i] > batch->score_a[i]) {
+      result->wins_b++;
+    }
+    else {
+      result->draws++;
+    }
+  }
+
+  size_t size = batch->count * sizeof(double);
+  uint64_t hash = RMP_APP_HASH_SEED;
+  hash = rmp_app_hash_bytes(hash, batch->ball_x, size);
+  hash = rmp_app_hash_bytes(hash, batch->ball_y, size);
+  hash = rmp_app_hash_bytes(hash, batch->pad_a_y, size);
+  hash = rmp_app_hash_bytes(hash, batch->pad_b_y, size);
+  hash = rmp_app_hash_bytes(hash, batch->score_a, batch->count * sizeof(int));
+  hash = rmp_app_hash_bytes(hash, batch->score_b, batch->count * sizeof(int));
+  result->checksum = hash;
+}
+
+static void* run_worker(void* args) {
+  rmp_batch_worker_t* worker = (rmp_batch_worker_t*)args;
+  rmp_batch_t* batch = worker->batch;
+
+  // Scratch app per worker with its own locks and queues, and no extra balls or recording, so
+  // workers share nothing. Each match is loaded into it, stepped and written back
+  rmp_app_t app;
+  if (rmp_app_init(&app) != RMP_APP_OK) {
+    worker->ret = RMP_BATCH_BAD_INIT;
+    return NULL;
+  }
+  apply_params(&app, &batch->params);
+
+  for (int i = worker->begin; i < worker->end; ++i) {
+    uint32_t match_seed = mix_seed(batch->seed, i);
+    load_match(batch, i, &app);
+
+    for (int s = 0; s < worker->steps; ++s) {
+      int points = app.score_a + app.score_b;
+      move_pad_a(&app, batch->params.pad_speed * batch->params.opponent_speed);
+      rmp_app_step(&app);
+
+      // A point puts the ball back in the centre, serve it again
+      if (app.score_a + app.score_b != points) {
+        serve(&batch->params, match_seed, app.score_a + app.score_b, &app.ball.vel);
+        rmp_app_invalidate_prediction(&app);
+      }
+    }
+
+    store_match(batch, i, &app);
+  }
+
+  rmp_app_free(&app);
+  return NULL;
+}
+
+static void apply_params(rmp_app_t* app, const rmp_batch_params_t* params) {
+  app->paused = false;
+  app->recalibrating = false;
+  app->ai_is_playing = true;
+
+  app->SCREEN_START = params->screen_start;
+  app->SCREEN_END = params->screen_end;
+  app->pad_size = params->pad_size;
+  app->pad_padding = params->pad_padding;
+  app->pad_speed = params->pad_speed;
+  app->ball_size = params->ball_size;
+
+  app->pad_a.size = params->pad_size;
+  app->pad_b.size = params->pad_size;
+  app->pad_a.pos.x = params->screen_start.x + params->pad_padding;
+  app->pad_b.pos.x = params->screen_end.x - params->pad_padding - params->pad_size.x;
+  rmp_vec2_set(&app->ball.size, params->ball_size, params->ball_size);
+}
+
+static void load_match(const rmp_batch_t* batch, int i, rmp_app_t* app) {
+  app->pad_a.pos.y = batch->pad_a_y[i];
+  app->pad_b.pos.y = batch->pad_b_y[i];
+  rmp_vec2_set(&app->pad_a.vel, 0, 0);
+  rmp_vec2_set(&app->pad_b.vel, 0, 0);
+  rmp_vec2_set(&app->ball.pos, batch->ball_x[i], batch->ball_y[i]);
+  rmp_vec2_set(&app->ball.vel, batch->ball_vx[i], batch->ball_vy[i]);
+  app->rng_state = batch->rng_state[i];
+  app->score_a = batch->score_a[i];
+  app->score_b = batch->score_b[i];
+  rmp_app_invalidate_prediction(app);
+}
+
+static void store_match(rmp_batch_t* batch, int i, const rmp_app_t* app) {
+  batch->pad_a_y[i] = app->pad_a.pos.y;
+  batch->pad_b_y[i] = app->pad_b.pos.y;
+  batch->ball_x[i] = app->ball.pos.x;
+  batch->ball_y[i] = app->ball.pos.y;
+  batch->ball_vx[i] = app->ball.vel.x;
+  batch->ball_vy[i] = app->ball.vel.y;
+  batch->rng_state[i] = app->rng_state;
+  batch->score_a[i] = app->score_a;
+  batch->score_b[i] = app->score_b;
+}
+
+static void move_pad_a(rmp_app_t* app, double speed) {
+  // Ball follower standing in for the human player
+  double ball_center = app->ball.pos.y + app->ball.size.y / 2.0;
+  double pad_center = app->pad_a.pos.y + app->pad_a.size.y / 2.0;
+  double dead_zone = app->pad_a.size.y * 0.25;
+
+  if (ball_center < pad_center - dead_zone) {
+    rmp_vec2_set(&app->pad_a.vel, 0, -speed);
+  }
+  else if (ball_center > pad_center + dead_zone) {
+    rmp_vec2_set(&app->pad_a.vel, 0, speed);
+  }
+  else {
+    rmp_vec2_set(&app->pad_a.vel, 0, 0);
+  }
+}
+
+static void serve(const rmp_batch_params_t* params, uint32_t match_seed, int points,
+                  rmp_vec2_t* vel) {
+  // Direction, slope and speed all come from the match and how many points it has played, so a
+  // match serves the same way whichever worker runs it
+  uint32_t hash = mix_seed(match_seed, points);
+  double range = params->serve_speed_max - params->serve_speed_min;
+  double speed = params->serve_speed_min + range * (hash >> 8) / 16777216.0;
+  double slope = 1 / 3.0 + ((hash >> 2) & 63) / 64.0;
+
+  rmp_vec2_set(vel, (hash & 1) ? speed : -speed, ((hash & 2) ? 1 : -1) * speed * slope);
+}
+
+static uint32_t mix_seed(uint32_t seed, uint32_t i) {
+  uint32_t x = seed + i * 0x9e3779b9u;
+  x ^= x >> 16;
+  x *= 0x85ebca6bu;
+  x ^= x >> 13;
+  x *= 0xc2b2ae35u;
+  x ^= x >> 16;
+  return x;
+}
@@ -0,0 +1,344 @@
+#include "rmp_capture.h"
+#include "rmp_log.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+static void* writer_run(void* args);
+static void apply_patch(rmp_capture_t* capture, const rmp_capture_slot_t* slot);
+static void write_frame(rmp_capture_t* capture, const rmp_capture_slot_t* slot);
+static void write_ppm(rmp_capture_t* capture, const rmp_capture_slot_t* slot);
+static void write_y4m(rmp_capture_t* capture, const rmp_capture_slot_t* slot);
+static void write_delta(rmp_capture_t* capture, const rmp_capture_slot_t* slot);
+static bool ends_with(const char* str, const char* suffix);
+
+rmp_captureRet_e rmp_capture_init(rmp_capture_t* capture, const char* path, int width, int height,
+                                  int refresh_hz, int slots) {
+  if (!capture || !path || width <= 0 || height <= 0 || refresh_hz <= 0 || slots < 1 ||
+      slots > RMP_CAPTURE_MAX_SLOTS) {
+    return RMP_CAPTURE_BAD_ARGS;
+  }
+
+  memset(capture, 0, sizeof(*capture));
+  if (ends_with(path, ".y4m")) {
+    capture->format = RMP_CAPTURE_Y4M;
+  }
+  else if (ends_with(path, ".rmpd")) {
+    capture->format = RMP_CAPTURE_DELTA;
+  }
+  else if (strchr(path, '%')) {
+    capture->format = RMP_CAPTURE_PPM;
+  }
+  else {
+    rmp_log_error("capture", "%s is not a .y4m, .rmpd or numbered .ppm path\n", path);
+    return RMP_CAPTURE_BAD_ARGS;
+  }
+
+  capture->path = path;
+  capture->width = width;
+  capture->height = height;
+  capture->refresh_hz = refresh_hz;
+  capture->slot_count = slots;
+
+  // Everything the render thread touches is allocated up front, a slot fits a whole frame
+  size_t frame_size = (size_t)width * height;
+  bool ok = true;
+  for (int i = 0; i < slots; ++i) {
+    capture->slots[i].pixels = malloc(frame_size * sizeof(uint32_t));
+    ok = ok && capture->slots[i].pixels;
+  }
+  capture->image = calloc(frame_size, sizeof(uint32_t));
+  ok = ok && capture->image;
+  if (capture->format == RMP_CAPTURE_Y4M) {
+    capture->scratch = malloc(frame_size * 3);
+    ok = ok && capture->scratch;
+  }
+  else if (capture->format == RMP_CAPTURE_PPM) {
+    capture->scratch = malloc((size_t)width * 3);
+    ok = ok && capture->scratch;
+  }
+
+  if (ok && capture->format != RMP_CAPTURE_PPM) {
+    capture->file = fopen(path, "wb");
+    if (!capture->file) {
+      rmp_log_error("capture", "Failed to open %s\n", path);
+    }
+    ok = capture->file != NULL;
+  }
+
+  if (!ok) {
+    rmp_capture_free(capture);
+    return RMP_CAPTURE_BAD_INIT;
+  }
+
+  if (capture->format == RMP_CAPTURE_Y4M) {
+    capture->stats.bytes += fprintf(capture->file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444\n",
+                                    width, height, refresh_hz);
+  }
+  else if (capture->format == RMP_CAPTURE_DELTA) {
+    uint32_t header[3] = {0x444d5052, (uint32_t)width, (uint32_t)height};
+    capture->stats.bytes += fwrite(header, 1, sizeof(header), capture->file);
+  }
+
+  atomic_init(&capture->head, 0);
+  atomic_init(&capture->tail, 0);
+  atomic_init(&capture->stopping, false);
+  capture->resync = true;
+  sem_init(&capture->ready, 0, 0);
+
+  if (pthread_create(&capture->writer, NULL, writer_run, capture) != 0) {
+    rmp_log_error("capture", "Failed to create writer thread\n");
+    sem_destroy(&capture->ready);
+    rmp_capture_free(capture);
+    return RMP_CAPTURE_BAD_INIT;
+  }
+  capture->running = true;
+
+  rmp_log_info("capture", "Capturing %dx%d frames to %s\n", width, height, path);
+  return RMP_CAPTURE_OK;
+}
+
+rmp_captureRet_e rmp_capture_free(rmp_capture_t* capture) {
+  if (!capture) {
+    return RMP_CAPTURE_BAD_ARGS;
+  }
+
+  // The writer drains whatever is still queued before it exits
+  if (capture->running) {
+    atomic_store(&capture->stopping, true);
+    sem_post(&capture->ready);
+    pthread_join(capture->writer, NULL);
+    sem_destroy(&capture->ready);
+    capture->running = false;
+  }
+
+  if (capture->file) {
+    fclose(capture->file);
+    capture->file = NULL;
+  }
+
+  for (int i = 0; i < RMP_CAPTURE_MAX_SLOTS; ++i) {
+    free(capture->slots[i].pixels);
+    capture->slots[i].pixels = NULL;
+  }
+  free(capture->image);
+  free(capture->scratch);
+  capture->image = NULL;
+  capture->scratch = NULL;
+
+  return RMP_CAPTURE_OK;
+}
+
+bool rmp_capture_push(rmp_capture_t* capture, const rmp_fb_t* frame, const rmp_rect_t* damage,
+                      int count, unsigned long number) {
+  if (!capture || !frame || !frame->pixels) {
+    return false;
+  }
+
+  unsigned long head = atomic_load_explicit(&capture->head, memory_order_relaxed);
+  unsigned long tail = atomic_load_explicit(&capture->tail, memory_order_acquire);
+  if (head - tail >= (unsigned long)capture->slot_count || frame->width != capture->width ||
+      frame->height != capture->height) {
+    // The writer's image missed this change, only a whole frame brings it back
+    capture->stats.dropped++;
+    capture->resync = true;
+    return false;
+  }
+
+  rmp_capture_slot_t* slot = &capture->slots[head % capture->slot_count];
+  slot->frame = number;
+  slot->rect_count = 0;
+
+  if (capture->resync || !damage) {
+    slot->rects[slot->rect_count++] = (rmp_rect_t){0, 0, capture->width, capture->height};
+    capture->resync = false;
+  }
+  else if (count > RMP_CAPTURE_MAX_RECTS) {
+    int x0 = damage[0].x, y0 = damage[0].y;
+    int x1 = x0 + damage[0].width, y1 = y0 + damage[0].height;
+    for (int i = 1; i < count; ++i) {
+      x0 = damage[i].x < x0 ? damage[i].x : x0;
+      y0 = damage[i].y < y0 ? damage[i].y : y0;
+      x1 = damage[i].x + damage[i].width > x1 ? damage[i].x + damage[i].width : x1;
+      y1 = damage[i].y + damage[i].height > y1 ? damage[i].y + damage[i].height : y1;
+    }
+    slot->rects[slot->rect_count++] = (rmp_rect_t){x0, y0, x1 - x0, y1 - y0};
+  }
+  else {
+    memcpy(slot->rects, damage, count * sizeof(damage[0]));
+    slot->rect_count = count;
+  }
+
+  // Rect rows packed one after another, in rect order and always as RGBA8888
+  uint32_t* dst = slot->pixels;
+  for (int i = 0; i < slot->rect_count; ++i) {
+    const rmp_rect_t* rect = &slot->rects[i];
+    for (int r = 0; r < rect->height; ++r, dst += rect->width) {
+      rmp_fb_read_row(frame, rect->x, rect->y + r, rect->width, dst);
+    }
+  }
+
+  atomic_store_explicit(&capture->head, head + 1, memory_order_release);
+  sem_post(&capture->ready);
+  capture->stats.captured++;
+  return true;
+}
+
+int rmp_capture_pending(rmp_capture_t* capture) {
+  if (!capture) {
+    return 0;
+  }
+
+  return (int)(atomic_load(&capture->head) - atomic_load(&capture->tail));
+}
+
+void rmp_capture_log_stats(const rmp_capture_t* capture) {
+  if (!capture) {
+    return;
+  }
+
+  const rmp_capture_stats_t* stats = &capture->stats;
+  rmp_log_info("capture", "Frame capture to %s\n", capture->path);
+  printf("    frames  : %lu captured, %lu dropped, %lu written\n",
+         stats->captured, stats->dropped, stats->written);
+  printf("    bytes   : %llu (%.1f per frame)\n",
+         stats->bytes, stats->written ? (double)stats->bytes / stats->written : 0.0);
+}
+
+static void* writer_run(void* args) {
+  rmp_capture_t* capture = (rmp_capture_t*)args;
+
+  while (true) {
+    if (sem_wait(&capture->ready) != 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+
+    unsigned long tail = atomic_load_explicit(&capture->tail, memory_order_relaxed);
+    unsigned long head = atomic_load_explicit(&capture->head, memory_order_acquire);
+    if (tail == head) {
+      if (atomic_load(&capture->stopping)) {
+        break;
+      }
+      continue;
+    }
+
+    const rmp_capture_slot_t* slot = &capture->slots[tail % capture->slot_count];
+    apply_patch(capture, slot);
+    write_frame(capture, slot);
+    atomic_store_explicit(&capture->tail, tail + 1, memory_order_release);
+  }
+
+  return NULL;
+}
+
+static void apply_patch(rmp_capture_t* capture, const rmp_capture_slot_t* slot) {
+  const uint32_t* src = slot->pixels;
+  for (int i = 0; i < slot->rect_count; ++i) {
+    const rmp_rect_t* rect = &slot->rects[i];
+    uint32_t* dst = capture->image + (size_t)rect->y * capture->width + rect->x;
+    for (int r = 0; r < rect->height; ++r, dst += capture->width, src += rect->width) {
+      memcpy(dst, src, rect->width * sizeof(uint32_t));
+    }
+  }
+}
+
+static void write_frame(rmp_capture_t* capture, const rmp_capture_slot_t* slot) {
+  switch (capture->format) {
+    case RMP_CAPTURE_PPM:
+      write_ppm(capture, slot);
+      break;
+    case RMP_CAPTURE_Y4M:
+      write_y4m(capture, slot);
+      break;
+    case RMP_CAPTURE_DELTA:
+      write_delta(capture, slot);
+      break;
+  }
+
+  capture->last_frame = slot->frame;
+  capture->has_prev = true;
+  capture->stats.written++;
+}
+
+static void write_ppm(rmp_capture_t* capture, const rmp_capture_slot_t* slot) {
+  char name[512];
+  snprintf(name, sizeof(name), capture->path, slot->frame);
+
+  FILE* file = fopen(name, "wb");
+  if (!file) {
+    rmp_log_error("capture", "Failed to open %s\n", name);
+    return;
+  }
+
+  capture->stats.bytes += fprintf(file, "P6\n%d %d\n255\n", capture->width, capture->height);
+  for (int r = 0; r < capture->height; ++r) {
+    const uint32_t* row = capture->image + (size_t)r * capture->width;
+    uint8_t* rgb = capture->scratch;
+    for (int c = 0; c < capture->width; ++c) {
+      *rgb++ = (row[c] >> 16) & 0xff;
+      *rgb++ = (row[c] >> 8) & 0xff;
+      *rgb++ = row[c] & 0xff;
+    }
+    capture->stats.bytes += fwrite(capture->scratch, 1, (size_t)capture->width * 3, file);
+  }
+
+  fclose(file);
+}
+
+static void write_y4m(rmp_capture_t* capture, const rmp_capture_slot_t* slot) {
+  size_t plane = (size_t)capture->width * capture->height;
+
+  // Y4M has a fixed rate, vblanks without a new frame show the last one again
+  if (capture->has_prev) {
+    for (unsigned long f = capture->last_frame + 1; f < slot->frame; ++f) {
+      capture->stats.bytes += fwrite("FRAME\n", 1, 6, capture->file);
+      capture->stats.bytes += fwrite(capture->scratch, 1, plane * 3, capture->file);
+    }
+  }
+
+  // BT.601 studio swing
+  uint8_t* y = capture->scratch;
+  uint8_t* u = y + plane;
+  uint8_t* v = u + plane;
+  for (size_t i = 0; i < plane; ++i) {
+    int r = (capture->image[i] >> 16) & 0xff;
+    int g = (capture->image[i] >> 8) & 0xff;
+    int b = capture->image[i] & 0xff;
+    y[i] = (uint8_t)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+    u[i] = (uint8_t)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+    v[i] = (uint8_t)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+  }
+
+  capture->stats.bytes += fwrite("FRAME\n", 1, 6, capture->file);
+  capture->stats.bytes += fwrite(capture->scratch, 1, plane * 3, capture->file);
+}
+
+static void write_delta(rmp_capture_t* capture, const rmp_capture_slot_t* slot) {
+  // The patch already is the delta against the previous frame, one span per rect row
+  uint32_t header[2] = {(uint32_t)slot->frame, 0};
+  for (int i = 0; i < slot->rect_count; ++i) {
+    header[1] += slot->rects[i].height;
+  }
+  capture->stats.bytes += fwrite(header, 1, sizeof(header), capture->file);
+
+  const uint32_t* src = slot->pixels;
+  for (int i = 0; i < slot->rect_count; ++i) {
+    const rmp_rect_t* rect = &slot->rects[i];
+    for (int r = 0; r < rect->height; ++r, src += rect->width) {
+      uint32_t span[3] = {(uint32_t)rect->x, (uint32_t)(rect->y + r), (uint32_t)rect->width};
+      capture->stats.bytes += fwrite(span, 1, sizeof(span), capture->file);
+      capture->stats.bytes += fwrite(src, sizeof(uint32_t), rect->width, capture->file) *
+                              sizeof(uint32_t);
+    }
+  }
+}
+
+static bool ends_with(const char* str, const char* suffix) {
+  size_t len = strlen(str);
+  size_t suffix_len = strlen(suffix);
+  return len >= suffix_len && strcmp(str + len - suffix_len, suffix) == 0;
+}
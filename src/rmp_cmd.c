@@ -0,0 +1,254 @@
+#include "rmp_cmd.h"
+#include "rmp_log.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+
+// Sort keys hold a command index in their low 16 bits
+#define RMP_CMD_MAX_CAPACITY 0xffff
+
+#define RMP_CMD_INSERTION_SORT 32
+
+static unsigned long push_cmd(rmp_cmd_list_t* list, int layer, rmp_rect_t rect, uint32_t color,
+                              const void* src, int src_stride);
+static void sort_cmds(rmp_cmd_list_t* list);
+static int merge_cmds(rmp_cmd_list_t* list);
+static void index_by_top(rmp_cmd_list_t* list);
+static void radix_sort(uint64_t* keys, uint64_t* spare, int count, int bits);
+
+rmp_cmdRet_e rmp_cmd_list_init(rmp_cmd_list_t* list, int capacity) {
+  if (!list || capacity <= 0 || capacity > RMP_CMD_MAX_CAPACITY) {
+    return RMP_CMD_BAD_ARGS;
+  }
+
+  memset(list, 0, sizeof(*list));
+  list->cmds = malloc(capacity * sizeof(list->cmds[0]));
+  list->by_top = malloc(capacity * sizeof(list->by_top[0]));
+  list->active = malloc(capacity * sizeof(list->active[0]));
+  list->keys = malloc(capacity * sizeof(list->keys[0]));
+  list->keys_spare = malloc(capacity * sizeof(list->keys_spare[0]));
+  list->cmds_spare = malloc(capacity * sizeof(list->cmds_spare[0]));
+  if (!list->cmds || !list->by_top || !list->active || !list->keys || !list->keys_spare ||
+      !list->cmds_spare) {
+    rmp_log_error("cmd", "Failed to allocate %d commands\n", capacity);
+    rmp_cmd_list_free(list);
+    return RMP_CMD_BAD_INIT;
+  }
+
+  list->capacity = capacity;
+  return RMP_CMD_OK;
+}
+
+rmp_cmdRet_e rmp_cmd_list_free(rmp_cmd_list_t* list) {
+  if (!list) {
+    return RMP_CMD_BAD_ARGS;
+  }
+
+  free(list->cmds);
+  free(list->by_top);
+  free(list->active);
+  free(list->keys);
+  free(list->keys_spare);
+  free(list->cmds_spare);
+  list->cmds = NULL;
+  list->by_top = NULL;
+  list->active = NULL;
+  list->keys = NULL;
+  list->keys_spare = NULL;
+  list->cmds_spare = NULL;
+  list->count = 0;
+  list->capacity = 0;
+
+  return RMP_CMD_OK;
+}
+
+void rmp_cmd_list_reset(rmp_cmd_list_t* list, int width, int height, int pixel_bytes) {
+  if (!list) {
+    return;
+  }
+
+  list->count = 0;
+  list->width = MIN(width, RMP_CMD_MAX_SIZE);
+  list->height = MIN(height, RMP_CMD_MAX_SIZE);
+  list->pixel_bytes = pixel_bytes;
+}
+
+unsigned long rmp_cmd_fill(rmp_cmd_list_t* list, int layer, rmp_rect_t rect, uint32_t color) {
+  return push_cmd(list, layer, rect, color, NULL, 0);
+}
+
+unsigned long rmp_cmd_blit(rmp_cmd_list_t* list, int layer, rmp_rect_t rect, const void* src,
+                           int src_stride) {
+  if (!src) {
+    return 0;
+  }
+
+  return push_cmd(list, layer, rect, 0, src, src_stride);
+}
+
+void rmp_cmd_list_finish(rmp_cmd_list_t* list) {
+  if (!list) {
+    return;
+  }
+
+  // Layer order first, then top to bottom and left to right so neighbours can be merged
+  sort_cmds(list);
+  list->count = merge_cmds(list);
+  index_by_top(list);
+
+  list->stats.submitted += list->count;
+}
+
+static unsigned long push_cmd(rmp_cmd_list_t* list, int layer, rmp_rect_t rect, uint32_t color,
+                              const void* src, int src_stride) {
+  if (!list || list->count >= list->capacity || layer < 0 || layer >= RMP_CMD_MAX_LAYERS) {
+    return 0;
+  }
+
+  int x0 = MAX(rect.x, 0);
+  int y0 = MAX(rect.y, 0);
+  int x1 = MIN(rect.x + rect.width, list->width);
+  int y1 = MIN(rect.y + rect.height, list->height);
+  if (x0 >= x1 || y0 >= y1) {
+    return 0;
+  }
+
+  rmp_cmd_t* cmd = &list->cmds[list->count];
+  cmd->rect = (rmp_rect_t){x0, y0, x1 - x0, y1 - y0};
+  cmd->color = color;
+  cmd->layer = (uint16_t)layer;
+
+  // A blit clipped on the top or left starts further into its source
+  size_t skipped = (size_t)(y0 - rect.y) * src_stride + (x0 - rect.x);
+  cmd->src = src ? (const uint8_t*)src + skipped * list->pixel_bytes : NULL;
+  cmd->src_stride = src_stride;
+
+  list->count++;
+  list->stats.pushed++;
+  return (unsigned long)cmd->rect.width * cmd->rect.height;
+}
+
+static void sort_cmds(rmp_cmd_list_t* list) {
+  // Sort key above the position in the list, a stable radix sort on it keeps the list order of
+  // equal keys and leaves the position to gather the commands with
+  for (int i = 0; i < list->count; ++i) {
+    const rmp_cmd_t* cmd = &list->cmds[i];
+    uint64_t key = ((uint64_t)cmd->layer << 28) | ((uint64_t)cmd->rect.y << 14) | cmd->rect.x;
+    list->keys[i] = (key << 16) | (uint64_t)i;
+  }
+  radix_sort(list->keys, list->keys_spare, list->count, 32);
+
+  for (int i = 0; i < list->count; ++i) {
+    list->cmds_spare[i] = list->cmds[list->keys[i] & RMP_CMD_MAX_CAPACITY];
+  }
+
+  rmp_cmd_t* sorted = list->cmds_spare;
+  list->cmds_spare = list->cmds;
+  list->cmds = sorted;
+}
+
+static int merge_cmds(rmp_cmd_list_t* list) {
+  int out = 0;
+
+  for (int i = 0; i < list->count; ++i) {
+    rmp_cmd_t* cmd = &list->cmds[i];
+    rmp_cmd_t* last = out > 0 ? &list->cmds[out - 1] : NULL;
+
+    // Blits carry their own pixels, only solid fills merge
+    if (last && last->layer == cmd->layer && last->color == cmd->color && !last->src &&
+        !cmd->src) {
+      rmp_rect_t* a = &last->rect;
+      rmp_rect_t* b = &cmd->rect;
+
+      // Covered by the previous fill
+      if (b->x >= a->x && b->y >= a->y && b->x + b->width <= a->x + a->width &&
+          b->y + b->height <= a->y + a->height) {
+        continue;
+      }
+
+      // Same rows, touching or overlapping along x
+      if (b->y == a->y && b->height == a->height && b->x <= a->x + a->width) {
+        a->width = MAX(a->x + a->width, b->x + b->width) - a->x;
+        continue;
+      }
+
+      // Same columns, touching or overlapping along y
+      if (b->x == a->x && b->width == a->width && b->y <= a->y + a->height) {
+        a->height = MAX(a->y + a->height, b->y + b->height) - a->y;
+        continue;
+      }
+    }
+
+    list->cmds[out++] = *cmd;
+  }
+
+  return out;
+}
+
+static void index_by_top(rmp_cmd_list_t* list) {
+  // By first row, commands starting on the same one stay in list order
+  for (int i = 0; i < list->count; ++i) {
+    list->keys[i] = ((uint64_t)list->cmds[i].rect.y << 16) | (uint64_t)i;
+  }
+  radix_sort(list->keys, list->keys_spare, list->count, 14);
+
+  for (int i = 0; i < list->count; ++i) {
+    list->by_top[i] = (int)(list->keys[i] & RMP_CMD_MAX_CAPACITY);
+  }
+}
+
+static void radix_sort(uint64_t* keys, uint64_t* spare, int count, int bits) {
+  // Short lists, the usual frame, are done before the histograms would even be cleared. The
+  // position bits make every key unique, so this is as stable as the radix passes
+  if (count <= RMP_CMD_INSERTION_SORT) {
+    for (int i = 1; i < count; ++i) {
+      uint64_t key = keys[i];
+      int j = i;
+      for (; j > 0 && keys[j - 1] > key; --j) {
+        keys[j] = keys[j - 1];
+      }
+      keys[j] = key;
+    }
+    return;
+  }
+
+  // LSD over the bytes of the key above the 16 bit position. All histograms come from one read of
+  // the keys, and bytes every key shares are skipped
+  int passes = (bits + 7) / 8;
+  int counts[4][256] = {{0}};
+  for (int i = 0; i < count; ++i) {
+    for (int p = 0; p < passes; ++p) {
+      counts[p][(keys[i] >> (16 + 8 * p)) & 0xff]++;
+    }
+  }
+
+  uint64_t* src = keys;
+  uint64_t* dst = spare;
+  for (int p = 0; p < passes && count > 0; ++p) {
+    int shift = 16 + 8 * p;
+    if (counts[p][(src[0] >> shift) & 0xff] == count) {
+      continue;
+    }
+
+    int offset = 0;
+    for (int b = 0; b < 256; ++b) {
+      int n = counts[p][b];
+      counts[p][b] = offset;
+      offset += n;
+    }
+    for (int i = 0; i < count; ++i) {
+      dst[counts[p][(src[i] >> shift) & 0xff]++] = src[i];
+    }
+
+    uint64_t* swap = src;
+    src = dst;
+    dst = swap;
+  }
+
+  if (src != keys) {
+    memcpy(keys, src, count * sizeof(keys[0]));
+  }
+}
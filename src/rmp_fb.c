@@ -0,0 +1,495 @@
+#include "rmp_fb.h"
+#include "rmp_log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define RMP_FB_SIMD_NAME "avx2"
+#define RMP_FB_LANES 8
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define RMP_FB_SIMD_NAME "sse2"
+#define RMP_FB_LANES 4
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define RMP_FB_SIMD_NAME "neon"
+#define RMP_FB_LANES 4
+#else
+#define RMP_FB_SIMD_NAME "scalar"
+#define RMP_FB_LANES 1
+#endif
+
+// 16 bit pixels per vector
+#define RMP_FB_LANES16 (RMP_FB_LANES * 2)
+
+// Rows per band of rmp_fb_draw, a 1080p band of 16 rows is 120 KiB and stays in L2
+#define RMP_FB_BAND_ROWS 16
+
+#define MIN(a, b) (( (a) < (b) ) ? (a) : (b))
+#define MAX(a, b) (( (a) > (b) ) ? (a) : (b))
+
+static void* pixel_at(const rmp_fb_t* fb, int x, int y);
+static void fill_row(const rmp_fb_t* fb, void* dst, int count, uint32_t color);
+static void draw_rows(rmp_fb_t* fb, const rmp_cmd_t* cmd, int x0, int x1, int y0, int y1);
+static int fill_simd(uint32_t* dst, int count, uint32_t color);
+static int fill_simd16(uint16_t* dst, int count, uint16_t color);
+static int double_simd(uint32_t* dst, const uint32_t* src, int count);
+static int double_simd16(uint16_t* dst, const uint16_t* src, int count);
+
+rmp_fbRet_e rmp_fb_init(rmp_fb_t* fb, int width, int height, rmp_fb_format_e format) {
+  if (!fb || width <= 0 || height <= 0 ||
+      (format != RMP_FB_RGBA8888 && format != RMP_FB_RGB565)) {
+    return RMP_FB_BAD_ARGS;
+  }
+
+  int bytes = rmp_fb_bytes_per_pixel(format);
+  const int row_pixels = RMP_FB_ROW_ALIGN / bytes;
+  fb->width = width;
+  fb->height = height;
+  fb->stride = (width + row_pixels - 1) / row_pixels * row_pixels;
+  fb->format = format;
+
+  size_t size = (size_t)fb->stride * height * bytes;
+  fb->pixels = aligned_alloc(RMP_FB_ROW_ALIGN, size);
+  if (!fb->pixels) {
+    rmp_log_error("fb", "Failed to allocate %dx%d framebuffer\n", width, height);
+    return RMP_FB_BAD_INIT;
+  }
+
+  memset(fb->pixels, 0, size);
+  return RMP_FB_OK;
+}
+
+rmp_fbRet_e rmp_fb_free(rmp_fb_t* fb) {
+  if (!fb) {
+    return RMP_FB_BAD_ARGS;
+  }
+
+  free(fb->pixels);
+  fb->pixels = NULL;
+
+  return RMP_FB_OK;
+}
+
+void rmp_fb_clear(rmp_fb_t* fb, uint32_t color) {
+  if (!fb || !fb->pixels) return;
+
+  // Padding included, the whole buffer is one contiguous span
+  fill_row(fb, fb->pixels, fb->stride * fb->height, color);
+}
+
+void rmp_fb_fill_rect(rmp_fb_t* fb, int x, int y, int width, int height, uint32_t color) {
+  if (!fb || !fb->pixels) return;
+
+  int x0 = MAX(x, 0);
+  int y0 = MAX(y, 0);
+  int x1 = MIN(x + width, fb->width);
+  int y1 = MIN(y + height, fb->height);
+  if (x0 >= x1 || y0 >= y1) return;
+
+  for (int r = y0; r < y1; ++r) {
+    fill_row(fb, pixel_at(fb, x0, r), x1 - x0, color);
+  }
+}
+
+void rmp_fb_fill_span(uint32_t* dst, int count, uint32_t color) {
+  if (!dst || count <= 0) return;
+
+  for (int i = fill_simd(dst, count, color); i < count; ++i) {
+    dst[i] = color;
+  }
+}
+
+void rmp_fb_fill_span16(uint16_t* dst, int count, uint16_t color) {
+  if (!dst || count <= 0) return;
+
+  for (int i = fill_simd16(dst, count, color); i < count; ++i) {
+    dst[i] = color;
+  }
+}
+
+uint32_t rmp_fb_pack(rmp_fb_format_e format, uint32_t argb) {
+  if (format != RMP_FB_RGB565) {
+    return argb;
+  }
+
+  // Alpha is dropped, every pixel of the format is opaque
+  return ((argb >> 8) & 0xf800) | ((argb >> 5) & 0x07e0) | ((argb >> 3) & 0x001f);
+}
+
+uint32_t rmp_fb_unpack(rmp_fb_format_e format, uint32_t pixel) {
+  if (format != RMP_FB_RGB565) {
+    return pixel;
+  }
+
+  // Top bits repeated into the bottom ones so white stays white and packing again is exact
+  uint32_t r = (pixel >> 11) & 0x1f;
+  uint32_t g = (pixel >> 5) & 0x3f;
+  uint32_t b = pixel & 0x1f;
+  r = (r << 3) | (r >> 2);
+  g = (g << 2) | (g >> 4);
+  b = (b << 3) | (b >> 2);
+
+  return 0xff000000 | (r << 16) | (g << 8) | b;
+}
+
+int rmp_fb_bytes_per_pixel(rmp_fb_format_e format) {
+  return format == RMP_FB_RGB565 ? 2 : 4;
+}
+
+const char* rmp_fb_format_name(rmp_fb_format_e format) {
+  return format == RMP_FB_RGB565 ? "rgb565" : "rgba8888";
+}
+
+rmp_fbRet_e rmp_fb_parse_format(const char* name, rmp_fb_format_e* format) {
+  if (!name || !format) {
+    return RMP_FB_BAD_ARGS;
+  }
+
+  if (strcmp(name, "rgba8888") == 0) {
+    *format = RMP_FB_RGBA8888;
+  }
+  else if (strcmp(name, "rgb565") == 0) {
+    *format = RMP_FB_RGB565;
+  }
+  else {
+    return RMP_FB_BAD_ARGS;
+  }
+
+  return RMP_FB_OK;
+}
+
+void rmp_fb_read_row(const rmp_fb_t* fb, int x, int y, int count, uint32_t* dst) {
+  if (!fb || !fb->pixels || !dst || count <= 0) return;
+
+  if (fb->format == RMP_FB_RGBA8888) {
+    memcpy(dst, pixel_at(fb, x, y), count * sizeof(uint32_t));
+    return;
+  }
+
+  const uint16_t* src = pixel_at(fb, x, y);
+  for (int i = 0; i < count; ++i) {
+    dst[i] = rmp_fb_unpack(fb->format, src[i]);
+  }
+}
+
+void rmp_fb_draw(rmp_fb_t* fb, const rmp_cmd_list_t* list) {
+  if (!fb || !fb->pixels || !list) return;
+
+  // One pass down the buffer in bands of rows, every band is finished by all the commands covering
+  // it while it is still in cache. Active commands are kept in layer order so later layers paint
+  // over earlier ones
+  rmp_cmd_t* active = list->active;
+  int active_count = 0;
+  int next = 0;
+  int band = 0;
+
+  while (next < list->count || active_count > 0) {
+    // Skip the bands no command touches
+    if (active_count == 0) {
+      band = list->cmds[list->by_top[next]].rect.y / RMP_FB_BAND_ROWS * RMP_FB_BAND_ROWS;
+    }
+    int band_end = band + RMP_FB_BAND_ROWS;
+
+    while (next < list->count && list->cmds[list->by_top[next]].rect.y < band_end) {
+      const rmp_cmd_t* cmd = &list->cmds[list->by_top[next++]];
+      int slot = active_count++;
+      while (slot > 0 && active[slot - 1].layer > cmd->layer) {
+        active[slot] = active[slot - 1];
+        --slot;
+      }
+      active[slot] = *cmd;
+    }
+
+    int kept = 0;
+    for (int a = 0; a < active_count; ++a) {
+      const rmp_cmd_t* cmd = &active[a];
+      draw_rows(fb, cmd, cmd->rect.x, cmd->rect.x + cmd->rect.width,
+                MAX(cmd->rect.y, band), MIN(cmd->rect.y + cmd->rect.height, band_end));
+
+      if (cmd->rect.y + cmd->rect.height > band_end) {
+        active[kept++] = *cmd;
+      }
+    }
+    active_count = kept;
+    band = band_end;
+  }
+}
+
+void rmp_fb_draw_cmd(rmp_fb_t* fb, const rmp_cmd_t* cmd, rmp_rect_t clip) {
+  if (!fb || !fb->pixels || !cmd) return;
+
+  int x0 = MAX(cmd->rect.x, clip.x);
+  int y0 = MAX(cmd->rect.y, clip.y);
+  int x1 = MIN(cmd->rect.x + cmd->rect.width, clip.x + clip.width);
+  int y1 = MIN(cmd->rect.y + cmd->rect.height, clip.y + clip.height);
+  if (x0 >= x1 || y0 >= y1) return;
+
+  draw_rows(fb, cmd, x0, x1, y0, y1);
+}
+
+void rmp_fb_upscale(rmp_fb_t* dst, const rmp_fb_t* src, rmp_rect_t rect, int scale_x, int scale_y) {
+  if (!dst || !dst->pixels || !src || !src->pixels || scale_x < 1 || scale_y < 1 ||
+      dst->format != src->format) return;
+
+  int x0 = MAX(rect.x, 0);
+  int y0 = MAX(rect.y, 0);
+  int x1 = MIN(MIN(rect.x + rect.width, src->width), dst->width / scale_x);
+  int y1 = MIN(MIN(rect.y + rect.height, src->height), dst->height / scale_y);
+  if (x0 >= x1 || y0 >= y1) return;
+
+  // Each source row is widened once, the copies below it are plain row copies
+  size_t bytes = rmp_fb_bytes_per_pixel(dst->format);
+  size_t row_bytes = (size_t)dst->stride * bytes;
+  size_t width_bytes = (size_t)(x1 - x0) * scale_x * bytes;
+  for (int r = y0; r < y1; ++r) {
+    const void* in = pixel_at(src, x0, r);
+    uint8_t* out = pixel_at(dst, x0 * scale_x, r * scale_y);
+
+    if (scale_x == 1) {
+      memcpy(out, in, width_bytes);
+    }
+    else if (dst->format == RMP_FB_RGB565) {
+      const uint16_t* in16 = in;
+      uint16_t* out16 = (uint16_t*)out;
+      int i = scale_x == 2 ? double_simd16(out16, in16, x1 - x0) : 0;
+      for (; i < x1 - x0; ++i) {
+        for (int k = 0; k < scale_x; ++k) {
+          out16[i * scale_x + k] = in16[i];
+        }
+      }
+    }
+    else {
+      const uint32_t* in32 = in;
+      uint32_t* out32 = (uint32_t*)out;
+      int i = scale_x == 2 ? double_simd(out32, in32, x1 - x0) : 0;
+      for (; i < x1 - x0; ++i) {
+        for (int k = 0; k < scale_x; ++k) {
+          out32[i * scale_x + k] = in32[i];
+        }
+      }
+    }
+
+    for (int k = 1; k < scale_y; ++k) {
+      memcpy(out + k * row_bytes, out, width_bytes);
+    }
+  }
+}
+
+uint64_t rmp_fb_hash(const rmp_fb_t* fb) {
+  if (!fb || !fb->pixels) {
+    return 0;
+  }
+
+  uint32_t* row = malloc(fb->width * sizeof(uint32_t));
+  if (!row) {
+    return 0;
+  }
+
+  // FNV-1a over the visible pixels only, padding is not part of the image
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (int r = 0; r < fb->height; ++r) {
+    rmp_fb_read_row(fb, 0, r, fb->width, row);
+    const uint8_t* bytes = (const uint8_t*)row;
+    for (size_t i = 0; i < (size_t)fb->width * sizeof(uint32_t); ++i) {
+      hash ^= bytes[i];
+      hash *= 0x100000001b3ull;
+    }
+  }
+
+  free(row);
+  return hash;
+}
+
+rmp_fbRet_e rmp_fb_write_ppm(const rmp_fb_t* fb, const char* path) {
+  if (!fb || !fb->pixels || !path) {
+    return RMP_FB_BAD_ARGS;
+  }
+
+  FILE* file = fopen(path, "wb");
+  if (!file) {
+    rmp_log_error("fb", "Failed to open %s\n", path);
+    return RMP_FB_BAD_INIT;
+  }
+
+  fprintf(file, "P6\n%d %d\n255\n", fb->width, fb->height);
+  for (int r = 0; r < fb->height; ++r) {
+    for (int c = 0; c < fb->width; ++c) {
+      uint32_t pixel;
+      rmp_fb_read_row(fb, c, r, 1, &pixel);
+      uint8_t rgb[3] = {(pixel >> 16) & 0xff, (pixel >> 8) & 0xff, pixel & 0xff};
+      fwrite(rgb, 1, sizeof(rgb), file);
+    }
+  }
+
+  fclose(file);
+  return RMP_FB_OK;
+}
+
+const char* rmp_fb_simd_name(void) {
+  return RMP_FB_SIMD_NAME;
+}
+
+static void* pixel_at(const rmp_fb_t* fb, int x, int y) {
+  size_t offset = (size_t)y * fb->stride + x;
+  return (uint8_t*)fb->pixels + offset * rmp_fb_bytes_per_pixel(fb->format);
+}
+
+static void fill_row(const rmp_fb_t* fb, void* dst, int count, uint32_t color) {
+  if (fb->format == RMP_FB_RGB565) {
+    rmp_fb_fill_span16(dst, count, (uint16_t)color);
+  }
+  else {
+    rmp_fb_fill_span(dst, count, color);
+  }
+}
+
+// Columns x0 to x1 of rows y0 to y1 of cmd, which must cover them
+static void draw_rows(rmp_fb_t* fb, const rmp_cmd_t* cmd, int x0, int x1, int y0, int y1) {
+  size_t bytes = rmp_fb_bytes_per_pixel(fb->format);
+  size_t row_bytes = (size_t)fb->stride * bytes;
+  int width = x1 - x0;
+
+  uint8_t* row = pixel_at(fb, x0, y0);
+  if (cmd->src) {
+    size_t src_bytes = (size_t)cmd->src_stride * bytes;
+    const uint8_t* src = (const uint8_t*)cmd->src + (size_t)(y0 - cmd->rect.y) * src_bytes +
+                         (size_t)(x0 - cmd->rect.x) * bytes;
+    for (int r = y0; r < y1; ++r, row += row_bytes, src += src_bytes) {
+      memcpy(row, src, width * bytes);
+    }
+  }
+  else if (fb->format == RMP_FB_RGB565) {
+    for (int r = y0; r < y1; ++r, row += row_bytes) {
+      uint16_t* dst = (uint16_t*)row;
+      for (int i = fill_simd16(dst, width, cmd->color); i < width; ++i) {
+        dst[i] = (uint16_t)cmd->color;
+      }
+    }
+  }
+  else {
+    for (int r = y0; r < y1; ++r, row += row_bytes) {
+      uint32_t* dst = (uint32_t*)row;
+      for (int i = fill_simd(dst, width, cmd->color); i < width; ++i) {
+        dst[i] = cmd->color;
+      }
+    }
+  }
+}
+
+// Stores whole vectors and returns where the scalar tail starts
+static int fill_simd(uint32_t* dst, int count, uint32_t color) {
+  int i = 0;
+#if defined(__AVX2__)
+  __m256i value = _mm256_set1_epi32((int)color);
+  for (; i + RMP_FB_LANES <= count; i += RMP_FB_LANES) {
+    _mm256_storeu_si256((__m256i*)(dst + i), value);
+  }
+#elif defined(__SSE2__)
+  __m128i value = _mm_set1_epi32((int)color);
+  for (; i + RMP_FB_LANES <= count; i += RMP_FB_LANES) {
+    _mm_storeu_si128((__m128i*)(dst + i), value);
+  }
+#elif defined(__ARM_NEON)
+  uint32x4_t value = vdupq_n_u32(color);
+  for (; i + RMP_FB_LANES <= count; i += RMP_FB_LANES) {
+    vst1q_u32(dst + i, value);
+  }
+#else
+  (void)dst;
+  (void)count;
+  (void)color;
+#endif
+  return i;
+}
+
+static int fill_simd16(uint16_t* dst, int count, uint16_t color) {
+  int i = 0;
+#if defined(__AVX2__)
+  __m256i value = _mm256_set1_epi16((short)color);
+  for (; i + RMP_FB_LANES16 <= count; i += RMP_FB_LANES16) {
+    _mm256_storeu_si256((__m256i*)(dst + i), value);
+  }
+#elif defined(__SSE2__)
+  __m128i value = _mm_set1_epi16((short)color);
+  for (; i + RMP_FB_LANES16 <= count; i += RMP_FB_LANES16) {
+    _mm_storeu_si128((__m128i*)(dst + i), value);
+  }
+#elif defined(__ARM_NEON)
+  uint16x8_t value = vdupq_n_u16(color);
+  for (; i + RMP_FB_LANES16 <= count; i += RMP_FB_LANES16) {
+    vst1q_u16(dst + i, value);
+  }
+#else
+  (void)dst;
+  (void)count;
+  (void)color;
+#endif
+  return i;
+}
+
+// Writes every source pixel twice and returns where the scalar tail starts
+static int double_simd(uint32_t* dst, const uint32_t* src, int count) {
+  int i = 0;
+#if defined(__AVX2__)
+  const __m256i lo = _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3);
+  const __m256i hi = _mm256_setr_epi32(4, 4, 5, 5, 6, 6, 7, 7);
+  for (; i + RMP_FB_LANES <= count; i += RMP_FB_LANES) {
+    __m256i value = _mm256_loadu_si256((const __m256i*)(src + i));
+    _mm256_storeu_si256((__m256i*)(dst + 2 * i), _mm256_permutevar8x32_epi32(value, lo));
+    _mm256_storeu_si256((__m256i*)(dst + 2 * i + RMP_FB_LANES),
+                        _mm256_permutevar8x32_epi32(value, hi));
+  }
+#elif defined(__SSE2__)
+  for (; i + RMP_FB_LANES <= count; i += RMP_FB_LANES) {
+    __m128i value = _mm_loadu_si128((const __m128i*)(src + i));
+    _mm_storeu_si128((__m128i*)(dst + 2 * i), _mm_unpacklo_epi32(value, value));
+    _mm_storeu_si128((__m128i*)(dst + 2 * i + RMP_FB_LANES), _mm_unpackhi_epi32(value, value));
+  }
+#elif defined(__ARM_NEON)
+  for (; i + RMP_FB_LANES <= count; i += RMP_FB_LANES) {
+    uint32x4_t value = vld1q_u32(src + i);
+    uint32x4x2_t pair = {{value, value}};
+    vst2q_u32(dst + 2 * i, pair);
+  }
+#else
+  (void)dst;
+  (void)src;
+  (void)count;
+#endif
+  return i;
+}
+
+static int double_simd16(uint16_t* dst, const uint16_t* src, int count) {
+  int i = 0;
+#if defined(__AVX2__)
+  for (; i + RMP_FB_LANES16 <= count; i += RMP_FB_LANES16) {
+    // Unpacking works inside 128 bit lanes, so the quarters are put in lane order first
+    __m256i value = _mm256_loadu_si256((const __m256i*)(src + i));
+    value = _mm256_permute4x64_epi64(value, 0xd8);
+    _mm256_storeu_si256((__m256i*)(dst + 2 * i), _mm256_unpacklo_epi16(value, value));
+    _mm256_storeu_si256((__m256i*)(dst + 2 * i + RMP_FB_LANES16),
+                        _mm256_unpackhi_epi16(value, value));
+  }
+#elif defined(__SSE2__)
+  for (; i + RMP_FB_LANES16 <= count; i += RMP_FB_LANES16) {
+    __m128i value = _mm_loadu_si128((const __m128i*)(src + i));
+    _mm_storeu_si128((__m128i*)(dst + 2 * i), _mm_unpacklo_epi16(value, value));
+    _mm_storeu_si128((__m128i*)(dst + 2 * i + RMP_FB_LANES16), _mm_unpackhi_epi16(value, value));
+  }
+#elif defined(__ARM_NEON)
+  for (; i + RMP_FB_LANES16 <= count; i += RMP_FB_LANES16) {
+    uint16x8_t value = vld1q_u16(src + i);
+    uint16x8x2_t pair = {{value, value}};
+    vst2q_u16(dst + 2 * i, pair);
+  }
+#else
+  (void)dst;
+  (void)src;
+  (void)count;
+#endif
+  return i;
+}
@@ -0,0 +1,88 @@
+#include "rmp_grid.h"
+#include "rmp_log.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+rmp_gridRet_e rmp_grid_init(rmp_grid_t* grid, rmp_vec2_t start, rmp_vec2_t end, double cell_size,
+                            int capacity) {
+  if (!grid || cell_size <= 0 || capacity < 0) {
+    return RMP_GRID_BAD_ARGS;
+  }
+
+  memset(grid, 0, sizeof(*grid));
+  grid->origin = start;
+  grid->cell_size = cell_size;
+  grid->cols = (int)ceil((end.x - start.x) / cell_size);
+  grid->rows = (int)ceil((end.y - start.y) / cell_size);
+  grid->cols = grid->cols > 0 ? grid->cols : 1;
+  grid->rows = grid->rows > 0 ? grid->rows : 1;
+  grid->capacity = capacity;
+
+  int cells = grid->cols * grid->rows;
+  grid->cell_start = malloc((cells + 1) * sizeof(int));
+  grid->cell_count = malloc(cells * sizeof(int));
+  grid->items = malloc((capacity > 0 ? capacity : 1) * sizeof(int));
+  grid->item_cell = malloc((capacity > 0 ? capacity : 1) * sizeof(int));
+
+  if (!grid->cell_start || !grid->cell_count || !grid->items || !grid->item_cell) {
+    rmp_log_error("grid", "Failed to allocate %dx%d grid\n", grid->cols, grid->rows);
+    rmp_grid_free(grid);
+    return RMP_GRID_BAD_INIT;
+  }
+
+  return RMP_GRID_OK;
+}
+
+rmp_gridRet_e rmp_grid_free(rmp_grid_t* grid) {
+  if (!grid) {
+    return RMP_GRID_BAD_ARGS;
+  }
+
+  free(grid->cell_start);
+  free(grid->cell_count);
+  free(grid->items);
+  free(grid->item_cell);
+  memset(grid, 0, sizeof(*grid));
+
+  return RMP_GRID_OK;
+}
+
+rmp_gridRet_e rmp_grid_build(rmp_grid_t* grid, const float* x, const float* y, int count) {
+  if (!grid || count < 0 || count > grid->capacity) {
+    return RMP_GRID_BAD_ARGS;
+  }
+
+  int cells = grid->cols * grid->rows;
+  memset(grid->cell_count, 0, cells * sizeof(int));
+
+  for (int i = 0; i < count; ++i) {
+    int cell = rmp_grid_cell(grid, x[i], y[i]);
+    grid->item_cell[i] = cell;
+    grid->cell_count[cell]++;
+  }
+
+  // Prefix sum gives each cell its slice of items, then fill the slices in item order
+  grid->cell_start[0] = 0;
+  for (int c = 0; c < cells; ++c) {
+    grid->cell_start[c + 1] = grid->cell_start[c] + grid->cell_count[c];
+    grid->cell_count[c] = grid->cell_start[c];
+  }
+
+  for (int i = 0; i < count; ++i) {
+    grid->items[grid->cell_count[grid->item_cell[i]]++] = i;
+  }
+
+  return RMP_GRID_OK;
+}
+
+int rmp_grid_cell(const rmp_grid_t* grid, double x, double y) {
+  int col = (int)floor((x - grid->origin.x) / grid->cell_size);
+  int row = (int)floor((y - grid->origin.y) / grid->cell_size);
+
+  col = col < 0 ? 0 : (col >= grid->cols ? grid->cols - 1 : col);
+  row = row < 0 ? 0 : (row >= grid->rows ? grid->rows - 1 : row);
+
+  return row * grid->cols + col;
+}
@@ -0,0 +1,229 @@
+#include "rmp_hud.h"
+#include "rmp_log.h"
+#include "rmp_time.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RMP_HUD_TEXT_COLOR 0xff00ff00
+#define RMP_HUD_BACK_COLOR 0xff303030
+
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+
+// 5x7 glyphs, one byte per row with the leftmost pixel in bit 4. Only what the overlay prints
+typedef struct {
+  char c;
+  uint8_t rows[7];
+} rmp_hud_font_t;
+
+static const rmp_hud_font_t RMP_HUD_FONT[] = {
+  {' ', {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
+  {'-', {0x00, 0x00, 0x00, 0x1f, 0x00, 0x00, 0x00}},
+  {'.', {0x00, 0x00, 0x00, 0x00, 0x00, 0x0c, 0x0c}},
+  {'0', {0x0e, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0e}},
+  {'1', {0x04, 0x0c, 0x04, 0x04, 0x04, 0x04, 0x0e}},
+  {'2', {0x0e, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1f}},
+  {'3', {0x1f, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0e}},
+  {'4', {0x02, 0x06, 0x0a, 0x12, 0x1f, 0x02, 0x02}},
+  {'5', {0x1f, 0x10, 0x1e, 0x01, 0x01, 0x11, 0x0e}},
+  {'6', {0x06, 0x08, 0x10, 0x1e, 0x11, 0x11, 0x0e}},
+  {'7', {0x1f, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08}},
+  {'8', {0x0e, 0x11, 0x11, 0x0e, 0x11, 0x11, 0x0e}},
+  {'9', {0x0e, 0x11, 0x11, 0x0f, 0x01, 0x02, 0x0c}},
+  {'D', {0x1c, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1c}},
+  {'E', {0x1f, 0x10, 0x10, 0x1e, 0x10, 0x10, 0x1f}},
+  {'H', {0x11, 0x11, 0x11, 0x1f, 0x11, 0x11, 0x11}},
+  {'I', {0x0e, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0e}},
+  {'K', {0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11}},
+  {'M', {0x11, 0x1b, 0x15, 0x15, 0x11, 0x11, 0x11}},
+  {'N', {0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11}},
+  {'P', {0x1e, 0x11, 0x11, 0x1e, 0x10, 0x10, 0x10}},
+  {'R', {0x1e, 0x11, 0x11, 0x1e, 0x14, 0x12, 0x11}},
+  {'S', {0x0f, 0x10, 0x10, 0x0e, 0x01, 0x01, 0x1e}},
+  {'U', {0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0e}},
+  {'Y', {0x11, 0x11, 0x11, 0x0a, 0x04, 0x04, 0x04}},
+  {'Z', {0x1f, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1f}},
+};
+
+#define RMP_HUD_GLYPHS ((int)(sizeof(RMP_HUD_FONT) / sizeof(RMP_HUD_FONT[0])))
+
+static void rasterize(rmp_hud_t* hud, int glyph);
+static int find_glyph(char c);
+static time_t percentile(const rmp_hud_t* hud, int percent);
+static int compare_time(const void* a, const void* b);
+
+rmp_hudRet_e rmp_hud_init(rmp_hud_t* hud, rmp_fb_format_e format) {
+  if (!hud) {
+    return RMP_HUD_BAD_ARGS;
+  }
+
+  memset(hud, 0, sizeof(*hud));
+  hud->format = format;
+  hud->atlas_stride = RMP_HUD_GLYPHS * RMP_HUD_CELL_WIDTH;
+  hud->atlas = malloc((size_t)hud->atlas_stride * RMP_HUD_CELL_HEIGHT *
+                      rmp_fb_bytes_per_pixel(format));
+  if (!hud->atlas) {
+    rmp_log_error("hud", "Failed to allocate glyph atlas\n");
+    return RMP_HUD_BAD_INIT;
+  }
+
+  for (int g = 0; g < RMP_HUD_GLYPHS; ++g) {
+    rasterize(hud, g);
+  }
+
+  rmp_log_info("hud", "Rasterized %d glyphs into a %dx%d atlas\n", RMP_HUD_GLYPHS,
+               hud->atlas_stride, RMP_HUD_CELL_HEIGHT);
+  return RMP_HUD_OK;
+}
+
+rmp_hudRet_e rmp_hud_free(rmp_hud_t* hud) {
+  if (!hud) {
+    return RMP_HUD_BAD_ARGS;
+  }
+
+  free(hud->atlas);
+  hud->atlas = NULL;
+  hud->length = 0;
+
+  return RMP_HUD_OK;
+}
+
+void rmp_hud_record_frame(rmp_hud_t* hud, time_t render_us) {
+  if (!hud) {
+    return;
+  }
+
+  hud->samples[hud->sample_next] = render_us;
+  hud->sample_next = (hud->sample_next + 1) % RMP_HUD_SAMPLES;
+  if (hud->sample_count < RMP_HUD_SAMPLES) {
+    hud->sample_count++;
+  }
+  hud->window_frames++;
+}
+
+bool rmp_hud_update(rmp_hud_t* hud, time_t now_us, unsigned long generation,
+                    long input_latency_us) {
+  if (!hud || !hud->atlas) {
+    return false;
+  }
+
+  if (hud->window_start_us == 0) {
+    hud->window_start_us = now_us;
+    hud->window_generation = generation;
+    return false;
+  }
+
+  time_t elapsed_us = now_us - hud->window_start_us;
+  if (elapsed_us < RMP_HUD_UPDATE_US) {
+    return false;
+  }
+
+  time_t start_us = rmp_time_get_us();
+
+  // Clamped so the line keeps its width and the cells their places
+  double seconds = elapsed_us / 1e6;
+  unsigned long steps = generation - hud->window_generation;
+  unsigned long sim_hz = MIN((unsigned long)(steps / seconds + 0.5), 999ul);
+  unsigned long render_hz = MIN((unsigned long)(hud->window_frames / seconds + 0.5), 999ul);
+  double p99_ms = MIN(percentile(hud, 99) / 1000.0, 99.99);
+
+  char key[8] = "   --";
+  if (input_latency_us >= 0) {
+    snprintf(key, sizeof(key), "%5.1f", MIN(input_latency_us / 1000.0, 999.9));
+  }
+
+  char text[RMP_HUD_MAX_CHARS + 1];
+  snprintf(text, sizeof(text), "SIM %3lu RND %3lu P99 %5.2fMS KEY %sMS", sim_hz, render_hz,
+           p99_ms, key);
+
+  hud->window_start_us = now_us;
+  hud->window_generation = generation;
+  hud->window_frames = 0;
+
+  bool changed = strcmp(text, hud->text) != 0;
+  if (changed) {
+    memcpy(hud->text, text, sizeof(text));
+    hud->length = (int)strlen(text);
+    for (int i = 0; i < hud->length; ++i) {
+      hud->glyphs[i] = find_glyph(text[i]);
+    }
+  }
+
+  hud->stats.updates++;
+  hud->stats.update_total_us += rmp_time_get_us() - start_us;
+  return changed;
+}
+
+const void* rmp_hud_glyph(const rmp_hud_t* hud, int index) {
+  if (!hud || !hud->atlas || index < 0 || index >= hud->length) {
+    return NULL;
+  }
+
+  size_t offset = (size_t)hud->glyphs[index] * RMP_HUD_CELL_WIDTH;
+  return (const uint8_t*)hud->atlas + offset * rmp_fb_bytes_per_pixel(hud->format);
+}
+
+void rmp_hud_log_stats(const rmp_hud_t* hud) {
+  if (!hud) {
+    return;
+  }
+
+  const rmp_hud_stats_t* stats = &hud->stats;
+  rmp_log_info("hud", "Overlay\n");
+  printf("    text    : %s\n", hud->text);
+  printf("    updates : %lu (%.1f us avg)\n", stats->updates,
+         stats->updates ? stats->update_total_us / (double)stats->updates : 0.0);
+}
+
+static void rasterize(rmp_hud_t* hud, int glyph) {
+  // The glyph sits one column and one row into its cell, the rest is background so the cells of
+  // a line tile without gaps
+  uint32_t text = rmp_fb_pack(hud->format, RMP_HUD_TEXT_COLOR);
+  uint32_t back = rmp_fb_pack(hud->format, RMP_HUD_BACK_COLOR);
+  for (int y = 0; y < RMP_HUD_CELL_HEIGHT; ++y) {
+    int row = y / RMP_HUD_SCALE - 1;
+    for (int x = 0; x < RMP_HUD_CELL_WIDTH; ++x) {
+      int col = x / RMP_HUD_SCALE - 1;
+      bool on = row >= 0 && row < 7 && col >= 0 && col < 5 &&
+                (RMP_HUD_FONT[glyph].rows[row] >> (4 - col)) & 1;
+      size_t index = (size_t)y * hud->atlas_stride + glyph * RMP_HUD_CELL_WIDTH + x;
+      if (hud->format == RMP_FB_RGB565) {
+        ((uint16_t*)hud->atlas)[index] = (uint16_t)(on ? text : back);
+      }
+      else {
+        ((uint32_t*)hud->atlas)[index] = on ? text : back;
+      }
+    }
+  }
+}
+
+static int find_glyph(char c) {
+  for (int g = 0; g < RMP_HUD_GLYPHS; ++g) {
+    if (RMP_HUD_FONT[g].c == c) {
+      return g;
+    }
+  }
+
+  // Blank for anything the font does not have
+  return 0;
+}
+
+static time_t percentile(const rmp_hud_t* hud, int percent) {
+  if (hud->sample_count == 0) {
+    return 0;
+  }
+
+  time_t sorted[RMP_HUD_SAMPLES];
+  memcpy(sorted, hud->samples, hud->sample_count * sizeof(sorted[0]));
+  qsort(sorted, hud->sample_count, sizeof(sorted[0]), compare_time);
+
+  int index = (hud->sample_count * percent + 99) / 100 - 1;
+  return sorted[index < 0 ? 0 : index];
+}
+
+static int compare_time(const void* a, const void* b) {
+  time_t x = *(const time_t*)a;
+  time_t y = *(const time_t*)b;
+  return (x > y) - (x < y);
+}
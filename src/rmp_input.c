@@ -0,0 +1,103 @@
+#include "rmp_input.h"
+#include "rmp_log.h"
+
+#include <errno.h>
+
+rmp_inputRet_e rmp_input_init(rmp_input_t* input) {
+  if (!input) {
+    return RMP_INPUT_BAD_ARGS;
+  }
+
+  atomic_init(&input->head, 0);
+  input->pushed = 0;
+  input->dropped = 0;
+  atomic_init(&input->tail, 0);
+  atomic_init(&input->sleeping, false);
+
+  if (sem_init(&input->ready, 0, 0) != 0) {
+    rmp_log_error("input", "Failed to create the input semaphore\n");
+    return RMP_INPUT_BAD_INIT;
+  }
+
+  return RMP_INPUT_OK;
+}
+
+rmp_inputRet_e rmp_input_free(rmp_input_t* input) {
+  if (!input) {
+    return RMP_INPUT_BAD_ARGS;
+  }
+
+  sem_destroy(&input->ready);
+  return RMP_INPUT_OK;
+}
+
+bool rmp_input_push(rmp_input_t* input, uint8_t event, time_t time_us) {
+  unsigned long head = atomic_load_explicit(&input->head, memory_order_relaxed);
+  unsigned long tail = atomic_load_explicit(&input->tail, memory_order_acquire);
+  if (head - tail >= RMP_CONFIG_INPUT_QUEUE_SIZE) {
+    input->dropped++;
+    return false;
+  }
+
+  rmp_input_event_t* slot = &input->events[head % RMP_CONFIG_INPUT_QUEUE_SIZE];
+  slot->time_us = time_us;
+  slot->event = event;
+  input->pushed++;
+  atomic_store_explicit(&input->head, head + 1, memory_order_release);
+
+  // Pairs with the fence in rmp_input_prepare_wait: either the consumer sees this event before it
+  // sleeps or it is seen sleeping here
+  atomic_thread_fence(memory_order_seq_cst);
+  if (atomic_load_explicit(&input->sleeping, memory_order_relaxed)) {
+    rmp_input_wake(input);
+  }
+
+  return true;
+}
+
+bool rmp_input_pop(rmp_input_t* input, rmp_input_event_t* event) {
+  unsigned long tail = atomic_load_explicit(&input->tail, memory_order_relaxed);
+  unsigned long head = atomic_load_explicit(&input->head, memory_order_acquire);
+  if (tail == head) {
+    return false;
+  }
+
+  *event = input->events[tail % RMP_CONFIG_INPUT_QUEUE_SIZE];
+  atomic_store_explicit(&input->tail, tail + 1, memory_order_release);
+  return true;
+}
+
+bool rmp_input_is_empty(rmp_input_t* input) {
+  unsigned long tail = atomic_load_explicit(&input->tail, memory_order_relaxed);
+  return atomic_load_explicit(&input->head, memory_order_acquire) == tail;
+}
+
+void rmp_input_prepare_wait(rmp_input_t* input) {
+  atomic_store_explicit(&input->sleeping, true, memory_order_relaxed);
+  atomic_thread_fence(memory_order_seq_cst);
+}
+
+void rmp_input_wait(rmp_input_t* input) {
+  if (!rmp_input_is_empty(input)) {
+    rmp_input_cancel_wait(input);
+    return;
+  }
+
+  // Only a waker that cleared the flag posts, so the flag is down again once this returns
+  while (sem_wait(&input->ready) != 0 && errno == EINTR) {
+  }
+}
+
+void rmp_input_cancel_wait(rmp_input_t* input) {
+  // A waker that got to the flag first is about to post, take it so the next wait is not cut short
+  if (!atomic_exchange(&input->sleeping, false)) {
+    while (sem_wait(&input->ready) != 0 && errno == EINTR) {
+    }
+  }
+}
+
+void rmp_input_wake(rmp_input_t* input) {
+  if (atomic_exchange(&input->sleeping, false)) {
+    sem_post(&input->ready);
+  }
+}
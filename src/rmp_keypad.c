@@ -1,6 +1,9 @@
 #include "rmp_keypad.h"
 #include "rmp_log.h"
 #include "rmp_time.h"
+#include "rmp_event.h"
+#include "rmp_sched.h"
+#include "rmp_config.h"
 #include "external/rpi_gpio.h"
 
 #include <stdio.h>
@@ -11,52 +14,47 @@
 #include <pthread.h>
 #include <time.h>
 
+#if defined(__QNX__)
+#include <sys/neutrino.h>
+#else
+#include <fcntl.h>
+#include <poll.h>
+#endif
+
 #define RMP_KEYPAD_TARGET_FPS 60
 #define RMP_KEYPAD_FRAME_TIME_US (1000000 / RMP_KEYPAD_TARGET_FPS)
+#define RMP_KEYPAD_ALL_COLS 0xf
+
+// Settles up to this long are spun through, a sleep would oversleep them many times over
+#define RMP_KEYPAD_SPIN_MAX_US 200
+
+// The self-test tries settles from the shortest up, each must scan the same this many times
+#define RMP_KEYPAD_SETTLE_MAX_US 10000
+#define RMP_KEYPAD_CALIBRATE_SCANS 200
 
-#define RMP_KEYDOWN    0x10
-#define RMP_KEYUP      0x00
-
-#define RMP_KEY0       0x00
-#define RMP_KEY1       0x01
-#define RMP_KEY2       0x02
-#define RMP_KEY3       0x03
-#define RMP_KEY4       0x04
-#define RMP_KEY5       0x05
-#define RMP_KEY6       0x06
-#define RMP_KEY7       0x07
-#define RMP_KEY8       0x08
-#define RMP_KEY9       0x09
-#define RMP_KEYA       0x0a
-#define RMP_KEYB       0x0b
-#define RMP_KEYC       0x0c
-#define RMP_KEYD       0x0d
-#define RMP_KEYE       0x0e
-#define RMP_KEYF       0x0f
-
-#define RMP_EVENT_QUIT             RMP_KEY3
-#define RMP_EVENT_PLAY_PAUSE       RMP_KEYC
-#define RMP_EVENT_PAD_A_UP         RMP_KEY0
-#define RMP_EVENT_PAD_A_DOWN       RMP_KEY4
-#define RMP_EVENT_PAD_B_UP         RMP_KEYB
-#define RMP_EVENT_PAD_B_DOWN       RMP_KEYF
-#define RMP_EVENT_TOGGLE_AI        RMP_KEYD
-
-#define RMP_EVENT_TOGGLE_RECAL     RMP_KEYE
-#define RMP_EVENT_RECAL_TL_LEFT    RMP_KEY0
-#define RMP_EVENT_RECAL_TL_DOWN    RMP_KEY1
-#define RMP_EVENT_RECAL_TL_UP      RMP_KEY2
-#define RMP_EVENT_RECAL_TL_RIGHT   RMP_KEY3
-#define RMP_EVENT_RECAL_BR_LEFT    RMP_KEY4
-#define RMP_EVENT_RECAL_BR_DOWN    RMP_KEY5
-#define RMP_EVENT_RECAL_BR_UP      RMP_KEY6
-#define RMP_EVENT_RECAL_BR_RIGHT   RMP_KEY7
+// Upper bound on one idle wait, in case an edge or the wake on quit is lost
+#define RMP_KEYPAD_EDGE_TIMEOUT_US 1000000
+
+#if defined(__QNX__)
+// The GPIO client sends edges with the first available code and the column as value
+#define RMP_KEYPAD_PULSE_EDGE (_PULSE_CODE_MINAVAIL)
+#define RMP_KEYPAD_PULSE_WAKE (_PULSE_CODE_MINAVAIL + 1)
+#else
+#define RMP_KEYPAD_WAKE_ID 0xffffffffu
+#endif
 
 static rmp_keypadRet_e init_gpio(int rows[4], int cols[4]);
-static rmp_keypadRet_e scan_keypad(int rows[4], int cols[4], int keys[16]);
-static void handle_event(uint8_t event, rmp_app_t* app);
-static void handle_game_event(uint8_t event, rmp_app_t* app);
-static void handle_recal_event(uint8_t event, rmp_app_t* app);
+static rmp_keypadRet_e init_edges(rmp_keypad_t* keypad);
+static void read_row(rmp_keypad_t* keypad, int row);
+static void switch_row(rmp_keypad_t* keypad, int high, int low);
+static void settle(const rmp_keypad_t* keypad);
+static void scan_once(rmp_keypad_t* keypad);
+static unsigned read_cols(rmp_keypad_t* keypad);
+static void drive_rows(rmp_keypad_t* keypad, unsigned level);
+static bool keys_held(const rmp_keypad_t* keypad);
+static unsigned wait_for_edge(rmp_keypad_t* keypad);
+static unsigned receive_edges(rmp_keypad_t* keypad, time_t timeout_us);
+static void dispatch_changes(rmp_keypad_t* keypad);
 
 rmp_keypadRet_e rmp_keypad_init(rmp_keypad_t* keypad, rmp_app_t* app) {
   if (!keypad || !app) {
@@ -67,8 +65,32 @@ rmp_keypadRet_e rmp_keypad_init(rmp_keypad_t* keypad, rmp_app_t* app) {
   const int col_pins[4] = {12, 16, 20, 21};
 
   memset(keypad->keys, 0, sizeof(keypad->keys));
+  memset(keypad->scan_keys, 0, sizeof(keypad->scan_keys));
+  keypad->settle_us = RMP_CONFIG_KEYPAD_SETTLE_US;
+  keypad->scan_row = -1;
+  keypad->scan_cols = RMP_KEYPAD_ALL_COLS;
+  keypad->next_scan_us = rmp_time_get_us();
+  keypad->scan_due_us = keypad->next_scan_us;
+  keypad->scan_start_us = keypad->next_scan_us;
+  memset(&keypad->probe, 0, sizeof(keypad->probe));
   memcpy(keypad->row_pins, row_pins, sizeof(keypad->row_pins));
   memcpy(keypad->col_pins, col_pins, sizeof(keypad->col_pins));
+  keypad->row_mask = 0;
+  keypad->col_mask = 0;
+  for (int i = 0; i < 4; ++i) {
+    keypad->row_mask |= 1u << row_pins[i];
+    keypad->col_mask |= 1u << col_pins[i];
+  }
+  keypad->edge_wait = false;
+  keypad->edge_armed = false;
+#if defined(__QNX__)
+  keypad->chid = -1;
+  keypad->coid = -1;
+#else
+  keypad->event_fds[0] = -1;
+  keypad->event_fds[1] = -1;
+#endif
+  memset(&keypad->stats, 0, sizeof(keypad->stats));
 
   rmp_keypadRet_e ret = init_gpio(keypad->row_pins, keypad->col_pins);
   if (ret != RMP_KEYPAD_OK) {
@@ -94,6 +116,175 @@ rmp_keypadRet_e rmp_keypad_init(rmp_keypad_t* keypad, rmp_app_t* app) {
   return RMP_KEYPAD_OK;
 }
 
+rmp_keypadRet_e rmp_keypad_free(rmp_keypad_t* keypad) {
+  if (!keypad) {
+    return RMP_KEYPAD_BAD_ARGS;
+  }
+
+  keypad->edge_wait = false;
+#if defined(__QNX__)
+  if (keypad->coid != -1) {
+    ConnectDetach(keypad->coid);
+  }
+  if (keypad->chid != -1) {
+    ChannelDestroy(keypad->chid);
+  }
+  keypad->chid = -1;
+  keypad->coid = -1;
+#else
+  for (int i = 0; i < 2; ++i) {
+    if (keypad->event_fds[i] != -1) {
+      close(keypad->event_fds[i]);
+    }
+    keypad->event_fds[i] = -1;
+  }
+#endif
+
+  return RMP_KEYPAD_OK;
+}
+
+rmp_keypadRet_e rmp_keypad_set_settle(rmp_keypad_t* keypad, time_t settle_us) {
+  if (!keypad || settle_us < 0 || settle_us > RMP_KEYPAD_SETTLE_MAX_US) {
+    return RMP_KEYPAD_BAD_ARGS;
+  }
+
+  keypad->settle_us = settle_us;
+  rmp_log_info("keypad", "Rows settle for %ld us, %s\n", (long)settle_us,
+               settle_us <= RMP_KEYPAD_SPIN_MAX_US ? "spinning" : "sleeping");
+  return RMP_KEYPAD_OK;
+}
+
+rmp_keypadRet_e rmp_keypad_calibrate(rmp_keypad_t* keypad, time_t* settle_us) {
+  if (!keypad || !settle_us || keypad->scan_row >= 0) {
+    return RMP_KEYPAD_BAD_ARGS;
+  }
+
+  static const time_t steps[] = {1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000,
+                                 RMP_KEYPAD_SETTLE_MAX_US};
+  const int step_count = (int)(sizeof(steps) / sizeof(steps[0]));
+  time_t saved = keypad->settle_us;
+
+  // The longest settle is taken as the truth, without a key down every settle reads the same
+  int reference[16];
+  keypad->settle_us = RMP_KEYPAD_SETTLE_MAX_US;
+  scan_once(keypad);
+  memcpy(reference, keypad->scan_keys, sizeof(reference));
+
+  int key = -1;
+  for (int i = 0; i < 16 && key < 0; ++i) {
+    key = reference[i] ? i : -1;
+  }
+  if (key < 0) {
+    rmp_log_error("keypad", "Hold a key down for the self-test\n");
+    memset(keypad->scan_keys, 0, sizeof(keypad->scan_keys));
+    keypad->settle_us = saved;
+    return RMP_KEYPAD_BAD_INIT;
+  }
+
+  int stable = step_count - 1;
+  for (int s = 0; s < step_count - 1; ++s) {
+    keypad->settle_us = steps[s];
+    bool same = true;
+    for (int n = 0; n < RMP_KEYPAD_CALIBRATE_SCANS && same; ++n) {
+      scan_once(keypad);
+      same = memcmp(reference, keypad->scan_keys, sizeof(reference)) == 0;
+    }
+
+    rmp_log_info("keypad", "Settle %5ld us: %s\n", (long)steps[s], same ? "stable" : "unstable");
+    if (same) {
+      stable = s;
+      break;
+    }
+  }
+
+  // The key must still be down, or the shorter settles were measured against nothing
+  keypad->settle_us = RMP_KEYPAD_SETTLE_MAX_US;
+  scan_once(keypad);
+  bool held = memcmp(reference, keypad->scan_keys, sizeof(reference)) == 0;
+  memset(keypad->scan_keys, 0, sizeof(keypad->scan_keys));
+  keypad->settle_us = saved;
+  if (!held) {
+    rmp_log_error("keypad", "Key released during the self-test\n");
+    return RMP_KEYPAD_BAD_INIT;
+  }
+
+  *settle_us = steps[stable];
+  rmp_log_info("keypad", "Shortest stable settle is %ld us with key %d down\n", (long)*settle_us,
+               key);
+  return RMP_KEYPAD_OK;
+}
+
+rmp_keypadRet_e rmp_keypad_set_edge_wait(rmp_keypad_t* keypad, bool enabled) {
+  if (!keypad) {
+    return RMP_KEYPAD_BAD_ARGS;
+  }
+
+#if defined(__QNX__)
+  bool ready = keypad->chid != -1;
+#else
+  bool ready = keypad->event_fds[0] != -1;
+#endif
+  if (enabled && !ready) {
+    rmp_keypadRet_e ret = init_edges(keypad);
+    if (ret != RMP_KEYPAD_OK) {
+      return ret;
+    }
+  }
+
+  keypad->edge_wait = enabled;
+  rmp_log_info("keypad", "%s\n", enabled ? "Waiting for column edges while no key is down"
+                                         : "Scanning while no key is down");
+  return RMP_KEYPAD_OK;
+}
+
+rmp_keypadRet_e rmp_keypad_map_gpio(rmp_keypad_t* keypad) {
+  if (!keypad) {
+    return RMP_KEYPAD_BAD_ARGS;
+  }
+
+  if (rpi_gpio_map_registers() != GPIO_SUCCESS) {
+    rmp_log_error("keypad", "Failed to map the GPIO registers\n");
+    return RMP_KEYPAD_BAD_INIT;
+  }
+
+  rmp_log_info("keypad", "Scanning through the mapped GPIO registers\n");
+  return RMP_KEYPAD_OK;
+}
+
+void rmp_keypad_wake(rmp_keypad_t* keypad) {
+  if (!keypad) {
+    return;
+  }
+
+#if defined(__QNX__)
+  if (keypad->coid != -1) {
+    MsgSendPulse(keypad->coid, -1, RMP_KEYPAD_PULSE_WAKE, 0);
+  }
+#else
+  if (keypad->event_fds[1] != -1) {
+    unsigned id = RMP_KEYPAD_WAKE_ID;
+    ssize_t rc = write(keypad->event_fds[1], &id, sizeof(id));
+    (void)rc;
+  }
+#endif
+}
+
+void rmp_keypad_log_stats(const rmp_keypad_t* keypad) {
+  if (!keypad) {
+    return;
+  }
+
+  const rmp_keypad_stats_t* stats = &keypad->stats;
+  rmp_log_info("keypad", "Scanning\n");
+  printf("    scans     : %lu (%.1f us avg, %ld us max, %ld us settle)\n", stats->scans,
+         stats->scans ? stats->scan_total_us / (double)stats->scans : 0.0,
+         (long)stats->scan_max_us, (long)keypad->settle_us);
+  printf("    key downs : %lu (%.1f us avg, %ld us max to the game)\n", stats->keydowns,
+         stats->keydowns ? stats->keydown_total_us / (double)stats->keydowns : 0.0,
+         (long)stats->keydown_max_us);
+  printf("    edge waits: %lu (%lu woken by a key)\n", stats->edge_waits, stats->edge_wakes);
+}
+
 void* rmp_keypad_run(void* args) {
   if (!args) {
     return NULL;
@@ -103,34 +294,90 @@ void* rmp_keypad_run(void* args) {
   rmp_app_t* app = keypad->app;
 
   rmp_log_info("keypad", "Started keypad scan\n");
-  while (true) {
-    pthread_mutex_lock(&app->mutex);
-    if (!app->running) {
-      break;
+  time_t deadline = rmp_time_get_us();
+  while (rmp_app_is_running(app)) {
+    time_t now = rmp_time_get_us();
+    rmp_sched_probe_record(&keypad->probe, deadline, now);
+    atomic_fetch_add(&app->loop_wakeups, 1);
+
+    // Nothing to scan for until a column falls, the scan then starts right away
+    if (keypad->edge_wait && keypad->scan_row < 0 && !keys_held(keypad)) {
+      unsigned cols = wait_for_edge(keypad);
+      now = rmp_time_get_us();
+      if (!cols) {
+        deadline = now;
+        continue;
+      }
+
+      keypad->scan_cols = cols;
+      keypad->next_scan_us = now;
     }
-    pthread_mutex_unlock(&app->mutex);
 
-    time_t frame_start = rmp_time_get_us();
+    deadline = rmp_keypad_step(keypad, now);
+    rmp_time_sleep_until_us(deadline);
+  }
 
-    int old_keys[16];
-    memcpy(old_keys, keypad->keys, sizeof(old_keys));
-    scan_keypad(keypad->row_pins, keypad->col_pins, keypad->keys);
+  return NULL;
+}
 
-    for (int i = 0; i < 16; ++i) {
-      if (old_keys[i] != keypad->keys[i]) {
-        uint8_t event = (keypad->keys[i]) ? (RMP_KEYDOWN | i) : (RMP_KEYUP | i);
-        handle_event(event, app);
-      }
+time_t rmp_keypad_step(rmp_keypad_t* keypad, time_t now_us) {
+  if (!keypad) {
+    return now_us;
+  }
+
+  bool spin = keypad->settle_us <= RMP_KEYPAD_SPIN_MAX_US;
+
+  // Idle until the next scan is due, then drive the first row low and let it settle
+  if (keypad->scan_row < 0) {
+    if (now_us < keypad->next_scan_us) {
+      return keypad->next_scan_us;
     }
 
-    time_t frame_duration = rmp_time_get_us() - frame_start;
-    if (frame_duration < RMP_KEYPAD_FRAME_TIME_US) {
-      usleep(RMP_KEYPAD_FRAME_TIME_US - frame_duration);
+    keypad->scan_due_us = keypad->next_scan_us;
+    keypad->scan_start_us = now_us;
+    keypad->next_scan_us += RMP_KEYPAD_FRAME_TIME_US;
+    if (keypad->next_scan_us < now_us) {
+      keypad->next_scan_us = now_us;
     }
+
+    keypad->scan_row = 0;
+    switch_row(keypad, -1, 0);
+    if (!spin) {
+      return now_us + keypad->settle_us;
+    }
+    settle(keypad);
   }
-  pthread_mutex_unlock(&app->mutex);
 
-  return NULL;
+  while (true) {
+    read_row(keypad, keypad->scan_row);
+    if (++keypad->scan_row == 4) {
+      switch_row(keypad, 3, -1);
+      break;
+    }
+
+    // Releasing one row and driving the next is a single write
+    switch_row(keypad, keypad->scan_row - 1, keypad->scan_row);
+    if (!spin) {
+      return now_us + keypad->settle_us;
+    }
+    settle(keypad);
+  }
+
+  time_t end_us = spin ? rmp_time_get_us() : now_us;
+  time_t scan_us = end_us - keypad->scan_start_us;
+  keypad->stats.scans++;
+  keypad->stats.scan_total_us += scan_us;
+  if (scan_us > keypad->stats.scan_max_us) {
+    keypad->stats.scan_max_us = scan_us;
+  }
+
+  keypad->scan_row = -1;
+  keypad->scan_cols = RMP_KEYPAD_ALL_COLS;
+  dispatch_changes(keypad);
+  atomic_store_explicit(&keypad->app->input_latency_us, (long)(end_us - keypad->scan_due_us),
+                        memory_order_relaxed);
+
+  return keypad->next_scan_us > end_us ? keypad->next_scan_us : end_us;
 }
 
 static rmp_keypadRet_e init_gpio(int rows[4], int cols[4]) {
@@ -149,145 +396,214 @@ static rmp_keypadRet_e init_gpio(int rows[4], int cols[4]) {
   return RMP_KEYPAD_OK;
 }
 
-static rmp_keypadRet_e scan_keypad(int rows[4], int cols[4], int keys[16]) {
-  unsigned level;
+static rmp_keypadRet_e init_edges(rmp_keypad_t* keypad) {
+#if defined(__QNX__)
+  keypad->chid = ChannelCreate(_NTO_CHF_PRIVATE);
+  if (keypad->chid == -1) {
+    rmp_log_error("keypad", "Failed to create channel\n");
+    return RMP_KEYPAD_BAD_INIT;
+  }
 
-  for (int r = 0; r < 4; r++) {
-    rpi_gpio_output(rows[r], GPIO_LOW);
-    usleep(10000);
+  keypad->coid = ConnectAttach(0, 0, keypad->chid, _NTO_SIDE_CHANNEL, 0);
+  if (keypad->coid == -1) {
+    rmp_log_error("keypad", "Failed to attach to channel\n");
+    rmp_keypad_free(keypad);
+    return RMP_KEYPAD_BAD_INIT;
+  }
+  int coid = keypad->coid;
+#else
+  if (pipe(keypad->event_fds) == -1) {
+    rmp_log_error("keypad", "Failed to create event pipe\n");
+    keypad->event_fds[0] = -1;
+    keypad->event_fds[1] = -1;
+    return RMP_KEYPAD_BAD_INIT;
+  }
 
-    for (int c = 0; c < 4; c++) {
-      if (rpi_gpio_input(cols[c], &level) != 0) {
-        continue;
-      }
+  // Neither end may block, edges are written with the GPIO lock held
+  for (int i = 0; i < 2; ++i) {
+    fcntl(keypad->event_fds[i], F_SETFL, fcntl(keypad->event_fds[i], F_GETFL) | O_NONBLOCK);
+    fcntl(keypad->event_fds[i], F_SETFD, FD_CLOEXEC);
+  }
+  int coid = keypad->event_fds[1];
+#endif
 
-      keys[c * 4 + r] = (level == GPIO_LOW) ? 1 : 0;
+  for (int c = 0; c < 4; ++c) {
+    if (rpi_gpio_add_event_detect(keypad->col_pins[c], coid, GPIO_FALLING, c) != GPIO_SUCCESS) {
+      rmp_log_error("keypad", "Failed to detect edges on column pin %d\n", keypad->col_pins[c]);
+      rmp_keypad_free(keypad);
+      return RMP_KEYPAD_BAD_INIT;
     }
-
-    rpi_gpio_output(rows[r], GPIO_HIGH);
   }
 
   return RMP_KEYPAD_OK;
 }
 
+static void read_row(rmp_keypad_t* keypad, int row) {
+  unsigned levels;
+  if (rpi_gpio_input_mask(keypad->col_mask, &levels) != GPIO_SUCCESS) {
+    return;
+  }
+
+  for (int c = 0; c < 4; c++) {
+    if (keypad->scan_cols & (1u << c)) {
+      keypad->scan_keys[c * 4 + row] = (levels & (1u << keypad->col_pins[c])) ? 0 : 1;
+    }
+  }
+}
 
-static void handle_event(uint8_t event, rmp_app_t* app) {
-  pthread_mutex_lock(&app->mutex);
+static void switch_row(rmp_keypad_t* keypad, int high, int low) {
+  unsigned mask = 0;
+  unsigned levels = 0;
 
-  if (app->recalibrating) {
-    handle_recal_event(event, app);
+  if (high >= 0) {
+    mask |= 1u << keypad->row_pins[high];
+    levels |= 1u << keypad->row_pins[high];
   }
-  else {
-    handle_game_event(event, app);
+  if (low >= 0) {
+    mask |= 1u << keypad->row_pins[low];
   }
 
-  pthread_mutex_unlock(&app->mutex);
+  rpi_gpio_output_mask(mask, levels);
 }
 
-static void handle_game_event(uint8_t event, rmp_app_t* app) {
-  rmp_vec2_t v;
+static void settle(const rmp_keypad_t* keypad) {
+  time_t deadline = rmp_time_get_us() + keypad->settle_us;
+  if (keypad->settle_us <= RMP_KEYPAD_SPIN_MAX_US) {
+    rmp_time_spin_until_us(deadline);
+  }
+  else {
+    rmp_time_sleep_until_us(deadline);
+  }
+}
 
-  switch (event) {
-    case RMP_KEYUP | RMP_EVENT_QUIT:
-      app->running = false;
-      pthread_cond_signal(&app->cond);
-      break;
+static void scan_once(rmp_keypad_t* keypad) {
+  keypad->scan_cols = RMP_KEYPAD_ALL_COLS;
+  for (int r = 0; r < 4; ++r) {
+    switch_row(keypad, r - 1, r);
+    settle(keypad);
+    read_row(keypad, r);
+  }
+  switch_row(keypad, 3, -1);
+}
 
-    case RMP_KEYUP | RMP_EVENT_PLAY_PAUSE:
-      app->paused = !app->paused;
-      break;
+static unsigned read_cols(rmp_keypad_t* keypad) {
+  unsigned cols = 0;
+  unsigned levels;
+  if (rpi_gpio_input_mask(keypad->col_mask, &levels) != GPIO_SUCCESS) {
+    return cols;
+  }
 
-    case RMP_KEYUP | RMP_EVENT_TOGGLE_AI:
-      app->ai_is_playing = !app->ai_is_playing;
-      if (!app->ai_is_playing) {
-        rmp_vec2_set(&app->pad_b.vel, 0, 0);
-      }
-      break;
+  for (int c = 0; c < 4; c++) {
+    if (!(levels & (1u << keypad->col_pins[c]))) {
+      cols |= 1u << c;
+    }
+  }
 
-    case RMP_KEYUP | RMP_EVENT_TOGGLE_RECAL:
-      app->recalibrating = !app->recalibrating;
-      break;
+  return cols;
+}
 
-    case RMP_KEYDOWN | RMP_EVENT_PAD_A_UP:
-    case RMP_KEYUP | RMP_EVENT_PAD_A_DOWN:
-      rmp_vec2_set(&v, 0, -app->pad_speed);
-      rmp_vec2_add(&app->pad_a.vel, app->pad_a.vel, v);
-      break;
+static void drive_rows(rmp_keypad_t* keypad, unsigned level) {
+  rpi_gpio_output_mask(keypad->row_mask, level == GPIO_HIGH ? keypad->row_mask : 0);
+}
 
-    case RMP_KEYUP | RMP_EVENT_PAD_A_UP:
-    case RMP_KEYDOWN | RMP_EVENT_PAD_A_DOWN:
-      rmp_vec2_set(&v, 0, app->pad_speed);
-      rmp_vec2_add(&app->pad_a.vel, app->pad_a.vel, v);
-      break;
+static bool keys_held(const rmp_keypad_t* keypad) {
+  for (int i = 0; i < 16; ++i) {
+    if (keypad->keys[i]) {
+      return true;
+    }
+  }
 
-    case RMP_KEYDOWN | RMP_EVENT_PAD_B_UP:
-    case RMP_KEYUP | RMP_EVENT_PAD_B_DOWN:
-      if (app->ai_is_playing) {
-        break;
-      };
-      rmp_vec2_set(&v, 0, -app->pad_speed);
-      rmp_vec2_add(&app->pad_b.vel, app->pad_b.vel, v);
-      break;
+  return false;
+}
 
-    case RMP_KEYUP | RMP_EVENT_PAD_B_UP:
-    case RMP_KEYDOWN | RMP_EVENT_PAD_B_DOWN:
-      if (app->ai_is_playing) {
-        break;
-      };
-      rmp_vec2_set(&v, 0, app->pad_speed);
-      rmp_vec2_add(&app->pad_b.vel, app->pad_b.vel, v);
-      break;
+static unsigned wait_for_edge(rmp_keypad_t* keypad) {
+  // With every row low any key pulls its column down. Edges the last scan left behind are dropped,
+  // and a key that went down before the rows did makes no edge, so the columns are read once
+  unsigned cols = 0;
+  if (!keypad->edge_armed) {
+    drive_rows(keypad, GPIO_LOW);
+    settle(keypad);
+    receive_edges(keypad, 0);
+    keypad->edge_armed = true;
+    cols = read_cols(keypad);
   }
-}
 
-static void handle_recal_event(uint8_t event, rmp_app_t* app) {
-  rmp_vec2_t v;
-  const int step = 5;
+  if (!cols) {
+    keypad->stats.edge_waits++;
+    cols = receive_edges(keypad, RMP_KEYPAD_EDGE_TIMEOUT_US);
+  }
 
-  switch (event) {
-    case RMP_KEYUP | RMP_EVENT_RECAL_TL_LEFT:
-      rmp_vec2_set(&v, -step, 0);
-      rmp_vec2_add(&app->SCREEN_START, app->SCREEN_START, v);
-      break;
+  if (cols) {
+    drive_rows(keypad, GPIO_HIGH);
+    keypad->edge_armed = false;
+    keypad->stats.edge_wakes++;
+  }
 
-    case RMP_KEYUP | RMP_EVENT_RECAL_TL_DOWN:
-      rmp_vec2_set(&v, 0, step);
-      rmp_vec2_add(&app->SCREEN_START, app->SCREEN_START, v);
-      break;
+  return cols;
+}
 
-    case RMP_KEYUP | RMP_EVENT_RECAL_TL_UP:
-      rmp_vec2_set(&v, 0, -step);
-      rmp_vec2_add(&app->SCREEN_START, app->SCREEN_START, v);
-      break;
+static unsigned receive_edges(rmp_keypad_t* keypad, time_t timeout_us) {
+  // Blocks up to timeout_us for the first edge or a wake, then takes whatever else is queued
+  unsigned cols = 0;
 
-    case RMP_KEYUP | RMP_EVENT_RECAL_TL_RIGHT:
-      rmp_vec2_set(&v, step, 0);
-      rmp_vec2_add(&app->SCREEN_START, app->SCREEN_START, v);
-      break;
+#if defined(__QNX__)
+  while (true) {
+    uint64_t timeout_ns = (uint64_t)timeout_us * 1000;
+    TimerTimeout(CLOCK_MONOTONIC, _NTO_TIMEOUT_RECEIVE, NULL, timeout_us > 0 ? &timeout_ns : NULL,
+                 NULL);
 
-    case RMP_KEYUP | RMP_EVENT_RECAL_BR_LEFT:
-      rmp_vec2_set(&v, -step, 0);
-      rmp_vec2_add(&app->SCREEN_END, app->SCREEN_END, v);
-      break;
+    struct _pulse pulse;
+    if (MsgReceivePulse(keypad->chid, &pulse, sizeof(pulse), NULL) == -1) {
+      return cols;
+    }
 
-    case RMP_KEYUP | RMP_EVENT_RECAL_BR_DOWN:
-      rmp_vec2_set(&v, 0, step);
-      rmp_vec2_add(&app->SCREEN_END, app->SCREEN_END, v);
-      break;
+    if (pulse.code == RMP_KEYPAD_PULSE_WAKE) {
+      return cols;
+    }
+    if (pulse.code == RMP_KEYPAD_PULSE_EDGE && pulse.value.sival_int >= 0 &&
+        pulse.value.sival_int < 4) {
+      cols |= 1u << pulse.value.sival_int;
+    }
+    timeout_us = 0;
+  }
+#else
+  if (timeout_us > 0) {
+    struct pollfd fd = {.fd = keypad->event_fds[0], .events = POLLIN};
+    if (poll(&fd, 1, (int)((timeout_us + 999) / 1000)) <= 0) {
+      return cols;
+    }
+  }
 
-    case RMP_KEYUP | RMP_EVENT_RECAL_BR_UP:
-      rmp_vec2_set(&v, 0, -step);
-      rmp_vec2_add(&app->SCREEN_END, app->SCREEN_END, v);
-      break;
+  unsigned id;
+  while (read(keypad->event_fds[0], &id, sizeof(id)) == sizeof(id)) {
+    if (id < 4) {
+      cols |= 1u << id;
+    }
+  }
+#endif
 
-    case RMP_KEYUP | RMP_EVENT_RECAL_BR_RIGHT:
-      rmp_vec2_set(&v, step, 0);
-      rmp_vec2_add(&app->SCREEN_END, app->SCREEN_END, v);
-      break;
+  return cols;
+}
 
-    case RMP_KEYUP | RMP_EVENT_TOGGLE_RECAL:
-      app->recalibrating = !app->recalibrating;
-      rmp_app_recalibrate(app);
-      break;
+static void dispatch_changes(rmp_keypad_t* keypad) {
+  for (int i = 0; i < 16; ++i) {
+    if (keypad->keys[i] != keypad->scan_keys[i]) {
+      // Only a change the sim got is kept, a full queue leaves it for the next scan to send again.
+      // A key left held that way keeps the keypad scanning rather than waiting for an edge
+      uint8_t event = (keypad->scan_keys[i]) ? (RMP_KEYDOWN | i) : (RMP_KEYUP | i);
+      if (!rmp_app_post_event(keypad->app, event)) {
+        continue;
+      }
+      keypad->keys[i] = keypad->scan_keys[i];
+
+      if (keypad->keys[i]) {
+        time_t latency_us = rmp_time_get_us() - keypad->scan_due_us;
+        keypad->stats.keydowns++;
+        keypad->stats.keydown_total_us += latency_us;
+        if (latency_us > keypad->stats.keydown_max_us) {
+          keypad->stats.keydown_max_us = latency_us;
+        }
+      }
+    }
   }
 }
@@ -0,0 +1,219 @@
+#include "rmp_raster.h"
+#include "rmp_log.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static bool bin_cmds(rmp_raster_t* raster, const rmp_cmd_list_t* list);
+static void draw_tiles(rmp_raster_t* raster);
+static void* worker_run(void* args);
+
+rmp_rasterRet_e rmp_raster_init(rmp_raster_t* raster, int width, int height, int threads) {
+  if (!raster || width <= 0 || height <= 0 || threads < 1 || threads > RMP_RASTER_MAX_THREADS) {
+    return RMP_RASTER_BAD_ARGS;
+  }
+
+  memset(raster, 0, sizeof(*raster));
+  raster->tiles_x = (width + RMP_RASTER_TILE - 1) / RMP_RASTER_TILE;
+  raster->tiles_y = (height + RMP_RASTER_TILE - 1) / RMP_RASTER_TILE;
+
+  int tiles = raster->tiles_x * raster->tiles_y;
+  raster->item_capacity = 4 * tiles;
+  raster->first = malloc((tiles + 1) * sizeof(raster->first[0]));
+  raster->items = malloc(raster->item_capacity * sizeof(raster->items[0]));
+  raster->queue = malloc(tiles * sizeof(raster->queue[0]));
+  if (!raster->first || !raster->items || !raster->queue) {
+    rmp_log_error("raster", "Failed to allocate %d tile bins\n", tiles);
+    rmp_raster_free(raster);
+    return RMP_RASTER_BAD_INIT;
+  }
+
+  pthread_mutex_init(&raster->mutex, NULL);
+  pthread_cond_init(&raster->start, NULL);
+  pthread_cond_init(&raster->done, NULL);
+
+  // The calling thread takes tiles too, so the pool is one short of the thread count
+  raster->thread_count = 1;
+  for (int i = 0; i < threads - 1; ++i) {
+    if (pthread_create(&raster->workers[i], NULL, worker_run, raster) != 0) {
+      rmp_log_error("raster", "Failed to create worker %d\n", i);
+      rmp_raster_free(raster);
+      return RMP_RASTER_BAD_INIT;
+    }
+    raster->thread_count++;
+  }
+
+  rmp_log_info("raster", "Drawing %dx%d tiles of %d pixels on %d threads\n", raster->tiles_x,
+               raster->tiles_y, RMP_RASTER_TILE, raster->thread_count);
+  return RMP_RASTER_OK;
+}
+
+rmp_rasterRet_e rmp_raster_free(rmp_raster_t* raster) {
+  if (!raster) {
+    return RMP_RASTER_BAD_ARGS;
+  }
+
+  if (raster->thread_count > 0) {
+    pthread_mutex_lock(&raster->mutex);
+    raster->stopping = true;
+    pthread_cond_broadcast(&raster->start);
+    pthread_mutex_unlock(&raster->mutex);
+
+    for (int i = 0; i < raster->thread_count - 1; ++i) {
+      pthread_join(raster->workers[i], NULL);
+    }
+
+    pthread_cond_destroy(&raster->start);
+    pthread_cond_destroy(&raster->done);
+    pthread_mutex_destroy(&raster->mutex);
+    raster->thread_count = 0;
+  }
+
+  free(raster->first);
+  free(raster->items);
+  free(raster->queue);
+  raster->first = NULL;
+  raster->items = NULL;
+  raster->queue = NULL;
+
+  return RMP_RASTER_OK;
+}
+
+void rmp_raster_draw(rmp_raster_t* raster, rmp_fb_t* fb, const rmp_cmd_list_t* list) {
+  if (!raster || !fb || !list) {
+    return;
+  }
+
+  unsigned long long pixels = 0;
+  for (int i = 0; i < list->count; ++i) {
+    pixels += (unsigned long long)list->cmds[i].rect.width * list->cmds[i].rect.height;
+  }
+
+  bool fits = fb->width <= raster->tiles_x * RMP_RASTER_TILE &&
+              fb->height <= raster->tiles_y * RMP_RASTER_TILE;
+  if (raster->thread_count < 2 || pixels < RMP_RASTER_MIN_PARALLEL_PIXELS || !fits ||
+      !bin_cmds(raster, list)) {
+    rmp_fb_draw(fb, list);
+    raster->stats.single_frames++;
+    return;
+  }
+
+  raster->fb = fb;
+  raster->list = list;
+  atomic_store_explicit(&raster->next, 0, memory_order_relaxed);
+
+  pthread_mutex_lock(&raster->mutex);
+  raster->busy = raster->thread_count - 1;
+  raster->job++;
+  pthread_cond_broadcast(&raster->start);
+  pthread_mutex_unlock(&raster->mutex);
+
+  draw_tiles(raster);
+
+  // Nothing may be presented while a worker still writes into the buffer
+  pthread_mutex_lock(&raster->mutex);
+  while (raster->busy > 0) {
+    pthread_cond_wait(&raster->done, &raster->mutex);
+  }
+  pthread_mutex_unlock(&raster->mutex);
+
+  raster->stats.parallel_frames++;
+  raster->stats.tiles += raster->queue_count;
+}
+
+static bool bin_cmds(rmp_raster_t* raster, const rmp_cmd_list_t* list) {
+  int tiles = raster->tiles_x * raster->tiles_y;
+  int* first = raster->first;
+  memset(first, 0, (tiles + 1) * sizeof(first[0]));
+
+  // Count per tile, then turn the counts into where each bin starts
+  for (int i = 0; i < list->count; ++i) {
+    const rmp_rect_t* rect = &list->cmds[i].rect;
+    int tx1 = (rect->x + rect->width - 1) / RMP_RASTER_TILE;
+    int ty1 = (rect->y + rect->height - 1) / RMP_RASTER_TILE;
+    for (int ty = rect->y / RMP_RASTER_TILE; ty <= ty1; ++ty) {
+      for (int tx = rect->x / RMP_RASTER_TILE; tx <= tx1; ++tx) {
+        first[ty * raster->tiles_x + tx + 1]++;
+      }
+    }
+  }
+
+  raster->queue_count = 0;
+  for (int t = 0; t < tiles; ++t) {
+    if (first[t + 1] > 0) {
+      raster->queue[raster->queue_count++] = t;
+    }
+    first[t + 1] += first[t];
+  }
+
+  if (first[tiles] > raster->item_capacity) {
+    int* items = realloc(raster->items, first[tiles] * sizeof(items[0]));
+    if (!items) {
+      return false;
+    }
+    raster->items = items;
+    raster->item_capacity = first[tiles];
+  }
+
+  // Filled in list order so every bin paints in layer order. Each start moves up to the next bin's
+  // start on the way and is shifted back after
+  for (int i = 0; i < list->count; ++i) {
+    const rmp_rect_t* rect = &list->cmds[i].rect;
+    int tx1 = (rect->x + rect->width - 1) / RMP_RASTER_TILE;
+    int ty1 = (rect->y + rect->height - 1) / RMP_RASTER_TILE;
+    for (int ty = rect->y / RMP_RASTER_TILE; ty <= ty1; ++ty) {
+      for (int tx = rect->x / RMP_RASTER_TILE; tx <= tx1; ++tx) {
+        raster->items[first[ty * raster->tiles_x + tx]++] = i;
+      }
+    }
+  }
+  memmove(first + 1, first, tiles * sizeof(first[0]));
+  first[0] = 0;
+
+  return true;
+}
+
+static void draw_tiles(rmp_raster_t* raster) {
+  while (true) {
+    int next = atomic_fetch_add_explicit(&raster->next, 1, memory_order_relaxed);
+    if (next >= raster->queue_count) {
+      return;
+    }
+
+    int tile = raster->queue[next];
+    rmp_rect_t clip = {(tile % raster->tiles_x) * RMP_RASTER_TILE,
+                       (tile / raster->tiles_x) * RMP_RASTER_TILE,
+                       RMP_RASTER_TILE,
+                       RMP_RASTER_TILE};
+    for (int k = raster->first[tile]; k < raster->first[tile + 1]; ++k) {
+      rmp_fb_draw_cmd(raster->fb, &raster->list->cmds[raster->items[k]], clip);
+    }
+  }
+}
+
+static void* worker_run(void* args) {
+  rmp_raster_t* raster = (rmp_raster_t*)args;
+  unsigned long seen = 0;
+
+  pthread_mutex_lock(&raster->mutex);
+  while (true) {
+    while (raster->job == seen && !raster->stopping) {
+      pthread_cond_wait(&raster->start, &raster->mutex);
+    }
+    if (raster->stopping) {
+      break;
+    }
+    seen = raster->job;
+    pthread_mutex_unlock(&raster->mutex);
+
+    draw_tiles(raster);
+
+    pthread_mutex_lock(&raster->mutex);
+    if (--raster->busy == 0) {
+      pthread_cond_signal(&raster->done);
+    }
+  }
+  pthread_mutex_unlock(&raster->mutex);
+
+  return NULL;
+}
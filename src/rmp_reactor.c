@@ -0,0 +1,263 @@
+#include "rmp_reactor.h"
+#include "rmp_app.h"
+#include "rmp_time.h"
+#include "rmp_log.h"
+
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+
+#if defined(__QNX__)
+#include <sys/neutrino.h>
+#include <sys/siginfo.h>
+#else
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#endif
+
+#if defined(__QNX__)
+#define RMP_REACTOR_PULSE_TIMER (_PULSE_CODE_MINAVAIL)
+#define RMP_REACTOR_PULSE_WAKE  (_PULSE_CODE_MINAVAIL + 1)
+#else
+#define RMP_REACTOR_WAKE_ID     UINT32_MAX
+#endif
+
+static rmp_reactorRet_e arm_source(rmp_reactor_source_t* source, time_t deadline_us);
+static void dispatch(rmp_reactor_t* reactor, int index);
+
+rmp_reactorRet_e rmp_reactor_init(rmp_reactor_t* reactor, rmp_app_t* app) {
+  if (!reactor || !app) {
+    return RMP_REACTOR_BAD_ARGS;
+  }
+
+  memset(reactor, 0, sizeof(*reactor));
+  reactor->app = app;
+
+#if defined(__QNX__)
+  reactor->chid = ChannelCreate(_NTO_CHF_PRIVATE);
+  if (reactor->chid == -1) {
+    rmp_log_error("reactor", "Failed to create channel\n");
+    return RMP_REACTOR_BAD_INIT;
+  }
+
+  reactor->coid = ConnectAttach(0, 0, reactor->chid, _NTO_SIDE_CHANNEL, 0);
+  if (reactor->coid == -1) {
+    rmp_log_error("reactor", "Failed to attach to channel\n");
+    ChannelDestroy(reactor->chid);
+    return RMP_REACTOR_BAD_INIT;
+  }
+#else
+  reactor->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  reactor->wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (reactor->epoll_fd == -1 || reactor->wake_fd == -1) {
+    rmp_log_error("reactor", "Failed to create epoll instance\n");
+    rmp_reactor_free(reactor);
+    return RMP_REACTOR_BAD_INIT;
+  }
+
+  struct epoll_event event = {.events = EPOLLIN, .data.u32 = RMP_REACTOR_WAKE_ID};
+  if (epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD, reactor->wake_fd, &event) == -1) {
+    rmp_log_error("reactor", "Failed to watch wake event\n");
+    rmp_reactor_free(reactor);
+    return RMP_REACTOR_BAD_INIT;
+  }
+#endif
+
+  rmp_log_info("reactor", "Initialized reactor\n");
+  return RMP_REACTOR_OK;
+}
+
+rmp_reactorRet_e rmp_reactor_free(rmp_reactor_t* reactor) {
+  if (!reactor) {
+    return RMP_REACTOR_BAD_ARGS;
+  }
+
+#if defined(__QNX__)
+  for (int i = 0; i < reactor->count; ++i) {
+    timer_delete(reactor->sources[i].timer);
+  }
+  ConnectDetach(reactor->coid);
+  ChannelDestroy(reactor->chid);
+#else
+  for (int i = 0; i < reactor->count; ++i) {
+    close(reactor->sources[i].timer_fd);
+  }
+  if (reactor->wake_fd > 0) {
+    close(reactor->wake_fd);
+  }
+  if (reactor->epoll_fd > 0) {
+    close(reactor->epoll_fd);
+  }
+#endif
+
+  reactor->count = 0;
+  return RMP_REACTOR_OK;
+}
+
+rmp_reactorRet_e rmp_reactor_add(rmp_reactor_t* reactor, rmp_reactor_fn fn, void* ctx,
+                                 rmp_sched_probe_t* probe) {
+  if (!reactor || !fn || reactor->count >= RMP_REACTOR_MAX_SOURCES) {
+    return RMP_REACTOR_BAD_ARGS;
+  }
+
+  int index = reactor->count;
+  rmp_reactor_source_t* source = &reactor->sources[index];
+  source->fn = fn;
+  source->ctx = ctx;
+  source->deadline = rmp_time_get_us();
+  source->probe = probe;
+
+#if defined(__QNX__)
+  struct sigevent event;
+  SIGEV_PULSE_INIT(&event, reactor->coid, SIGEV_PULSE_PRIO_INHERIT, RMP_REACTOR_PULSE_TIMER,
+                   index);
+  if (timer_create(CLOCK_MONOTONIC, &event, &source->timer) == -1) {
+    rmp_log_error("reactor", "Failed to create timer\n");
+    return RMP_REACTOR_BAD_INIT;
+  }
+#else
+  source->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+  if (source->timer_fd == -1) {
+    rmp_log_error("reactor", "Failed to create timer\n");
+    return RMP_REACTOR_BAD_INIT;
+  }
+
+  struct epoll_event event = {.events = EPOLLIN, .data.u32 = index};
+  if (epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD, source->timer_fd, &event) == -1) {
+    rmp_log_error("reactor", "Failed to watch timer\n");
+    close(source->timer_fd);
+    return RMP_REACTOR_BAD_INIT;
+  }
+#endif
+
+  reactor->count++;
+  return RMP_REACTOR_OK;
+}
+
+rmp_reactorRet_e rmp_reactor_run(rmp_reactor_t* reactor) {
+  if (!reactor) {
+    return RMP_REACTOR_BAD_ARGS;
+  }
+
+  rmp_app_t* app = reactor->app;
+
+  rmp_log_info("reactor", "Started reactor with %d sources\n", reactor->count);
+  for (int i = 0; i < reactor->count && rmp_app_is_running(app); ++i) {
+    dispatch(reactor, i);
+  }
+
+  while (rmp_app_is_running(app)) {
+#if defined(__QNX__)
+    struct _pulse pulse;
+    if (MsgReceivePulse(reactor->chid, &pulse, sizeof(pulse), NULL) == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      rmp_log_error("reactor", "Failed to receive pulse\n");
+      return RMP_REACTOR_BAD_INIT;
+    }
+
+    atomic_fetch_add(&app->loop_wakeups, 1);
+    if (pulse.code == RMP_REACTOR_PULSE_TIMER) {
+      dispatch(reactor, pulse.value.sival_int);
+    }
+#else
+    struct epoll_event events[RMP_REACTOR_MAX_SOURCES + 1];
+    int ready = epoll_wait(reactor->epoll_fd, events, RMP_REACTOR_MAX_SOURCES + 1, -1);
+    if (ready == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      rmp_log_error("reactor", "Failed to wait for events\n");
+      return RMP_REACTOR_BAD_INIT;
+    }
+
+    atomic_fetch_add(&app->loop_wakeups, 1);
+    for (int i = 0; i < ready && rmp_app_is_running(app); ++i) {
+      uint64_t count;
+      if (events[i].data.u32 == RMP_REACTOR_WAKE_ID) {
+        while (read(reactor->wake_fd, &count, sizeof(count)) > 0) {
+        }
+        continue;
+      }
+
+      while (read(reactor->sources[events[i].data.u32].timer_fd, &count, sizeof(count)) > 0) {
+      }
+      dispatch(reactor, events[i].data.u32);
+    }
+#endif
+  }
+
+  return RMP_REACTOR_OK;
+}
+
+void rmp_reactor_wake(rmp_reactor_t* reactor) {
+  if (!reactor) {
+    return;
+  }
+
+  // Only async-signal-safe calls, this runs from signal handlers
+#if defined(__QNX__)
+  MsgSendPulse(reactor->coid, -1, RMP_REACTOR_PULSE_WAKE, 0);
+#else
+  uint64_t one = 1;
+  ssize_t rc = write(reactor->wake_fd, &one, sizeof(one));
+  (void)rc;
+#endif
+}
+
+void rmp_reactor_kick(rmp_reactor_t* reactor) {
+  if (!reactor) {
+    return;
+  }
+
+  time_t now = rmp_time_get_us();
+  for (int i = 0; i < reactor->count; ++i) {
+    rmp_reactor_source_t* source = &reactor->sources[i];
+    if (source->deadline == RMP_TIME_NEVER) {
+      source->deadline = now;
+      arm_source(source, now);
+    }
+  }
+}
+
+static void dispatch(rmp_reactor_t* reactor, int index) {
+  if (index < 0 || index >= reactor->count) {
+    return;
+  }
+
+  rmp_reactor_source_t* source = &reactor->sources[index];
+  time_t now = rmp_time_get_us();
+  rmp_sched_probe_record(source->probe, source->deadline, now);
+
+  source->deadline = source->fn(source->ctx, now);
+  arm_source(source, source->deadline);
+}
+
+static rmp_reactorRet_e arm_source(rmp_reactor_source_t* source, time_t deadline_us) {
+  // A zero expiry disarms the timer, a deadline in the past must still fire
+  if (deadline_us <= 0) {
+    deadline_us = 1;
+  }
+
+  struct itimerspec spec;
+  memset(&spec, 0, sizeof(spec));
+  if (deadline_us != RMP_TIME_NEVER) {
+    spec.it_value.tv_sec = deadline_us / 1000000;
+    spec.it_value.tv_nsec = (deadline_us % 1000000) * 1000;
+  }
+
+#if defined(__QNX__)
+  if (timer_settime(source->timer, TIMER_ABSTIME, &spec, NULL) == -1) {
+#else
+  if (timerfd_settime(source->timer_fd, TFD_TIMER_ABSTIME, &spec, NULL) == -1) {
+#endif
+    rmp_log_error("reactor", "Failed to arm timer\n");
+    return RMP_REACTOR_BAD_INIT;
+  }
+
+  return RMP_REACTOR_OK;
+}
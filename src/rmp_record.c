@@ -0,0 +1,282 @@
+#include "rmp_record.h"
+#include "rmp_app.h"
+#include "rmp_log.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+static void write_header(FILE* file, const rmp_app_t* app);
+static bool read_header(FILE* file, rmp_app_t* app);
+static void write_u32(FILE* file, uint32_t value);
+static void write_f64(FILE* file, double value);
+static void write_vec2(FILE* file, rmp_vec2_t vec);
+static void write_entity(FILE* file, rmp_app_entity_t entity);
+static void write_varint(FILE* file, uint64_t value);
+static bool read_u32(FILE* file, uint32_t* value);
+static bool read_f64(FILE* file, double* value);
+static bool read_vec2(FILE* file, rmp_vec2_t* vec);
+static bool read_entity(FILE* file, rmp_app_entity_t* entity);
+static bool read_varint(FILE* file, uint64_t* value);
+
+rmp_recordRet_e rmp_record_start(rmp_app_t* app, const char* path) {
+  if (!app || !path || app->record_file) {
+    return RMP_RECORD_BAD_ARGS;
+  }
+
+  FILE* file = fopen(path, "wb");
+  if (!file) {
+    rmp_log_error("record", "Failed to open %s\n", path);
+    return RMP_RECORD_BAD_FILE;
+  }
+
+  pthread_mutex_lock(&app->mutex);
+  write_header(file, app);
+  app->record_file = file;
+  app->record_tick = app->tick;
+  pthread_mutex_unlock(&app->mutex);
+
+  rmp_log_info("record", "Recording input to %s\n", path);
+  return RMP_RECORD_OK;
+}
+
+rmp_recordRet_e rmp_record_event(rmp_app_t* app, uint8_t event) {
+  if (!app || !app->record_file) {
+    return RMP_RECORD_BAD_ARGS;
+  }
+
+  write_varint(app->record_file, app->tick - app->record_tick);
+  fputc(event, app->record_file);
+  app->record_tick = app->tick;
+
+  return RMP_RECORD_OK;
+}
+
+rmp_recordRet_e rmp_record_stop(rmp_app_t* app) {
+  if (!app || !app->record_file) {
+    return RMP_RECORD_BAD_ARGS;
+  }
+
+  pthread_mutex_lock(&app->mutex);
+  rmp_record_event(app, RMP_RECORD_END);
+
+  FILE* file = app->record_file;
+  app->record_file = NULL;
+  pthread_mutex_unlock(&app->mutex);
+
+  if (fclose(file) != 0) {
+    rmp_log_error("record", "Failed to finish recording\n");
+    return RMP_RECORD_BAD_FILE;
+  }
+
+  rmp_log_info("record", "Recorded %lu ticks\n", app->tick);
+  return RMP_RECORD_OK;
+}
+
+rmp_recordRet_e rmp_record_replay(rmp_app_t* app, const char* path, rmp_record_stats_t* stats) {
+  if (!app || !path) {
+    return RMP_RECORD_BAD_ARGS;
+  }
+
+  FILE* file = fopen(path, "rb");
+  if (!file) {
+    rmp_log_error("record", "Failed to open %s\n", path);
+    return RMP_RECORD_BAD_FILE;
+  }
+
+  if (!read_header(file, app)) {
+    rmp_log_error("record", "%s is not a recording\n", path);
+    fclose(file);
+    return RMP_RECORD_BAD_FORMAT;
+  }
+
+  // Step straight through to each event, no pacing
+  rmp_record_stats_t replayed = {0, 0};
+  unsigned long start_tick = app->tick;
+  rmp_recordRet_e ret = RMP_RECORD_BAD_FORMAT;
+  uint64_t delta;
+  while (read_varint(file, &delta)) {
+    int event = fgetc(file);
+    if (event == EOF) {
+      break;
+    }
+
+    unsigned long target = app->tick + delta;
+    while (app->tick < target) {
+      rmp_app_step(app);
+    }
+
+    if (event == RMP_RECORD_END) {
+      ret = RMP_RECORD_OK;
+      break;
+    }
+
+    rmp_app_handle_event(app, (uint8_t)event);
+    replayed.events++;
+  }
+
+  fclose(file);
+
+  if (ret != RMP_RECORD_OK) {
+    rmp_log_error("record", "%s is truncated\n", path);
+  }
+
+  replayed.ticks = app->tick - start_tick;
+  if (stats) {
+    *stats = replayed;
+  }
+
+  return ret;
+}
+
+static void write_header(FILE* file, const rmp_app_t* app) {
+  fwrite(RMP_RECORD_MAGIC, 1, 4, file);
+  fputc(RMP_RECORD_VERSION, file);
+  fputc(app->paused | (app->recalibrating << 1) | (app->ai_is_playing << 2), file);
+
+  write_u32(file, app->rng_state);
+  write_varint(file, app->tick);
+  write_vec2(file, app->SCREEN_START);
+  write_vec2(file, app->SCREEN_END);
+  write_u32(file, app->pad_speed);
+  write_u32(file, app->pad_padding);
+  write_vec2(file, app->pad_size);
+  write_u32(file, app->ball_size);
+  write_entity(file, app->pad_a);
+  write_entity(file, app->pad_b);
+  write_entity(file, app->ball);
+  write_u32(file, app->score_a);
+  write_u32(file, app->score_b);
+}
+
+static bool read_header(FILE* file, rmp_app_t* app) {
+  char magic[4];
+  if (fread(magic, 1, 4, file) != 4 || memcmp(magic, RMP_RECORD_MAGIC, 4) != 0 ||
+      fgetc(file) != RMP_RECORD_VERSION) {
+    return false;
+  }
+
+  int flags = fgetc(file);
+  if (flags == EOF) {
+    return false;
+  }
+  app->paused = flags & 1;
+  app->recalibrating = (flags >> 1) & 1;
+  app->ai_is_playing = (flags >> 2) & 1;
+
+  uint32_t seed, pad_speed, pad_padding, ball_size, score_a, score_b;
+  uint64_t tick;
+  bool ok = read_u32(file, &seed) &&
+    read_varint(file, &tick) &&
+    read_vec2(file, &app->SCREEN_START) &&
+    read_vec2(file, &app->SCREEN_END) &&
+    read_u32(file, &pad_speed) &&
+    read_u32(file, &pad_padding) &&
+    read_vec2(file, &app->pad_size) &&
+    read_u32(file, &ball_size) &&
+    read_entity(file, &app->pad_a) &&
+    read_entity(file, &app->pad_b) &&
+    read_entity(file, &app->ball) &&
+    read_u32(file, &score_a) &&
+    read_u32(file, &score_b);
+  if (!ok) {
+    return false;
+  }
+
+  rmp_app_seed(app, seed);
+  app->tick = tick;
+  app->pad_speed = pad_speed;
+  app->pad_padding = pad_padding;
+  app->ball_size = ball_size;
+  app->score_a = score_a;
+  app->score_b = score_b;
+  rmp_app_clear_balls(app);
+  rmp_app_invalidate_prediction(app);
+
+  return true;
+}
+
+// Fixed little-endian encoding so recordings move between the Pi and a Linux host
+
+static void write_u32(FILE* file, uint32_t value) {
+  for (int i = 0; i < 4; ++i) {
+    fputc((value >> (i * 8)) & 0xff, file);
+  }
+}
+
+static void write_f64(FILE* file, double value) {
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  for (int i = 0; i < 8; ++i) {
+    fputc((bits >> (i * 8)) & 0xff, file);
+  }
+}
+
+static void write_vec2(FILE* file, rmp_vec2_t vec) {
+  write_f64(file, vec.x);
+  write_f64(file, vec.y);
+}
+
+static void write_entity(FILE* file, rmp_app_entity_t entity) {
+  write_vec2(file, entity.pos);
+  write_vec2(file, entity.vel);
+  write_vec2(file, entity.size);
+}
+
+static void write_varint(FILE* file, uint64_t value) {
+  while (value >= 0x80) {
+    fputc((value & 0x7f) | 0x80, file);
+    value >>= 7;
+  }
+  fputc(value, file);
+}
+
+static bool read_u32(FILE* file, uint32_t* value) {
+  *value = 0;
+  for (int i = 0; i < 4; ++i) {
+    int byte = fgetc(file);
+    if (byte == EOF) {
+      return false;
+    }
+    *value |= (uint32_t)byte << (i * 8);
+  }
+  return true;
+}
+
+static bool read_f64(FILE* file, double* value) {
+  uint64_t bits = 0;
+  for (int i = 0; i < 8; ++i) {
+    int byte = fgetc(file);
+    if (byte == EOF) {
+      return false;
+    }
+    bits |= (uint64_t)byte << (i * 8);
+  }
+  memcpy(value, &bits, sizeof(bits));
+  return true;
+}
+
+static bool read_vec2(FILE* file, rmp_vec2_t* vec) {
+  return read_f64(file, &vec->x) && read_f64(file, &vec->y);
+}
+
+static bool read_entity(FILE* file, rmp_app_entity_t* entity) {
+  return read_vec2(file, &entity->pos) && read_vec2(file, &entity->vel) &&
+    read_vec2(file, &entity->size);
+}
+
+static bool read_varint(FILE* file, uint64_t* value) {
+  *value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    int byte = fgetc(file);
+    if (byte == EOF) {
+      return false;
+    }
+    *value |= (uint64_t)(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,176 @@
+#include "rmp_render.h"
+#include "rmp_fb.h"
+#include "rmp_log.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// At a render scale above 1 the buffers are drawn small and window holds the frame scaled up
+typedef struct {
+  rmp_fb_t buffers[RMP_SWAPCHAIN_MAX_BUFFERS];
+  rmp_fb_t window;
+  bool scaled;
+  rmp_raster_t raster;
+  bool tiled;
+  int target;
+  int front;
+} rmp_render_fb_t;
+
+static void fb_select(rmp_render_t* render, int buffer);
+static void fb_submit(rmp_render_t* render, const rmp_cmd_list_t* list);
+static void fb_present(rmp_render_t* render, const rmp_rect_t* damage, int count);
+static bool fb_view(rmp_render_t* render, int buffer, rmp_fb_t* view);
+static void fb_free(rmp_render_t* render);
+
+rmp_renderRet_e rmp_render_fb_init(rmp_render_t* render, int width, int height, int buffers,
+                                   int refresh_hz, int scale, rmp_fb_format_e format) {
+  if (!render || buffers < 1 || buffers > RMP_SWAPCHAIN_MAX_BUFFERS || refresh_hz <= 0 ||
+      (scale != 1 && scale != 2 && scale != 4)) {
+    return RMP_RENDER_BAD_ARGS;
+  }
+
+  // Half the area halves the width, a quarter halves both, so every scale is a whole number of
+  // window pixels per drawn pixel
+  int scale_x = scale >= 2 ? 2 : 1;
+  int scale_y = scale >= 4 ? 2 : 1;
+
+  rmp_render_fb_t* fb = calloc(1, sizeof(*fb));
+  if (!fb) {
+    return RMP_RENDER_BAD_INIT;
+  }
+
+  fb->scaled = scale > 1;
+  if (fb->scaled && rmp_fb_init(&fb->window, width, height, format) != RMP_FB_OK) {
+    free(fb);
+    return RMP_RENDER_BAD_INIT;
+  }
+
+  for (int i = 0; i < buffers; ++i) {
+    if (rmp_fb_init(&fb->buffers[i], width / scale_x, height / scale_y, format) != RMP_FB_OK) {
+      while (i-- > 0) {
+        rmp_fb_free(&fb->buffers[i]);
+      }
+      rmp_fb_free(&fb->window);
+      free(fb);
+      return RMP_RENDER_BAD_INIT;
+    }
+  }
+
+  memset(render, 0, sizeof(*render));
+  render->name = "fb";
+  render->width = width / scale_x;
+  render->height = height / scale_y;
+  render->scale_x = scale_x;
+  render->scale_y = scale_y;
+  render->format = format;
+  render->buffer_count = buffers;
+  render->refresh_hz = refresh_hz;
+  render->impl = fb;
+  render->select = fb_select;
+  render->submit = fb_submit;
+  render->present = fb_present;
+  render->view = fb_view;
+  render->free = fb_free;
+
+  rmp_log_info("render", "Initialized %d %dx%d %s framebuffers (%s spans)\n", buffers,
+               render->width, render->height, rmp_fb_format_name(format), rmp_fb_simd_name());
+  if (fb->scaled) {
+    rmp_log_info("render", "Scaling %dx%d up to a %dx%d window\n", render->width, render->height,
+                 width, height);
+  }
+  return RMP_RENDER_OK;
+}
+
+rmp_fb_t* rmp_render_fb_get(rmp_render_t* render) {
+  if (!render || render->free != fb_free) {
+    return NULL;
+  }
+
+  rmp_render_fb_t* fb = (rmp_render_fb_t*)render->impl;
+  return fb->scaled ? &fb->window : &fb->buffers[fb->front];
+}
+
+rmp_renderRet_e rmp_render_fb_set_threads(rmp_render_t* render, int threads) {
+  if (!render || render->free != fb_free || threads < 1 || threads > RMP_RASTER_MAX_THREADS) {
+    return RMP_RENDER_BAD_ARGS;
+  }
+
+  rmp_render_fb_t* fb = (rmp_render_fb_t*)render->impl;
+  if (fb->tiled) {
+    rmp_raster_free(&fb->raster);
+    fb->tiled = false;
+  }
+
+  if (threads == 1) {
+    return RMP_RENDER_OK;
+  }
+
+  if (rmp_raster_init(&fb->raster, render->width, render->height, threads) != RMP_RASTER_OK) {
+    return RMP_RENDER_BAD_INIT;
+  }
+  fb->tiled = true;
+
+  return RMP_RENDER_OK;
+}
+
+const rmp_raster_stats_t* rmp_render_fb_raster_stats(rmp_render_t* render) {
+  if (!render || render->free != fb_free) {
+    return NULL;
+  }
+
+  rmp_render_fb_t* fb = (rmp_render_fb_t*)render->impl;
+  return fb->tiled ? &fb->raster.stats : NULL;
+}
+
+static void fb_select(rmp_render_t* render, int buffer) {
+  ((rmp_render_fb_t*)render->impl)->target = buffer;
+}
+
+static void fb_submit(rmp_render_t* render, const rmp_cmd_list_t* list) {
+  rmp_render_fb_t* fb = (rmp_render_fb_t*)render->impl;
+  if (fb->tiled) {
+    rmp_raster_draw(&fb->raster, &fb->buffers[fb->target], list);
+  }
+  else {
+    rmp_fb_draw(&fb->buffers[fb->target], list);
+  }
+}
+
+static void fb_present(rmp_render_t* render, const rmp_rect_t* damage, int count) {
+  // Headless, the finished frame stays in memory for whoever reads it
+  rmp_render_fb_t* fb = (rmp_render_fb_t*)render->impl;
+  fb->front = fb->target;
+  if (!fb->scaled) {
+    return;
+  }
+
+  // The window holds the previous frame, only what changed since is scaled up again
+  const rmp_fb_t* src = &fb->buffers[fb->front];
+  rmp_rect_t whole = {0, 0, src->width, src->height};
+  if (count <= 0) {
+    damage = &whole;
+    count = 1;
+  }
+
+  for (int i = 0; i < count; ++i) {
+    rmp_fb_upscale(&fb->window, src, damage[i], render->scale_x, render->scale_y);
+  }
+}
+
+static bool fb_view(rmp_render_t* render, int buffer, rmp_fb_t* view) {
+  *view = ((rmp_render_fb_t*)render->impl)->buffers[buffer];
+  return true;
+}
+
+static void fb_free(rmp_render_t* render) {
+  rmp_render_fb_t* fb = (rmp_render_fb_t*)render->impl;
+  for (int i = 0; i < render->buffer_count; ++i) {
+    rmp_fb_free(&fb->buffers[i]);
+  }
+  rmp_fb_free(&fb->window);
+  if (fb->tiled) {
+    rmp_raster_free(&fb->raster);
+  }
+  free(fb);
+  render->impl = NULL;
+}
@@ -0,0 +1,372 @@
+#include "rmp_render.h"
+#include "rmp_app.h"
+#include "rmp_event.h"
+#include "rmp_log.h"
+#include "rmp_time.h"
+#include "rmp_config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <screen/screen.h>
+#include <sys/keycodes.h>
+
+#define RMP_RENDER_QNX_MAX_POSTED 64
+
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+
+typedef struct {
+  screen_context_t ctx;
+  screen_window_t win;
+  screen_display_t display;
+  // Every buffer of the window, a buffer index is a position in here
+  screen_buffer_t bufs[RMP_SWAPCHAIN_MAX_BUFFERS];
+  screen_buffer_t buf;
+  screen_event_t event;
+  // Keyboard keys down as rmp_event.h keys, bit n for key n, and as the sim was last told
+  unsigned keys;
+  unsigned keys_sent;
+} rmp_render_qnx_t;
+
+static int qnx_acquire(rmp_render_t* render);
+static time_t qnx_wait_vsync(rmp_render_t* render);
+static void qnx_select(rmp_render_t* render, int buffer);
+static void qnx_submit(rmp_render_t* render, const rmp_cmd_list_t* list);
+static void qnx_present(rmp_render_t* render, const rmp_rect_t* damage, int count);
+static bool qnx_view(rmp_render_t* render, int buffer, rmp_fb_t* view);
+static void qnx_free(rmp_render_t* render);
+
+#if RMP_CONFIG_USE_KEYBOARD == 1
+static void qnx_poll(rmp_render_t* render, rmp_app_t* app);
+static void handle_keyboard_events(rmp_render_qnx_t* qnx);
+static void send_keys(rmp_render_qnx_t* qnx, rmp_app_t* app);
+#endif // RMP_CONFIG_USE_KEYBOARD == 1
+
+rmp_renderRet_e rmp_render_qnx_init(rmp_render_t* render, int buffers, rmp_fb_format_e format) {
+  if (!render || buffers < 1 || buffers > RMP_SWAPCHAIN_MAX_BUFFERS ||
+      (format != RMP_FB_RGBA8888 && format != RMP_FB_RGB565)) {
+    return RMP_RENDER_BAD_ARGS;
+  }
+
+  rmp_render_qnx_t* qnx = malloc(sizeof(*qnx));
+  if (!qnx) {
+    return RMP_RENDER_BAD_INIT;
+  }
+
+  int rc = screen_create_context(&qnx->ctx, 0);
+  if (rc) {
+    rmp_log_error("screen", "Failed to create screen context\n");
+    free(qnx);
+    return RMP_RENDER_BAD_INIT;
+  }
+
+  rc = screen_create_window(&qnx->win, qnx->ctx);
+  if (rc) {
+    rmp_log_error("screen", "Failed to create screen window\n");
+    screen_destroy_context(qnx->ctx);
+    free(qnx);
+    return RMP_RENDER_BAD_INIT;
+  }
+
+  // RGB565 halves what fills write and the display scans out over the shared memory bus
+  int screen_format = format == RMP_FB_RGB565 ? SCREEN_FORMAT_RGB565 : SCREEN_FORMAT_RGBA8888;
+  screen_set_window_property_iv(qnx->win, SCREEN_PROPERTY_FORMAT, &screen_format);
+
+  // Read as well, frame capture copies posted buffers out on the CPU
+  int usage = SCREEN_USAGE_ROTATION | SCREEN_USAGE_READ | SCREEN_USAGE_WRITE;
+  screen_set_window_property_iv(qnx->win, SCREEN_PROPERTY_USAGE, &usage);
+
+  // Flip on vsync so the buffer being scanned out is never the one being drawn
+  int interval = 1;
+  screen_set_window_property_iv(qnx->win, SCREEN_PROPERTY_SWAP_INTERVAL, &interval);
+
+  rc = screen_create_window_buffers(qnx->win, buffers);
+  if (rc) {
+    rmp_log_error("screen", "Failed to create screen window buffers\n");
+    screen_destroy_window(qnx->win);
+    screen_destroy_context(qnx->ctx);
+    free(qnx);
+    return RMP_RENDER_BAD_INIT;
+  }
+
+  screen_get_window_property_pv(qnx->win, SCREEN_PROPERTY_BUFFERS, (void**)qnx->bufs);
+  qnx->buf = qnx->bufs[0];
+
+  rc = screen_create_event(&qnx->event);
+  if (rc) {
+    rmp_log_error("screen", "Failed to create event\n");
+    screen_destroy_window(qnx->win);
+    screen_destroy_context(qnx->ctx);
+    free(qnx);
+    return RMP_RENDER_BAD_INIT;
+  }
+
+  qnx->keys = 0;
+  qnx->keys_sent = 0;
+
+  int sensitivity = SCREEN_SENSITIVITY_ALWAYS;
+  screen_set_window_property_iv(qnx->win, SCREEN_PROPERTY_SENSITIVITY, &sensitivity);
+
+  int foucs = 1;
+  screen_set_window_property_iv(qnx->win, SCREEN_PROPERTY_FOCUS, &foucs);
+
+  int size[2] = {0, 0};
+  screen_get_window_property_iv(qnx->win, SCREEN_PROPERTY_BUFFER_SIZE, size);
+
+  int refresh_hz = 0;
+  qnx->display = NULL;
+  if (screen_get_window_property_pv(qnx->win, SCREEN_PROPERTY_DISPLAY,
+                                    (void**)&qnx->display) == 0) {
+    screen_get_display_property_iv(qnx->display, SCREEN_PROPERTY_REFRESH_RATE, &refresh_hz);
+  }
+  if (refresh_hz <= 0) {
+    refresh_hz = 60;
+  }
+
+  memset(render, 0, sizeof(*render));
+  render->name = "qnx";
+  render->width = size[0];
+  render->height = size[1];
+  render->scale_x = 1;
+  render->scale_y = 1;
+  render->format = format;
+  render->buffer_count = buffers;
+  render->refresh_hz = refresh_hz;
+  render->impl = qnx;
+  render->acquire = qnx_acquire;
+  render->wait_vsync = qnx->display ? qnx_wait_vsync : NULL;
+  render->select = qnx_select;
+  render->submit = qnx_submit;
+  render->present = qnx_present;
+  render->view = qnx_view;
+#if RMP_CONFIG_USE_KEYBOARD == 1
+  render->poll = qnx_poll;
+#endif // RMP_CONFIG_USE_KEYBOARD == 1
+  render->free = qnx_free;
+
+  return RMP_RENDER_OK;
+}
+
+static int qnx_acquire(rmp_render_t* render) {
+  rmp_render_qnx_t* qnx = (rmp_render_qnx_t*)render->impl;
+
+  // Screen keeps a posted buffer until the display is done with it, the first render buffer is
+  // the one it hands back for the next frame
+  screen_buffer_t render_bufs[RMP_SWAPCHAIN_MAX_BUFFERS] = {NULL};
+  if (screen_get_window_property_pv(qnx->win, SCREEN_PROPERTY_RENDER_BUFFERS,
+                                    (void**)render_bufs) != 0) {
+    return -1;
+  }
+
+  for (int i = 0; i < render->buffer_count; ++i) {
+    if (render_bufs[0] && qnx->bufs[i] == render_bufs[0]) {
+      return i;
+    }
+  }
+
+  return -1;
+}
+
+static time_t qnx_wait_vsync(rmp_render_t* render) {
+  rmp_render_qnx_t* qnx = (rmp_render_qnx_t*)render->impl;
+
+  if (screen_wait_vsync(qnx->display) != 0) {
+    return -1;
+  }
+
+  return rmp_time_get_us();
+}
+
+static void qnx_select(rmp_render_t* render, int buffer) {
+  rmp_render_qnx_t* qnx = (rmp_render_qnx_t*)render->impl;
+  qnx->buf = qnx->bufs[buffer];
+}
+
+static void qnx_submit(rmp_render_t* render, const rmp_cmd_list_t* list) {
+  rmp_render_qnx_t* qnx = (rmp_render_qnx_t*)render->impl;
+
+  // The list arrives merged, so this is one compositor fill per merged rect. Filling in list order
+  // keeps later layers on top
+  int attribs[] = {
+    SCREEN_BLIT_DESTINATION_X, 0,
+    SCREEN_BLIT_DESTINATION_Y, 0,
+    SCREEN_BLIT_DESTINATION_WIDTH, 0,
+    SCREEN_BLIT_DESTINATION_HEIGHT, 0,
+    SCREEN_BLIT_COLOR, 0,
+    SCREEN_BLIT_END
+  };
+
+  uint8_t* pixels = NULL;
+  int stride = 0;
+  size_t bytes = rmp_fb_bytes_per_pixel(render->format);
+
+  for (int i = 0; i < list->count; ++i) {
+    const rmp_cmd_t* cmd = &list->cmds[i];
+
+    // Blits are copied on the CPU once the queued fills under them have landed
+    if (cmd->src) {
+      if (!pixels) {
+        screen_flush_blits(qnx->ctx, SCREEN_WAIT_IDLE);
+        if (screen_get_buffer_property_pv(qnx->buf, SCREEN_PROPERTY_POINTER, (void**)&pixels) ||
+            screen_get_buffer_property_iv(qnx->buf, SCREEN_PROPERTY_STRIDE, &stride) ||
+            !pixels) {
+          return;
+        }
+      }
+
+      uint8_t* row = pixels + (size_t)cmd->rect.y * stride + cmd->rect.x * bytes;
+      const uint8_t* src = cmd->src;
+      size_t src_bytes = (size_t)cmd->src_stride * bytes;
+      for (int r = 0; r < cmd->rect.height; ++r, row += stride, src += src_bytes) {
+        memcpy(row, src, cmd->rect.width * bytes);
+      }
+      continue;
+    }
+
+    attribs[1] = cmd->rect.x;
+    attribs[3] = cmd->rect.y;
+    attribs[5] = cmd->rect.width;
+    attribs[7] = cmd->rect.height;
+    // The blitter takes 0xAARRGGBB whatever the buffer format and converts on its own
+    attribs[9] = (int)rmp_fb_unpack(render->format, cmd->color);
+    screen_fill(qnx->ctx, qnx->buf, attribs);
+  }
+}
+
+static void qnx_present(rmp_render_t* render, const rmp_rect_t* damage, int count) {
+  rmp_render_qnx_t* qnx = (rmp_render_qnx_t*)render->impl;
+
+  // Past a few dozen rects the compositor does better with their bounds
+  rmp_rect_t bounds;
+  if (damage && count > RMP_RENDER_QNX_MAX_POSTED) {
+    int x0 = damage[0].x, y0 = damage[0].y;
+    int x1 = x0 + damage[0].width, y1 = y0 + damage[0].height;
+    for (int i = 1; i < count; ++i) {
+      x0 = MIN(x0, damage[i].x);
+      y0 = MIN(y0, damage[i].y);
+      x1 = MAX(x1, damage[i].x + damage[i].width);
+      y1 = MAX(y1, damage[i].y + damage[i].height);
+    }
+    bounds = (rmp_rect_t){x0, y0, x1 - x0, y1 - y0};
+    damage = &bounds;
+    count = 1;
+  }
+
+  // rmp_rect_t is laid out as the x, y, width, height quads the compositor expects
+  screen_post_window(qnx->win, qnx->buf, damage ? count : 0, (const int*)damage, 0);
+}
+
+static bool qnx_view(rmp_render_t* render, int buffer, rmp_fb_t* view) {
+  rmp_render_qnx_t* qnx = (rmp_render_qnx_t*)render->impl;
+
+  void* pointer = NULL;
+  int stride = 0;
+  if (screen_get_buffer_property_pv(qnx->bufs[buffer], SCREEN_PROPERTY_POINTER, &pointer) ||
+      screen_get_buffer_property_iv(qnx->bufs[buffer], SCREEN_PROPERTY_STRIDE, &stride) ||
+      !pointer) {
+    return false;
+  }
+
+  view->pixels = pointer;
+  view->width = render->width;
+  view->height = render->height;
+  view->stride = stride / rmp_fb_bytes_per_pixel(render->format);
+  view->format = render->format;
+  return true;
+}
+
+static void qnx_free(rmp_render_t* render) {
+  rmp_render_qnx_t* qnx = (rmp_render_qnx_t*)render->impl;
+
+  screen_destroy_window(qnx->win);
+  screen_destroy_context(qnx->ctx);
+  free(qnx);
+  render->impl = NULL;
+}
+
+#if RMP_CONFIG_USE_KEYBOARD == 1
+
+static void qnx_poll(rmp_render_t* render, rmp_app_t* app) {
+  rmp_render_qnx_t* qnx = (rmp_render_qnx_t*)render->impl;
+
+  int rc = screen_get_event(qnx->ctx, qnx->event, 0);
+  if (rc == 0) {
+    int event_type;
+    screen_get_event_property_iv(qnx->event, SCREEN_PROPERTY_TYPE, &event_type);
+
+    switch (event_type) {
+      case SCREEN_EVENT_KEYBOARD:
+        handle_keyboard_events(qnx);
+        break;
+
+      case SCREEN_EVENT_CLOSE:
+        pthread_mutex_lock(&app->mutex);
+        rmp_app_quit(app);
+        pthread_mutex_unlock(&app->mutex);
+        break;
+    }
+  }
+
+  send_keys(qnx, app);
+}
+
+static void handle_keyboard_events(rmp_render_qnx_t* qnx) {
+  int flags, key_sym;
+
+  screen_get_event_property_iv(qnx->event, SCREEN_PROPERTY_FLAGS, &flags);
+  screen_get_event_property_iv(qnx->event, SCREEN_PROPERTY_SYM, &key_sym);
+
+  // Keys stand in for the keypad keys with the same role, the game acts on them the same way
+  int key;
+  switch (key_sym) {
+    case KEYCODE_P:
+      key = RMP_EVENT_PLAY_PAUSE;
+      break;
+    case KEYCODE_Q:
+      key = RMP_EVENT_QUIT;
+      break;
+    case KEYCODE_I:
+      key = RMP_EVENT_TOGGLE_AI;
+      break;
+    case KEYCODE_W:
+      key = RMP_EVENT_PAD_A_UP;
+      break;
+    case KEYCODE_S:
+      key = RMP_EVENT_PAD_A_DOWN;
+      break;
+    case KEYCODE_UP:
+      key = RMP_EVENT_PAD_B_UP;
+      break;
+    case KEYCODE_DOWN:
+      key = RMP_EVENT_PAD_B_DOWN;
+      break;
+    default:
+      return;
+  }
+
+  // A repeat is still down, only the press and the release change anything
+  if (flags & KEY_DOWN) {
+    qnx->keys |= 1u << key;
+  }
+  else {
+    qnx->keys &= ~(1u << key);
+  }
+}
+
+static void send_keys(rmp_render_qnx_t* qnx, rmp_app_t* app) {
+  // Only a change the sim got is marked sent, a full queue leaves it for the next poll
+  unsigned changed = qnx->keys ^ qnx->keys_sent;
+  for (int i = 0; changed; ++i, changed >>= 1) {
+    if (!(changed & 1)) {
+      continue;
+    }
+
+    bool down = qnx->keys & (1u << i);
+    if (rmp_app_post_keyboard_event(app, (down ? RMP_KEYDOWN : RMP_KEYUP) | i)) {
+      qnx->keys_sent ^= 1u << i;
+    }
+  }
+}
+
+#endif // RMP_CONFIG_USE_KEYBOARD == 1
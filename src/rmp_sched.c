@@ -0,0 +1,230 @@
+#if defined(__linux__)
+#define _GNU_SOURCE
+#endif
+
+#include "rmp_sched.h"
+#include "rmp_config.h"
+#include "rmp_log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <unistd.h>
+
+#if defined(__QNX__)
+#include <sys/neutrino.h>
+#elif defined(__linux__)
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#endif
+
+typedef struct {
+  rmp_sched_policy_e policy;
+  rmp_sched_thread_t thread;
+  void* (*fn)(void*);
+  void* arg;
+} spawn_args_t;
+
+static void* spawn_entry(void* args);
+static void set_affinity(const rmp_sched_thread_t* thread);
+static rmp_schedRet_e set_nice(const rmp_sched_thread_t* thread);
+
+rmp_schedRet_e rmp_sched_profile_init(rmp_sched_profile_t* profile, const char* policy) {
+  if (!profile) {
+    return RMP_SCHED_BAD_ARGS;
+  }
+
+  if (!policy || strcmp(policy, "none") == 0) {
+    profile->policy = RMP_SCHED_POLICY_NONE;
+  }
+  else if (strcmp(policy, "fifo") == 0) {
+    profile->policy = RMP_SCHED_POLICY_FIFO;
+  }
+  else if (strcmp(policy, "rr") == 0) {
+    profile->policy = RMP_SCHED_POLICY_RR;
+  }
+  else {
+    rmp_log_error("sched", "Unknown scheduling policy %s\n", policy);
+    return RMP_SCHED_BAD_ARGS;
+  }
+
+  profile->app = (rmp_sched_thread_t){
+    "app", RMP_CONFIG_SCHED_APP_PRIORITY, RMP_CONFIG_SCHED_APP_CPU, RMP_CONFIG_SCHED_APP_NICE
+  };
+  profile->keypad = (rmp_sched_thread_t){
+    "keypad", RMP_CONFIG_SCHED_KEYPAD_PRIORITY, RMP_CONFIG_SCHED_KEYPAD_CPU,
+    RMP_CONFIG_SCHED_KEYPAD_NICE
+  };
+  profile->screen = (rmp_sched_thread_t){
+    "screen", RMP_CONFIG_SCHED_SCREEN_PRIORITY, RMP_CONFIG_SCHED_SCREEN_CPU,
+    RMP_CONFIG_SCHED_SCREEN_NICE
+  };
+
+  return RMP_SCHED_OK;
+}
+
+rmp_schedRet_e rmp_sched_apply(rmp_sched_policy_e policy, const rmp_sched_thread_t* thread) {
+  if (!thread) {
+    return RMP_SCHED_BAD_ARGS;
+  }
+
+  if (policy == RMP_SCHED_POLICY_NONE) {
+    return RMP_SCHED_OK;
+  }
+
+  set_affinity(thread);
+
+  int sched_policy = (policy == RMP_SCHED_POLICY_FIFO) ? SCHED_FIFO : SCHED_RR;
+  struct sched_param param;
+  memset(&param, 0, sizeof(param));
+  param.sched_priority = thread->priority;
+
+  int min = sched_get_priority_min(sched_policy);
+  int max = sched_get_priority_max(sched_policy);
+  if (param.sched_priority < min) {
+    param.sched_priority = min;
+  }
+  else if (param.sched_priority > max) {
+    param.sched_priority = max;
+  }
+
+  int err = pthread_setschedparam(pthread_self(), sched_policy, &param);
+  if (err == 0) {
+    rmp_log_info("sched", "%s: %s priority %d\n", thread->name,
+                 (sched_policy == SCHED_FIFO) ? "SCHED_FIFO" : "SCHED_RR", param.sched_priority);
+    return RMP_SCHED_OK;
+  }
+
+  if (err != EPERM) {
+    rmp_log_error("sched", "%s: Failed to set scheduling policy (%s)\n", thread->name,
+                  strerror(err));
+    return RMP_SCHED_BAD_INIT;
+  }
+
+  return set_nice(thread);
+}
+
+rmp_schedRet_e rmp_sched_spawn(pthread_t* tid, rmp_sched_policy_e policy,
+                               const rmp_sched_thread_t* thread, void* (*fn)(void*), void* arg) {
+  if (!tid || !thread || !fn) {
+    return RMP_SCHED_BAD_ARGS;
+  }
+
+  spawn_args_t* args = malloc(sizeof(*args));
+  if (!args) {
+    return RMP_SCHED_BAD_INIT;
+  }
+
+  args->policy = policy;
+  args->thread = *thread;
+  args->fn = fn;
+  args->arg = arg;
+
+  if (pthread_create(tid, NULL, spawn_entry, args) != 0) {
+    free(args);
+    return RMP_SCHED_BAD_INIT;
+  }
+
+  return RMP_SCHED_OK;
+}
+
+void rmp_sched_probe_record(rmp_sched_probe_t* probe, time_t deadline_us, time_t now_us) {
+  if (!probe) {
+    return;
+  }
+
+  time_t late = now_us - deadline_us;
+  if (late < 0) {
+    late = 0;
+  }
+
+  probe->wakeups++;
+  probe->late_total_us += late;
+  if (late > probe->late_max_us) {
+    probe->late_max_us = late;
+  }
+
+  int bucket = 0;
+  while (bucket < RMP_SCHED_PROBE_BUCKETS - 1 && ((time_t)1 << bucket) <= late) {
+    bucket++;
+  }
+  probe->buckets[bucket]++;
+}
+
+void rmp_sched_probe_log(const char* author, const rmp_sched_probe_t* probe) {
+  if (!probe) {
+    return;
+  }
+
+  long avg = probe->wakeups ? (long)(probe->late_total_us / (time_t)probe->wakeups) : 0;
+
+  // Upper bound of the bucket holding the 99th percentile
+  long p99 = 0;
+  unsigned long seen = 0;
+  for (int i = 0; i < RMP_SCHED_PROBE_BUCKETS && probe->wakeups; ++i) {
+    seen += probe->buckets[i];
+    if (seen * 100 >= probe->wakeups * 99) {
+      p99 = (i == RMP_SCHED_PROBE_BUCKETS - 1) ? (long)probe->late_max_us : (1L << i);
+      break;
+    }
+  }
+
+  rmp_log_info(author, "Wake-up latency\n");
+  printf("    wakeups : %lu\n", probe->wakeups);
+  printf("    late    : %ld us avg, %ld us max, p99 <= %ld us\n",
+         avg, (long)probe->late_max_us, p99);
+}
+
+static void* spawn_entry(void* args) {
+  spawn_args_t spawn = *(spawn_args_t*)args;
+  free(args);
+
+  rmp_sched_apply(spawn.policy, &spawn.thread);
+  return spawn.fn(spawn.arg);
+}
+
+static void set_affinity(const rmp_sched_thread_t* thread) {
+  if (thread->cpu < 0) {
+    return;
+  }
+
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  if (thread->cpu >= cpus) {
+    rmp_log_warn("sched", "%s: CPU %d not available, leaving thread unpinned\n",
+                 thread->name, thread->cpu);
+    return;
+  }
+
+  bool pinned = false;
+#if defined(__QNX__)
+  pinned = ThreadCtl(_NTO_TCTL_RUNMASK, (void*)(uintptr_t)(1u << thread->cpu)) != -1;
+#elif defined(__linux__)
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(thread->cpu, &set);
+  pinned = pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#endif
+
+  if (!pinned) {
+    rmp_log_warn("sched", "%s: Failed to pin thread to CPU %d\n", thread->name, thread->cpu);
+  }
+}
+
+static rmp_schedRet_e set_nice(const rmp_sched_thread_t* thread) {
+  // Niceness is per thread on Linux only, elsewhere it would apply to every component at once
+#if defined(__linux__)
+  if (setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), thread->nice) == 0) {
+    rmp_log_warn("sched", "%s: No permission for real-time policy, using nice %d\n",
+                 thread->name, thread->nice);
+    return RMP_SCHED_OK;
+  }
+#endif
+
+  rmp_log_warn("sched", "%s: No permission for real-time policy, using default priority\n",
+               thread->name);
+  return RMP_SCHED_OK;
+}
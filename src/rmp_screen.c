@@ -3,81 +3,122 @@
 #include "rmp_time.h"
 #include "rmp_log.h"
 #include "rmp_config.h"
+#include "rmp_sched.h"
 
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <time.h>
 #include <pthread.h>
-#include <sys/keycodes.h>
 #include <stdint.h>
+#include <math.h>
 
-#define RMP_SCREEN_TARGET_FPS 120
-#define RMP_SCREEN_FRAME_TIME_US (1000000 / RMP_SCREEN_TARGET_FPS)
 #define BACKGROUND_COLOR 0xff000000
 #define PAD_COLOR        0xffffffff
 #define AI_PAD_COLOR     0xff222222
 #define BALL_COLOR       0xffffffff
-
-#if RMP_CONFIG_USE_KEYBOARD == 1
-static void poll_events(rmp_screen_t* screen, rmp_app_t* app);
-static void handle_keyboard_events(rmp_screen_t* screen, rmp_app_t* app, int pad_movements[2]);
-#endif // RMP_CONFIG_USE_KEYBOARD == 1
-
-static void render(rmp_screen_t* screen, rmp_app_t* app);
-static void draw_rectangle(rmp_screen_t* screen, int x, int y, int width, int height, uint32_t color);
-
-rmp_screenRet_e rmp_screen_init(rmp_screen_t* screen, rmp_app_t* app) {
+#define MARKER_COLOR     0xffff0000
+
+#define RMP_SCREEN_HUD_MARGIN 8
+
+// Paint order of the command list, everything in one layer shares a color or never overlaps
+enum {
+  LAYER_BACKGROUND,
+  LAYER_PAD_A,
+  LAYER_PAD_B,
+  LAYER_BALL,
+  LAYER_BALLS,
+  LAYER_MARKERS,
+  LAYER_HUD
+};
+
+static int collect_items(rmp_screen_t* screen, const rmp_app_snapshot_t* snapshot, time_t now_us);
+static void set_map(rmp_screen_t* screen, const rmp_app_snapshot_t* snapshot);
+static int map_axis(double value, double offset, double factor);
+static void push_item(rmp_screen_t* screen, int* count, int layer, int x, int y, int width,
+                      int height, uint32_t color);
+static void push_hud(rmp_screen_t* screen, int* count, const rmp_app_snapshot_t* snapshot,
+                     time_t now_us);
+static bool same_frame(const rmp_screen_t* screen, const rmp_screen_frame_t* drawn, int count,
+                       bool recalibrating);
+static int find_damage(rmp_screen_t* screen, const rmp_screen_frame_t* drawn, int count);
+static int diff_frames(rmp_screen_t* screen, const rmp_screen_frame_t* drawn, int count,
+                       rmp_rect_t* rects);
+static void add_damage(rmp_screen_t* screen, rmp_rect_t* rects, int* count, rmp_rect_t prev,
+                       rmp_rect_t cur);
+static void draw_full(rmp_screen_t* screen, int count);
+static void draw_damage(rmp_screen_t* screen, const rmp_screen_frame_t* drawn, int count);
+static void fill(rmp_screen_t* screen, int layer, rmp_rect_t rect, uint32_t color);
+static void draw_item(rmp_screen_t* screen, const rmp_screen_item_t* item);
+static void submit(rmp_screen_t* screen);
+static rmp_rect_t clip_rect(const rmp_screen_t* screen, rmp_rect_t rect);
+static rmp_rect_t union_rect(rmp_rect_t a, rmp_rect_t b);
+static bool rects_touch(rmp_rect_t a, rmp_rect_t b);
+static bool item_changed(const rmp_screen_t* screen, const rmp_screen_frame_t* drawn, int i);
+
+rmp_screenRet_e rmp_screen_init(rmp_screen_t* screen, rmp_app_t* app, int render_scale,
+                                rmp_fb_format_e format) {
   if (!screen || !app) {
     return RMP_SCREEN_BAD_ARGS;
   }
 
-  int rc = screen_create_context(&screen->ctx, 0);
-  if (rc) {
-    rmp_log_error("screen", "Failed to create screen context\n");
-    return RMP_SCREEN_BAD_INIT;
+#if defined(__QNX__)
+  if (render_scale != 1) {
+    rmp_log_error("screen", "Render scale %d is only supported by the fb backend\n", render_scale);
   }
-
-  rc = screen_create_window(&screen->win, screen->ctx);
-  if (rc) {
-    rmp_log_error("screen", "Failed to create screen window\n");
-    screen_destroy_context(screen->ctx);
+  rmp_renderRet_e rc = rmp_render_qnx_init(&screen->render, RMP_CONFIG_SWAPCHAIN_BUFFERS, format);
+#else
+  rmp_renderRet_e rc = rmp_render_fb_init(&screen->render, RMP_CONFIG_FB_WIDTH,
+                                          RMP_CONFIG_FB_HEIGHT, RMP_CONFIG_SWAPCHAIN_BUFFERS,
+                                          RMP_CONFIG_FB_REFRESH_HZ, render_scale, format);
+#endif // __QNX__
+  if (rc != RMP_RENDER_OK) {
     return RMP_SCREEN_BAD_INIT;
   }
 
-  int format = SCREEN_FORMAT_RGBA8888;
-  screen_set_window_property_iv(screen->win, SCREEN_PROPERTY_FORMAT, &format);
-
-  int usage = SCREEN_USAGE_ROTATION | SCREEN_USAGE_WRITE;
-  screen_set_window_property_iv(screen->win, SCREEN_PROPERTY_USAGE, &usage);
-
-  rc = screen_create_window_buffers(screen->win, 1);
-  if (rc) {
-    rmp_log_error("screen", "Failed to create screen window buffers\n");
-    screen_destroy_window(screen->win);
-    screen_destroy_context(screen->ctx);
+  if (rmp_swapchain_init(&screen->swapchain, screen->render.buffer_count,
+                         screen->render.refresh_hz, rmp_time_get_us()) != RMP_SWAPCHAIN_OK) {
+    rmp_log_error("screen", "Failed to create swapchain\n");
+    screen->render.free(&screen->render);
     return RMP_SCREEN_BAD_INIT;
   }
+  screen->swapchain.external = screen->render.acquire != NULL;
 
-  screen_get_window_property_pv(screen->win, SCREEN_PROPERTY_RENDER_BUFFERS,
-                                (void**)&screen->buf);
-
-  rc = screen_create_event(&screen->event);
-  if (rc) {
-    rmp_log_error("screen", "Failed to create event\n");
-    screen_destroy_window(screen->win);
-    screen_destroy_context(screen->ctx);
+  // Worst case frame: a clear for every damaged rect plus a fill for every item
+  if (rmp_cmd_list_init(&screen->commands, RMP_SCREEN_MAX_DAMAGE + RMP_SCREEN_MAX_ITEMS + 1) !=
+      RMP_CMD_OK) {
+    screen->render.free(&screen->render);
     return RMP_SCREEN_BAD_INIT;
   }
 
-  int sensitivity = SCREEN_SENSITIVITY_ALWAYS;
-  screen_set_window_property_iv(screen->win, SCREEN_PROPERTY_SENSITIVITY, &sensitivity);
-
-  int foucs = 1;
-  screen_set_window_property_iv(screen->win, SCREEN_PROPERTY_FOCUS, &foucs);
+  // Packed once here, every fill of a frame then stores the pixel value as it is
+  screen->palette = (rmp_screen_palette_t){
+    rmp_fb_pack(format, BACKGROUND_COLOR),
+    rmp_fb_pack(format, PAD_COLOR),
+    rmp_fb_pack(format, AI_PAD_COLOR),
+    rmp_fb_pack(format, BALL_COLOR),
+    rmp_fb_pack(format, MARKER_COLOR)
+  };
 
   screen->app = app;
-
-  rmp_log_info("screen", "Initialized screen\n");
+  screen->capture = NULL;
+  screen->hud = NULL;
+  screen->next_frame_us = rmp_time_get_us();
+  memset(&screen->probe, 0, sizeof(screen->probe));
+  memset(&screen->stats, 0, sizeof(screen->stats));
+
+  // Nothing drawn yet, the first frame in every buffer is a full one
+  for (int i = 0; i < RMP_SWAPCHAIN_MAX_BUFFERS; ++i) {
+    screen->drawn[i].count = -1;
+  }
+  screen->front = -1;
+  screen->damage_tracking = true;
+  screen->generation = 0;
+  screen->settled = false;
+  screen->idle = false;
+  screen->damage_count = 0;
+
+  rmp_log_info("screen", "Initialized screen on %s backend\n", screen->render.name);
   return RMP_SCREEN_OK;
 }
 
@@ -86,8 +127,8 @@ rmp_screenRet_e rmp_screen_free(rmp_screen_t* screen) {
     return RMP_SCREEN_BAD_ARGS;
   }
 
-  screen_destroy_window(screen->win);
-  screen_destroy_context(screen->ctx);
+  screen->render.free(&screen->render);
+  rmp_cmd_list_free(&screen->commands);
 
   return RMP_SCREEN_OK;
 }
@@ -101,171 +142,457 @@ void* rmp_screen_run(void* args) {
   rmp_app_t* app = screen->app;
 
   rmp_log_info("screen", "Started screen render\n");
-  while (true) {
-    pthread_mutex_lock(&app->mutex);
-    if (!app->running) {
-      break;
+  time_t deadline = rmp_time_get_us();
+  while (rmp_app_is_running(app)) {
+    time_t now = rmp_time_get_us();
+    rmp_sched_probe_record(&screen->probe, deadline, now);
+    atomic_fetch_add(&app->loop_wakeups, 1);
+    deadline = rmp_screen_step(screen, now);
+
+    // Nothing will change on screen until the game resumes or input arrives
+    if (deadline == RMP_TIME_NEVER) {
+      rmp_app_wait_for_change(app, screen->generation);
+      deadline = rmp_time_get_us();
+      continue;
     }
-    pthread_mutex_unlock(&app->mutex);
 
-    time_t frame_start = rmp_time_get_us();
-#if RMP_CONFIG_USE_KEYBOARD == 1
-    poll_events(screen, app);
-#endif // RMP_CONFIG_USE_KEYBOARD == 1
-    render(screen, app);
-    time_t frame_duration = rmp_time_get_us() - frame_start;
-
-    if (frame_duration < RMP_SCREEN_FRAME_TIME_US) {
-      usleep(RMP_SCREEN_FRAME_TIME_US - frame_duration);
-    }
+    rmp_time_sleep_until_us(deadline);
   }
-  pthread_mutex_unlock(&app->mutex);
 
   return NULL;
 }
 
-#if RMP_CONFIG_USE_KEYBOARD == 1
-
-static void poll_events(rmp_screen_t* screen, rmp_app_t* app) {
-  if (!screen || !app) {
-    return;
+time_t rmp_screen_step(rmp_screen_t* screen, time_t now_us) {
+  if (!screen) {
+    return now_us;
   }
 
-  int rc = screen_get_event(screen->ctx, screen->event, 0);
-  int pad_movements[2] = {0};
-
-  if (rc == 0) {
-    pthread_mutex_lock(&app->mutex);
-
-    int event_type;
-    screen_get_event_property_iv(screen->event, SCREEN_PROPERTY_TYPE, &event_type);
+  if (now_us < screen->next_frame_us) {
+    return screen->next_frame_us;
+  }
 
-    switch (event_type) {
-      case SCREEN_EVENT_KEYBOARD:
-        handle_keyboard_events(screen, app, pad_movements);
-        break;
+  // Frames are paced by the display, one per vblank, never a backlog of them. Where it reports its
+  // vsync that is waited on, otherwise the vblank clock runs from the refresh rate
+  time_t vsync_us = screen->render.wait_vsync ? screen->render.wait_vsync(&screen->render) : -1;
+  if (vsync_us >= 0) {
+    now_us = vsync_us;
+    rmp_swapchain_vsync(&screen->swapchain, vsync_us);
+  }
+  else if (screen->idle) {
+    rmp_swapchain_resume(&screen->swapchain, now_us);
+  }
+  else {
+    rmp_swapchain_vblank(&screen->swapchain, now_us);
+  }
+  screen->idle = false;
 
-      case SCREEN_EVENT_CLOSE:
-        app->running = false;
-        pthread_cond_signal(&app->cond);
-        break;
-    }
+  if (screen->render.poll) {
+    screen->render.poll(&screen->render, screen->app);
+  }
+  rmp_screen_render(screen, now_us);
 
-    pthread_mutex_unlock(&app->mutex);
+  // Idle once the last frame is final, screens with their own input keep polling it
+  rmp_app_t* app = screen->app;
+  if (app->governor && !screen->render.poll && screen->settled && rmp_app_is_idle(app)) {
+    screen->idle = true;
+    return RMP_TIME_NEVER;
   }
 
-  rmp_vec2_set(&app->pad_a.vel, 0, app->pad_speed * pad_movements[0]);
-  rmp_vec2_set(&app->pad_b.vel, 0, app->pad_speed * pad_movements[1]);
+  screen->next_frame_us = screen->swapchain.next_vblank_us;
+  if (screen->render.wait_vsync) {
+    screen->next_frame_us -= RMP_CONFIG_SCREEN_VSYNC_MARGIN_US;
+  }
+  return screen->next_frame_us;
 }
 
-static void handle_keyboard_events(rmp_screen_t* screen, rmp_app_t* app, int pad_movements[2]) {
-  if (!screen || !app) {
+void rmp_screen_render(rmp_screen_t* screen, time_t now_us) {
+  if (!screen) {
     return;
   }
 
-  int flags, modifiers, key_sym, key_cap;
+  // Work from a consistent copy, the sim thread keeps stepping while we draw
+  rmp_app_snapshot_t snapshot;
+  rmp_app_read_snapshot(screen->app, &snapshot);
 
-  screen_get_event_property_iv(screen->event, SCREEN_PROPERTY_FLAGS, &flags);
-  screen_get_event_property_iv(screen->event, SCREEN_PROPERTY_MODIFIERS, &modifiers);
-  screen_get_event_property_iv(screen->event, SCREEN_PROPERTY_SYM, &key_sym);
-  screen_get_event_property_iv(screen->event, SCREEN_PROPERTY_KEY_CAP, &key_cap);
+  screen->stats.frames++;
+  screen->frame_pixels = 0;
 
-  if ((flags & KEY_DOWN) && key_sym == KEYCODE_P) {
-    app->paused = !app->paused;
+  // Render on change, the same settled snapshot always draws the same frame
+  bool settled = rmp_app_get_alpha(&snapshot, now_us) >= 1.0;
+  if (snapshot.generation == screen->generation && screen->settled) {
+    return;
   }
-  else if ((flags & KEY_DOWN) && key_sym == KEYCODE_Q) {
-    app->running = false;
-    pthread_cond_signal(&app->cond);
+  screen->generation = snapshot.generation;
+  screen->settled = settled;
+
+  int count = collect_items(screen, &snapshot, now_us);
+
+  // Nothing moved since the last presented frame, it is still correct
+  if (screen->front >= 0 &&
+      same_frame(screen, &screen->drawn[screen->front], count, snapshot.recalibrating)) {
+    return;
   }
-  else if ((flags & KEY_DOWN) && key_sym == KEYCODE_I) {
-    app->ai_is_playing = !app->ai_is_playing;
+
+  time_t start_us = rmp_time_get_us();
+  // The platform knows which buffers the display still holds, it is asked rather than the model
+  int buffer = screen->render.acquire
+                   ? rmp_swapchain_adopt(&screen->swapchain, screen->render.acquire(&screen->render))
+                   : rmp_swapchain_acquire(&screen->swapchain);
+  if (buffer < 0) {
+    return;
   }
 
-  pad_movements[0] = pad_movements[1] = 0;
-  bool is_pressed = (flags & KEY_DOWN) || (flags & KEY_REPEAT);
+  screen->render.select(&screen->render, buffer);
+  rmp_cmd_list_reset(&screen->commands, screen->render.width, screen->render.height,
+                     rmp_fb_bytes_per_pixel(screen->render.format));
+  rmp_screen_frame_t* drawn = &screen->drawn[buffer];
+
+  // Present and the capture ring hold the previously presented frame, they take what changed
+  // since. That is not the damage drawn below when this buffer is older than the front one
+  int changed_count = -1;
+  if (screen->front >= 0) {
+    const rmp_screen_frame_t* front = &screen->drawn[screen->front];
+    if (count == front->count && snapshot.recalibrating == front->recalibrating &&
+        screen->render.width == front->width && screen->render.height == front->height) {
+      changed_count = diff_frames(screen, front, count, screen->changed);
+    }
+  }
 
-  if (is_pressed && key_sym == KEYCODE_S) {
-    pad_movements[0] = 1;
+  // The buffer may be a few frames old, the damage is measured against what it actually holds.
+  // Anything that changes the layout repaints the whole buffer
+  bool full = !screen->damage_tracking || count != drawn->count ||
+              snapshot.recalibrating || drawn->recalibrating ||
+              screen->render.width != drawn->width ||
+              screen->render.height != drawn->height;
+
+  if (full) {
+    draw_full(screen, count);
   }
-  else if (is_pressed && key_sym == KEYCODE_W) {
-    pad_movements[0] = -1;
+  else {
+    find_damage(screen, drawn, count);
+    draw_damage(screen, drawn, count);
   }
-  else if (is_pressed && key_sym == KEYCODE_DOWN && !app->ai_is_playing) {
-    pad_movements[1] = 1;
+  screen->render.present(&screen->render, changed_count >= 0 ? screen->changed : NULL,
+                         changed_count);
+
+  memcpy(drawn->items, screen->items, count * sizeof(screen->items[0]));
+  drawn->count = count;
+  drawn->width = screen->render.width;
+  drawn->height = screen->render.height;
+  drawn->recalibrating = snapshot.recalibrating;
+  screen->front = buffer;
+
+  // A copy into the capture ring, the writer thread does the encoding and the disk
+  rmp_fb_t view;
+  if (screen->capture && screen->render.view(&screen->render, buffer, &view)) {
+    rmp_capture_push(screen->capture, &view, changed_count >= 0 ? screen->changed : NULL,
+                     changed_count, screen->stats.frames);
   }
-  else if (is_pressed && key_sym == KEYCODE_UP && !app->ai_is_playing) {
-    pad_movements[1] = -1;
+
+  time_t render_us = rmp_time_get_us() - start_us;
+  rmp_swapchain_present(&screen->swapchain, buffer, now_us + render_us);
+  rmp_hud_record_frame(screen->hud, render_us);
+
+  screen->stats.rendered++;
+  screen->stats.full_frames += full;
+  screen->stats.pixels_total += screen->frame_pixels;
+  if (screen->frame_pixels > screen->stats.pixels_max) {
+    screen->stats.pixels_max = screen->frame_pixels;
   }
 }
 
-#endif // RMP_CONFIG_USE_KEYBOARD == 1
-
-static void render(rmp_screen_t* screen, rmp_app_t* app) {
-  if (!screen || !app) {
+void rmp_screen_log_stats(const rmp_screen_t* screen) {
+  if (!screen) {
     return;
   }
 
-  int win_background[] = {SCREEN_BLIT_COLOR, BACKGROUND_COLOR, SCREEN_BLIT_END};
-  screen_fill(screen->ctx, screen->buf, win_background);
+  const rmp_screen_stats_t* stats = &screen->stats;
+  unsigned long long avg = stats->frames ? stats->pixels_total / stats->frames : 0;
+
+  rmp_log_info("screen", "Frame damage\n");
+  printf("    frames  : %lu (%lu rendered, %lu full)\n",
+         stats->frames, stats->rendered, stats->full_frames);
+  printf("    pixels  : %llu avg, %lu max per frame\n", avg, stats->pixels_max);
+  printf("    commands: %llu pushed, %llu submitted\n", screen->commands.stats.pushed,
+         screen->commands.stats.submitted);
+
+  rmp_swapchain_log_stats(&screen->swapchain);
+}
+
+static int collect_items(rmp_screen_t* screen, const rmp_app_snapshot_t* snapshot, time_t now_us) {
+  // Draw between the last two simulation steps so 30 Hz motion looks smooth at the display rate
+  double alpha = rmp_app_get_alpha(snapshot, now_us);
+  rmp_app_entity_t pad_a, pad_b, ball;
+  rmp_app_lerp_entity(&pad_a, snapshot->prev_pad_a, snapshot->pad_a, alpha);
+  rmp_app_lerp_entity(&pad_b, snapshot->prev_pad_b, snapshot->pad_b, alpha);
+  rmp_app_lerp_entity(&ball, snapshot->prev_ball, snapshot->ball, alpha);
+
+  set_map(screen, snapshot);
+  int count = 0;
 
   /// Pad A
-  draw_rectangle(screen,
-                 app->pad_a.pos.x,
-                 app->pad_a.pos.y,
-                 app->pad_a.size.x,
-                 app->pad_a.size.y,
-                 PAD_COLOR);
+  push_item(screen, &count, LAYER_PAD_A,
+            pad_a.pos.x,
+            pad_a.pos.y,
+            pad_a.size.x,
+            pad_a.size.y,
+            screen->palette.pad);
 
   /// Pad B
-  draw_rectangle(screen,
-                 app->pad_b.pos.x,
-                 app->pad_b.pos.y,
-                 app->pad_b.size.x,
-                 app->pad_b.size.y,
-                 app->ai_is_playing ? AI_PAD_COLOR : PAD_COLOR);
+  push_item(screen, &count, LAYER_PAD_B,
+            pad_b.pos.x,
+            pad_b.pos.y,
+            pad_b.size.x,
+            pad_b.size.y,
+            snapshot->ai_is_playing ? screen->palette.ai_pad : screen->palette.pad);
 
   /// Ball
-  draw_rectangle(screen,
-                 app->ball.pos.x,
-                 app->ball.pos.y,
-                 app->ball.size.x,
-                 app->ball.size.y,
-                 PAD_COLOR);
-
-  if (app->recalibrating) {
+  push_item(screen, &count, LAYER_BALL,
+            ball.pos.x,
+            ball.pos.y,
+            ball.size.x,
+            ball.size.y,
+            screen->palette.pad);
+
+  /// Multi-ball
+  for (int i = 0; i < snapshot->ball_count; ++i) {
+    push_item(screen, &count, LAYER_BALLS,
+              snapshot->ball_x[i],
+              snapshot->ball_y[i],
+              snapshot->ball_size,
+              snapshot->ball_size,
+              screen->palette.ball);
+  }
+
+  if (snapshot->recalibrating) {
     /// Top left corner
-    draw_rectangle(screen,
-                   app->SCREEN_START.x,
-                   app->SCREEN_START.y,
-                   5,
-                   5,
-                   0xffff0000);
+    push_item(screen, &count, LAYER_MARKERS,
+              snapshot->SCREEN_START.x,
+              snapshot->SCREEN_START.y,
+              5,
+              5,
+              screen->palette.marker);
 
     /// Bottom right corner
-    draw_rectangle(screen,
-                   app->SCREEN_END.x,
-                   app->SCREEN_END.y,
-                   5,
-                   5,
-                   0xffff0000);
+    push_item(screen, &count, LAYER_MARKERS,
+              snapshot->SCREEN_END.x,
+              snapshot->SCREEN_END.y,
+              5,
+              5,
+              screen->palette.marker);
   }
 
-  screen_post_window(screen->win, screen->buf, 0, NULL, 0);
+  push_hud(screen, &count, snapshot, now_us);
+
+  return count;
 }
 
-static void draw_rectangle(rmp_screen_t* screen, int x, int y, int width, int height, uint32_t color) {
-  if (!screen) {
+static void push_item(rmp_screen_t* screen, int* count, int layer, int x, int y, int width,
+                      int height, uint32_t color) {
+  if (*count >= RMP_SCREEN_MAX_ITEMS) {
     return;
   }
 
-  int attribs[] = {
-    SCREEN_BLIT_DESTINATION_X, x,
-    SCREEN_BLIT_DESTINATION_Y, y,
-    SCREEN_BLIT_DESTINATION_WIDTH, width,
-    SCREEN_BLIT_DESTINATION_HEIGHT, height,
-    SCREEN_BLIT_COLOR, color,
-    SCREEN_BLIT_END
-  };
+  rmp_screen_item_t* item = &screen->items[(*count)++];
+  item->rect = (rmp_rect_t){x, y, width, height};
+  item->color = color;
+  item->layer = layer;
+  item->image = NULL;
+
+  // Game coordinates are window pixels, a scaled down target gets them through the map. Sizes are
+  // mapped apart from positions so a moving item keeps its size
+  if (screen->render.scale_x > 1 || screen->render.scale_y > 1) {
+    const rmp_screen_map_t* map = &screen->map;
+    item->rect.x = map_axis(x, map->offset_x, map->factor_x);
+    item->rect.y = map_axis(y, map->offset_y, map->factor_y);
+    int mapped_width = map_axis(width, 0, map->factor_x);
+    int mapped_height = map_axis(height, 0, map->factor_y);
+    item->rect.width = mapped_width > 1 ? mapped_width : 1;
+    item->rect.height = mapped_height > 1 ? mapped_height : 1;
+  }
+}
+
+static void set_map(rmp_screen_t* screen, const rmp_app_snapshot_t* snapshot) {
+  // The calibrated field lands on whole target pixels so items against its edges stay flush with
+  // them, everything else is stretched linearly between
+  double scale[2] = {screen->render.scale_x, screen->render.scale_y};
+  double start[2] = {snapshot->SCREEN_START.x, snapshot->SCREEN_START.y};
+  double end[2] = {snapshot->SCREEN_END.x, snapshot->SCREEN_END.y};
+  double offset[2];
+  double factor[2];
+
+  for (int i = 0; i < 2; ++i) {
+    double target_start = round(start[i] / scale[i]);
+    double target_end = round(end[i] / scale[i]);
+    factor[i] = end[i] > start[i] ? (target_end - target_start) / (end[i] - start[i])
+                                  : 1.0 / scale[i];
+    offset[i] = target_start - start[i] * factor[i];
+  }
+
+  screen->map = (rmp_screen_map_t){offset[0], offset[1], factor[0], factor[1]};
+}
+
+static int map_axis(double value, double offset, double factor) {
+  return (int)lround(offset + value * factor);
+}
+
+static void push_hud(rmp_screen_t* screen, int* count, const rmp_app_snapshot_t* snapshot,
+                     time_t now_us) {
+  // The atlas is copied as it is, so it must be in the format of the target
+  rmp_hud_t* hud = screen->hud;
+  if (!hud || hud->format != screen->render.format) {
+    return;
+  }
+
+  long latency_us = atomic_load_explicit(&screen->app->input_latency_us, memory_order_relaxed);
+  rmp_hud_update(hud, now_us, snapshot->generation, latency_us);
+
+  /// Performance overlay, one atlas cell per character
+  for (int i = 0; i < hud->length && *count < RMP_SCREEN_MAX_ITEMS; ++i) {
+    rmp_screen_item_t* item = &screen->items[(*count)++];
+    item->rect = (rmp_rect_t){RMP_SCREEN_HUD_MARGIN + i * RMP_HUD_CELL_WIDTH,
+                              RMP_SCREEN_HUD_MARGIN,
+                              RMP_HUD_CELL_WIDTH,
+                              RMP_HUD_CELL_HEIGHT};
+    item->color = 0;
+    item->layer = LAYER_HUD;
+    item->image = rmp_hud_glyph(hud, i);
+  }
+}
+
+static bool same_frame(const rmp_screen_t* screen, const rmp_screen_frame_t* drawn, int count,
+                       bool recalibrating) {
+  return drawn->count == count && drawn->recalibrating == recalibrating &&
+         drawn->width == screen->render.width && drawn->height == screen->render.height &&
+         memcmp(drawn->items, screen->items, count * sizeof(screen->items[0])) == 0;
+}
+
+static int find_damage(rmp_screen_t* screen, const rmp_screen_frame_t* drawn, int count) {
+  screen->damage_count = diff_frames(screen, drawn, count, screen->damage);
+  return screen->damage_count;
+}
+
+static int diff_frames(rmp_screen_t* screen, const rmp_screen_frame_t* drawn, int count,
+                       rmp_rect_t* rects) {
+  int rect_count = 0;
+
+  for (int i = 0; i < count; ++i) {
+    if (item_changed(screen, drawn, i)) {
+      add_damage(screen, rects, &rect_count, drawn->items[i].rect, screen->items[i].rect);
+    }
+  }
+
+  return rect_count;
+}
+
+static void add_damage(rmp_screen_t* screen, rmp_rect_t* rects, int* count, rmp_rect_t prev,
+                       rmp_rect_t cur) {
+  prev = clip_rect(screen, prev);
+  cur = clip_rect(screen, cur);
+
+  // Small moves overlap the old position, one bounding rect covers both
+  if (prev.width > 0 && cur.width > 0 && rects_touch(prev, cur)) {
+    rects[(*count)++] = union_rect(prev, cur);
+    return;
+  }
+
+  if (prev.width > 0) {
+    rects[(*count)++] = prev;
+  }
+  if (cur.width > 0) {
+    rects[(*count)++] = cur;
+  }
+}
+
+static void draw_full(rmp_screen_t* screen, int count) {
+  rmp_rect_t window = {0, 0, screen->render.width, screen->render.height};
+  fill(screen, LAYER_BACKGROUND, window, screen->palette.background);
+
+  for (int i = 0; i < count; ++i) {
+    draw_item(screen, &screen->items[i]);
+  }
+
+  submit(screen);
+}
+
+static void draw_damage(rmp_screen_t* screen, const rmp_screen_frame_t* drawn, int count) {
+  for (int d = 0; d < screen->damage_count; ++d) {
+    fill(screen, LAYER_BACKGROUND, screen->damage[d], screen->palette.background);
+  }
+
+  // Redraw what moved, and whatever stood still under a cleared rect. A game item redrawn whole
+  // can reach past the damage under an overlay cell, so the overlay also covers what was painted
+  rmp_rect_t painted = {0, 0, 0, 0};
+  for (int i = 0; i < count; ++i) {
+    const rmp_screen_item_t* item = &screen->items[i];
+    bool redraw = item_changed(screen, drawn, i);
+    for (int d = 0; d < screen->damage_count && !redraw; ++d) {
+      redraw = rects_touch(item->rect, screen->damage[d]);
+    }
+    if (!redraw && item->layer == LAYER_HUD && painted.width > 0) {
+      redraw = rects_touch(item->rect, painted);
+    }
+
+    if (redraw) {
+      draw_item(screen, item);
+      if (item->layer != LAYER_HUD) {
+        painted = painted.width > 0 ? union_rect(painted, item->rect) : item->rect;
+      }
+    }
+  }
+
+  submit(screen);
+}
+
+static void fill(rmp_screen_t* screen, int layer, rmp_rect_t rect, uint32_t color) {
+  screen->frame_pixels += rmp_cmd_fill(&screen->commands, layer, rect, color);
+}
+
+static void draw_item(rmp_screen_t* screen, const rmp_screen_item_t* item) {
+  if (item->image) {
+    screen->frame_pixels += rmp_cmd_blit(&screen->commands, item->layer, item->rect, item->image,
+                                         screen->hud->atlas_stride);
+  }
+  else {
+    fill(screen, item->layer, item->rect, item->color);
+  }
+}
+
+static void submit(rmp_screen_t* screen) {
+  // Sorted and merged, then handed to the backend in one call however many fills the frame has
+  rmp_cmd_list_finish(&screen->commands);
+  screen->render.submit(&screen->render, &screen->commands);
+}
+
+static rmp_rect_t clip_rect(const rmp_screen_t* screen, rmp_rect_t rect) {
+  int x0 = rect.x < 0 ? 0 : rect.x;
+  int y0 = rect.y < 0 ? 0 : rect.y;
+  int x1 = rect.x + rect.width;
+  int y1 = rect.y + rect.height;
+  x1 = x1 > screen->render.width ? screen->render.width : x1;
+  y1 = y1 > screen->render.height ? screen->render.height : y1;
+
+  if (x0 >= x1 || y0 >= y1) {
+    return (rmp_rect_t){0, 0, 0, 0};
+  }
+
+  return (rmp_rect_t){x0, y0, x1 - x0, y1 - y0};
+}
+
+static rmp_rect_t union_rect(rmp_rect_t a, rmp_rect_t b) {
+  int x0 = a.x < b.x ? a.x : b.x;
+  int y0 = a.y < b.y ? a.y : b.y;
+  int x1 = (a.x + a.width) > (b.x + b.width) ? (a.x + a.width) : (b.x + b.width);
+  int y1 = (a.y + a.height) > (b.y + b.height) ? (a.y + a.height) : (b.y + b.height);
+
+  return (rmp_rect_t){x0, y0, x1 - x0, y1 - y0};
+}
+
+static bool rects_touch(rmp_rect_t a, rmp_rect_t b) {
+  return a.x <= b.x + b.width && b.x <= a.x + a.width &&
+         a.y <= b.y + b.height && b.y <= a.y + a.height;
+}
 
-  screen_fill(screen->ctx, screen->buf, attribs);
+static bool item_changed(const rmp_screen_t* screen, const rmp_screen_frame_t* drawn, int i) {
+  return memcmp(&screen->items[i], &drawn->items[i], sizeof(screen->items[i])) != 0;
 }
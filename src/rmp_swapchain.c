@@ -0,0 +1,152 @@
+#include "rmp_swapchain.h"
+#include "rmp_log.h"
+
+#include <stdio.h>
+
+rmp_swapchainRet_e rmp_swapchain_init(rmp_swapchain_t* swapchain, int count, int refresh_hz,
+                                      time_t now_us) {
+  if (!swapchain || count < 2 || count > RMP_SWAPCHAIN_MAX_BUFFERS || refresh_hz <= 0) {
+    return RMP_SWAPCHAIN_BAD_ARGS;
+  }
+
+  swapchain->count = count;
+  swapchain->external = false;
+  for (int i = 0; i < count; ++i) {
+    swapchain->state[i] = RMP_SWAPCHAIN_FREE;
+  }
+  swapchain->queued = -1;
+  swapchain->displayed = -1;
+
+  swapchain->period_us = 1000000 / refresh_hz;
+  swapchain->next_vblank_us = now_us + swapchain->period_us;
+  swapchain->target_us = swapchain->next_vblank_us;
+
+  swapchain->stats.presented = 0;
+  swapchain->stats.dropped = 0;
+  swapchain->stats.late = 0;
+
+  return RMP_SWAPCHAIN_OK;
+}
+
+time_t rmp_swapchain_vblank(rmp_swapchain_t* swapchain, time_t now_us) {
+  if (!swapchain) {
+    return now_us;
+  }
+
+  if (now_us < swapchain->next_vblank_us) {
+    return swapchain->next_vblank_us;
+  }
+
+  // The first vblank that passed flips the queued buffer in and frees the one it replaces
+  if (swapchain->queued >= 0) {
+    if (swapchain->displayed >= 0) {
+      swapchain->state[swapchain->displayed] = RMP_SWAPCHAIN_FREE;
+    }
+    swapchain->displayed = swapchain->queued;
+    swapchain->state[swapchain->displayed] = RMP_SWAPCHAIN_DISPLAYED;
+    swapchain->queued = -1;
+    swapchain->stats.presented++;
+  }
+
+  // Any further vblanks went by without a frame, skip them rather than render a backlog
+  time_t missed = (now_us - swapchain->next_vblank_us) / swapchain->period_us;
+  swapchain->stats.dropped += missed;
+  swapchain->next_vblank_us += (missed + 1) * swapchain->period_us;
+
+  return swapchain->next_vblank_us;
+}
+
+time_t rmp_swapchain_vsync(rmp_swapchain_t* swapchain, time_t vsync_us) {
+  if (!swapchain) {
+    return vsync_us;
+  }
+
+  // A vsync the display reported, the clock restarts from it instead of drifting on its own
+  swapchain->next_vblank_us = vsync_us;
+  return rmp_swapchain_vblank(swapchain, vsync_us);
+}
+
+time_t rmp_swapchain_resume(rmp_swapchain_t* swapchain, time_t now_us) {
+  if (!swapchain) {
+    return now_us;
+  }
+
+  // Vblanks that passed while idle had nothing new to show, they are not drops
+  unsigned long dropped = swapchain->stats.dropped;
+  rmp_swapchain_vblank(swapchain, now_us);
+  swapchain->stats.dropped = dropped;
+
+  return swapchain->next_vblank_us;
+}
+
+int rmp_swapchain_acquire(rmp_swapchain_t* swapchain) {
+  if (!swapchain) {
+    return -1;
+  }
+
+  for (int i = 0; i < swapchain->count; ++i) {
+    if (swapchain->state[i] == RMP_SWAPCHAIN_FREE) {
+      swapchain->state[i] = RMP_SWAPCHAIN_ACQUIRED;
+      swapchain->target_us = swapchain->next_vblank_us;
+      return i;
+    }
+  }
+
+  // Every buffer is on screen or waiting for it, rendering now would only add latency
+  swapchain->stats.dropped++;
+  return -1;
+}
+
+int rmp_swapchain_adopt(rmp_swapchain_t* swapchain, int buffer) {
+  if (!swapchain) {
+    return -1;
+  }
+
+  if (buffer < 0 || buffer >= swapchain->count) {
+    swapchain->stats.dropped++;
+    return -1;
+  }
+
+  // The platform is done with it, whatever was thought to be showing it
+  if (swapchain->displayed == buffer) {
+    swapchain->displayed = -1;
+  }
+  if (swapchain->queued == buffer) {
+    swapchain->queued = -1;
+  }
+  swapchain->state[buffer] = RMP_SWAPCHAIN_ACQUIRED;
+  swapchain->target_us = swapchain->next_vblank_us;
+  return buffer;
+}
+
+void rmp_swapchain_present(rmp_swapchain_t* swapchain, int buffer, time_t now_us) {
+  if (!swapchain || buffer < 0 || buffer >= swapchain->count) {
+    return;
+  }
+
+  if (now_us > swapchain->target_us) {
+    swapchain->stats.late++;
+  }
+
+  // Newest frame wins, one still waiting for its vblank is recycled unseen. A platform that was
+  // already handed that one still holds it until it hands it back
+  if (swapchain->queued >= 0 && !swapchain->external) {
+    swapchain->state[swapchain->queued] = RMP_SWAPCHAIN_FREE;
+    swapchain->stats.dropped++;
+  }
+
+  swapchain->queued = buffer;
+  swapchain->state[buffer] = RMP_SWAPCHAIN_QUEUED;
+}
+
+void rmp_swapchain_log_stats(const rmp_swapchain_t* swapchain) {
+  if (!swapchain) {
+    return;
+  }
+
+  rmp_log_info("screen", "Swapchain (%d buffers, %ld us vblank)\n", swapchain->count,
+               (long)swapchain->period_us);
+  printf("    presented : %lu\n", swapchain->stats.presented);
+  printf("    dropped   : %lu\n", swapchain->stats.dropped);
+  printf("    late      : %lu\n", swapchain->stats.late);
+}
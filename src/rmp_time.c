@@ -3,9 +3,25 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <time.h>
+#include <errno.h>
 
 time_t rmp_time_get_us(void) {
   struct timespec ts;
   clock_gettime(CLOCK_MONOTONIC, &ts);
   return (ts.tv_sec * 1000000) + (ts.tv_nsec / 1000);
 }
+
+void rmp_time_sleep_until_us(time_t deadline_us) {
+  struct timespec ts;
+  ts.tv_sec = deadline_us / 1000000;
+  ts.tv_nsec = (deadline_us % 1000000) * 1000;
+
+  // Absolute deadlines do not accumulate drift, retry until we actually get there
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+  }
+}
+
+void rmp_time_spin_until_us(time_t deadline_us) {
+  while (rmp_time_get_us() < deadline_us) {
+  }
+}
@@ -1,57 +1,116 @@
 #include "rmp_vec2.h"
 
-#include <math.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define RMP_VEC2_SIMD_NAME "avx2"
+#define RMP_VEC2_LANES 8
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define RMP_VEC2_SIMD_NAME "sse2"
+#define RMP_VEC2_LANES 4
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define RMP_VEC2_SIMD_NAME "neon"
+#define RMP_VEC2_LANES 4
+#else
+#define RMP_VEC2_SIMD_NAME "scalar"
+#define RMP_VEC2_LANES 1
+#endif
 
 #define MIN(a, b) (( (a) < (b) ) ? (a) : (b))
 #define MAX(a, b) (( (a) > (b) ) ? (a) : (b))
 
-void rmp_vec2_set(rmp_vec2_t* vec, double x, double y) {
-  if (!vec) return;
-  vec->x = x;
-  vec->y = y;
-}
+static void add_scalar(float* dst, const float* a, const float* b, int begin, int n);
+static void clamp_scalar(float* dst, const float* src, float lo, float hi, int begin, int n);
+static int add_simd(float* dst, const float* a, const float* b, int n);
+static int clamp_simd(float* dst, const float* src, float lo, float hi, int n);
 
-void rmp_vec2_add(rmp_vec2_t* dst, rmp_vec2_t vec1, rmp_vec2_t vec2) {
-  if (!dst) return;
-  dst->x = vec1.x + vec2.x;
-  dst->y = vec1.y + vec2.y;
+const char* rmp_vec2_simd_name(void) {
+  return RMP_VEC2_SIMD_NAME;
 }
 
-void rmp_vec2_sub(rmp_vec2_t* dst, rmp_vec2_t vec1, rmp_vec2_t vec2) {
-  if (!dst) return;
-  dst->x = vec1.x - vec2.x;
-  dst->y = vec1.y - vec2.y;
-}
+void rmp_vec2_add_n(float* dst_x, float* dst_y, const float* x1, const float* y1,
+                    const float* x2, const float* y2, int n) {
+  if (!dst_x || !dst_y || !x1 || !y1 || !x2 || !y2 || n <= 0) return;
 
-void rmp_vec2_scale(rmp_vec2_t* dst, rmp_vec2_t vec, double s) {
-  if (!dst) return;
-  dst->x = vec.x * s;
-  dst->y = vec.y * s;
+  add_scalar(dst_x, x1, x2, add_simd(dst_x, x1, x2, n), n);
+  add_scalar(dst_y, y1, y2, add_simd(dst_y, y1, y2, n), n);
 }
 
-double rmp_vec2_dot(rmp_vec2_t a, rmp_vec2_t b) {
-  return a.x * b.x + a.y * b.y;
+void rmp_vec2_clamp_n(float* dst_x, float* dst_y, const float* x, const float* y,
+                      rmp_vec2_t min, rmp_vec2_t max, int n) {
+  if (!dst_x || !dst_y || !x || !y || n <= 0) return;
+
+  clamp_scalar(dst_x, x, min.x, max.x, clamp_simd(dst_x, x, min.x, max.x, n), n);
+  clamp_scalar(dst_y, y, min.y, max.y, clamp_simd(dst_y, y, min.y, max.y, n), n);
 }
 
-double rmp_vec2_len(rmp_vec2_t vec) {
-  return sqrt(vec.x * vec.x + vec.y * vec.y);
+static void add_scalar(float* dst, const float* a, const float* b, int begin, int n) {
+  for (int i = begin; i < n; ++i) {
+    dst[i] = a[i] + b[i];
+  }
 }
 
-void rmp_vec2_normalize(rmp_vec2_t* dst, rmp_vec2_t vec) {
-  if (!dst) return;
-  double len = sqrt(vec.x * vec.x + vec.y * vec.y);
-  if (len > 1e-12) {
-    dst->x = vec.x / len;
-    dst->y = vec.y / len;
-  } else {
-    dst->x = 0.0;
-    dst->y = 0.0;
+static void clamp_scalar(float* dst, const float* src, float lo, float hi, int begin, int n) {
+  for (int i = begin; i < n; ++i) {
+    dst[i] = MAX(lo, MIN(hi, src[i]));
   }
 }
 
-void rmp_vec2_clamp(rmp_vec2_t* dst, rmp_vec2_t vec, rmp_vec2_t min, rmp_vec2_t max) {
-  if (!dst) return;
-  dst->x = MAX(min.x, MIN(max.x, vec.x));
-  dst->y = MAX(min.y, MIN(max.y, vec.y));
+// The SIMD versions handle whole vectors and return where the scalar tail starts
+
+static int add_simd(float* dst, const float* a, const float* b, int n) {
+  int i = 0;
+#if defined(__AVX2__)
+  for (; i + RMP_VEC2_LANES <= n; i += RMP_VEC2_LANES) {
+    _mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+  }
+#elif defined(__SSE2__)
+  for (; i + RMP_VEC2_LANES <= n; i += RMP_VEC2_LANES) {
+    _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+  }
+#elif defined(__ARM_NEON)
+  for (; i + RMP_VEC2_LANES <= n; i += RMP_VEC2_LANES) {
+    vst1q_f32(dst + i, vaddq_f32(vld1q_f32(a + i), vld1q_f32(b + i)));
+  }
+#else
+  (void)dst;
+  (void)a;
+  (void)b;
+  (void)n;
+#endif
+  return i;
 }
 
+static int clamp_simd(float* dst, const float* src, float lo, float hi, int n) {
+  int i = 0;
+#if defined(__AVX2__)
+  __m256 vlo = _mm256_set1_ps(lo);
+  __m256 vhi = _mm256_set1_ps(hi);
+  for (; i + RMP_VEC2_LANES <= n; i += RMP_VEC2_LANES) {
+    __m256 v = _mm256_min_ps(_mm256_loadu_ps(src + i), vhi);
+    _mm256_storeu_ps(dst + i, _mm256_max_ps(v, vlo));
+  }
+#elif defined(__SSE2__)
+  __m128 vlo = _mm_set1_ps(lo);
+  __m128 vhi = _mm_set1_ps(hi);
+  for (; i + RMP_VEC2_LANES <= n; i += RMP_VEC2_LANES) {
+    __m128 v = _mm_min_ps(_mm_loadu_ps(src + i), vhi);
+    _mm_storeu_ps(dst + i, _mm_max_ps(v, vlo));
+  }
+#elif defined(__ARM_NEON)
+  float32x4_t vlo = vdupq_n_f32(lo);
+  float32x4_t vhi = vdupq_n_f32(hi);
+  for (; i + RMP_VEC2_LANES <= n; i += RMP_VEC2_LANES) {
+    float32x4_t v = vminq_f32(vld1q_f32(src + i), vhi);
+    vst1q_f32(dst + i, vmaxq_f32(v, vlo));
+  }
+#else
+  (void)dst;
+  (void)src;
+  (void)lo;
+  (void)hi;
+  (void)n;
+#endif
+  return i;
+}
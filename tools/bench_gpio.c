@@ -0,0 +1,151 @@
+#include "rmp_time.h"
+#include "rmp_log.h"
+#include "external/rpi_gpio.h"
+#include "external/rpi_gpio_mock.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+
+#define BENCH_GPIO_MESSAGE_CALLS 20000
+#define BENCH_GPIO_REGISTER_CALLS 10000000
+
+typedef enum {
+  BENCH_GPIO_INPUT,
+  BENCH_GPIO_OUTPUT,
+  BENCH_GPIO_INPUT_MASK,
+  BENCH_GPIO_OUTPUT_MASK,
+  BENCH_GPIO_ACCESS_COUNT
+} bench_gpio_access_e;
+
+static const char* const access_names[BENCH_GPIO_ACCESS_COUNT] = {"input", "output", "input mask",
+                                                                  "output mask"};
+
+// The keypad pins, rows are driven and columns read
+static const int row_pins[4] = {18, 23, 24, 25};
+static const int col_pins[4] = {12, 16, 20, 21};
+
+static void usage(const char* prog) {
+  fprintf(stderr, "Usage: %s [-m socket]\n", prog);
+}
+
+// Returns the ns per call of one kind of access
+static double time_access(bench_gpio_access_e access, unsigned row_mask, unsigned col_mask,
+                          int calls) {
+  unsigned level = 0;
+  time_t start = rmp_time_get_us();
+  for (int i = 0; i < calls; ++i) {
+    switch (access) {
+      case BENCH_GPIO_INPUT:
+        rpi_gpio_input(col_pins[i & 3], &level);
+        break;
+      case BENCH_GPIO_OUTPUT:
+        rpi_gpio_output(row_pins[i & 3], (i >> 2) & 1 ? GPIO_LOW : GPIO_HIGH);
+        break;
+      case BENCH_GPIO_INPUT_MASK:
+        rpi_gpio_input_mask(col_mask, &level);
+        break;
+      default:
+        rpi_gpio_output_mask(row_mask, i & 1 ? row_mask : 0);
+        break;
+    }
+  }
+
+  return (rmp_time_get_us() - start) * 1000.0 / calls;
+}
+
+// On the stand-in mapping writes land in GPSET0/GPCLR0 and GPLEV0 reads back what was put there
+static int check_registers(unsigned row_mask, unsigned col_mask) {
+  int mismatches = 0;
+  rpi_gpio_regs[RPI_GPIO_REG_GPSET0] = 0;
+  rpi_gpio_regs[RPI_GPIO_REG_GPCLR0] = 0;
+
+  unsigned levels = 1u << row_pins[1];
+  rpi_gpio_output_mask(row_mask, levels);
+  mismatches += rpi_gpio_regs[RPI_GPIO_REG_GPSET0] != levels;
+  mismatches += rpi_gpio_regs[RPI_GPIO_REG_GPCLR0] != (row_mask & ~levels);
+
+  rpi_gpio_output(row_pins[2], GPIO_HIGH);
+  mismatches += rpi_gpio_regs[RPI_GPIO_REG_GPSET0] != 1u << row_pins[2];
+  rpi_gpio_output(row_pins[3], GPIO_LOW);
+  mismatches += rpi_gpio_regs[RPI_GPIO_REG_GPCLR0] != 1u << row_pins[3];
+
+  rpi_gpio_regs[RPI_GPIO_REG_GPLEV0] = (1u << col_pins[0]) | (1u << col_pins[3]) | 1u;
+  rpi_gpio_input_mask(col_mask, &levels);
+  mismatches += levels != ((1u << col_pins[0]) | (1u << col_pins[3]));
+
+  for (int c = 0; c < 4; ++c) {
+    unsigned level = GPIO_LOW;
+    rpi_gpio_input(col_pins[c], &level);
+    mismatches += level != (c == 0 || c == 3 ? GPIO_HIGH : GPIO_LOW);
+  }
+
+  return mismatches;
+}
+
+int main(int argc, char** argv) {
+  const char* path = "/tmp/bench_gpio.sock";
+
+  int opt;
+  while ((opt = getopt(argc, argv, "m:h")) != -1) {
+    switch (opt) {
+      case 'm':
+        path = optarg;
+        break;
+      default:
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+  }
+
+  if (rpi_gpio_mock_start(path) != 0 || setenv("RPI_GPIO_MOCK_PATH", path, 1) != 0) {
+    return EXIT_FAILURE;
+  }
+
+  unsigned row_mask = 0;
+  unsigned col_mask = 0;
+  for (int i = 0; i < 4; ++i) {
+    if (rpi_gpio_setup(row_pins[i], GPIO_OUT) != GPIO_SUCCESS ||
+        rpi_gpio_setup_pull(col_pins[i], GPIO_IN, GPIO_PUD_UP) != GPIO_SUCCESS) {
+      rmp_log_error("bench", "Failed to set up the pins on the mock\n");
+      return EXIT_FAILURE;
+    }
+    row_mask |= 1u << row_pins[i];
+    col_mask |= 1u << col_pins[i];
+  }
+  rpi_gpio_mock_wire(row_pins, col_pins);
+
+  // Every call is a round trip to the mock resource manager
+  double message_ns[BENCH_GPIO_ACCESS_COUNT];
+  for (int a = 0; a < BENCH_GPIO_ACCESS_COUNT; ++a) {
+    message_ns[a] = time_access(a, row_mask, col_mask, BENCH_GPIO_MESSAGE_CALLS);
+  }
+
+  if (rpi_gpio_map_registers() != GPIO_SUCCESS) {
+    return EXIT_FAILURE;
+  }
+
+  int mismatches = check_registers(row_mask, col_mask);
+
+  rpi_gpio_mock_stats_t gpio_start;
+  rpi_gpio_mock_get_stats(&gpio_start);
+  double register_ns[BENCH_GPIO_ACCESS_COUNT];
+  for (int a = 0; a < BENCH_GPIO_ACCESS_COUNT; ++a) {
+    register_ns[a] = time_access(a, row_mask, col_mask, BENCH_GPIO_REGISTER_CALLS);
+  }
+  rpi_gpio_mock_stats_t gpio;
+  rpi_gpio_mock_get_stats(&gpio);
+
+  printf("access       message ns  register ns  speedup\n");
+  for (int a = 0; a < BENCH_GPIO_ACCESS_COUNT; ++a) {
+    printf("%-12s %-11.1f %-12.2f %.0fx\n", access_names[a], message_ns[a], register_ns[a],
+           message_ns[a] / register_ns[a]);
+  }
+  printf("register mismatches: %d, messages sent while mapped: %lu\n", mismatches,
+         gpio.messages - gpio_start.messages);
+
+  rpi_gpio_cleanup();
+  rpi_gpio_mock_stop();
+  return mismatches == 0 && gpio.messages == gpio_start.messages ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,116 @@
+#include "rmp_app.h"
+#include "rmp_screen.h"
+#include "rmp_time.h"
+#include "rmp_log.h"
+#include "rmp_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/resource.h>
+
+static void usage(const char* prog) {
+  fprintf(stderr, "Usage: %s [-d seconds]\n", prog);
+}
+
+static double get_cpu_us(void) {
+  struct rusage resources;
+  if (getrusage(RUSAGE_SELF, &resources) != 0) {
+    return 0;
+  }
+
+  return resources.ru_utime.tv_sec * 1e6 + resources.ru_utime.tv_usec +
+         resources.ru_stime.tv_sec * 1e6 + resources.ru_stime.tv_usec;
+}
+
+// Runs the app and screen threads on a paused game and reports what they cost while nothing moves
+static int bench_paused(bool governor, int seconds) {
+  rmp_app_t app;
+  rmp_app_init(&app);
+  app.governor = governor;
+
+  rmp_screen_t screen;
+  if (rmp_screen_init(&screen, &app, RMP_CONFIG_FB_RENDER_SCALE,
+                      RMP_CONFIG_PIXEL_FORMAT) != RMP_SCREEN_OK) {
+    return EXIT_FAILURE;
+  }
+
+  pthread_t app_tid;
+  pthread_t screen_tid;
+  if (pthread_create(&app_tid, NULL, rmp_app_run, &app) != 0 ||
+      pthread_create(&screen_tid, NULL, rmp_screen_run, &screen) != 0) {
+    rmp_log_error("bench", "Failed to create threads\n");
+    return EXIT_FAILURE;
+  }
+
+  // The first frame is drawn on start, measure once the game has settled on screen
+  sleep(1);
+  double cpu_start = get_cpu_us();
+  time_t start = rmp_time_get_us();
+  unsigned long wakeups_start = atomic_load(&app.loop_wakeups);
+  unsigned long rendered_start = screen.stats.rendered;
+
+  sleep(seconds);
+
+  double cpu_us = get_cpu_us() - cpu_start;
+  time_t duration = rmp_time_get_us() - start;
+  unsigned long wakeups = atomic_load(&app.loop_wakeups) - wakeups_start;
+  unsigned long rendered = screen.stats.rendered - rendered_start;
+
+  // Resuming wakes both loops, the latency is how long the screen takes to present the change
+  pthread_mutex_lock(&app.mutex);
+  unsigned long presented = screen.swapchain.stats.presented;
+  time_t resume_us = rmp_time_get_us();
+  app.paused = false;
+  rmp_app_notify(&app);
+  pthread_mutex_unlock(&app.mutex);
+  while (screen.swapchain.stats.presented == presented &&
+         rmp_time_get_us() - resume_us < 1000000) {
+    usleep(100);
+  }
+  time_t resume_latency = rmp_time_get_us() - resume_us;
+
+  pthread_mutex_lock(&app.mutex);
+  rmp_app_quit(&app);
+  pthread_mutex_unlock(&app.mutex);
+  pthread_join(app_tid, NULL);
+  pthread_join(screen_tid, NULL);
+
+  printf("%-10s %-8.2f %-12.1f %-12.1f %ld\n", governor ? "governor" : "free", cpu_us * 100 / duration,
+         wakeups * 1e6 / duration, rendered * 1e6 / duration, (long)resume_latency);
+
+  rmp_screen_free(&screen);
+  rmp_app_free(&app);
+  return EXIT_SUCCESS;
+}
+
+int main(int argc, char** argv) {
+  int seconds = 5;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "d:h")) != -1) {
+    switch (opt) {
+      case 'd':
+        seconds = atoi(optarg);
+        break;
+      default:
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+  }
+
+  if (seconds <= 0) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  printf("paused game, %d s\n", seconds);
+  printf("\nloops      cpu %%    wakeups/s    frames/s     resume us\n");
+  if (bench_paused(false, seconds) != EXIT_SUCCESS || bench_paused(true, seconds) != EXIT_SUCCESS) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
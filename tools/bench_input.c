@@ -0,0 +1,125 @@
+#include "rmp_app.h"
+#include "rmp_event.h"
+#include "rmp_time.h"
+#include "rmp_log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+static void usage(const char* prog) {
+  fprintf(stderr, "Usage: %s [-d seconds] [-e events/s] [-p]\n", prog);
+}
+
+static long get_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+// Presses and releases the pad A keys at random, at a fixed rate, as the only producer. Returns the
+// keys the sim should end up holding, only counting events that made it into the queue
+static unsigned produce(rmp_app_t* app, int seconds, long rate, long* push_total_ns,
+                        long* push_max_ns) {
+  const int keys[2] = {RMP_EVENT_PAD_A_UP, RMP_EVENT_PAD_A_DOWN};
+  unsigned held = 0;
+  long events = seconds * rate;
+  time_t start = rmp_time_get_us();
+
+  srand(1);
+  for (long i = 0; i < events; ++i) {
+    rmp_time_spin_until_us(start + (time_t)(i * 1000000 / rate));
+
+    int key = keys[rand() % 2];
+    bool down = !(held & (1u << key));
+    long push_start = get_ns();
+    bool pushed = rmp_app_post_event(app, (down ? RMP_KEYDOWN : RMP_KEYUP) | key);
+    long push_ns = get_ns() - push_start;
+
+    *push_total_ns += push_ns;
+    if (push_ns > *push_max_ns) {
+      *push_max_ns = push_ns;
+    }
+    if (pushed) {
+      held = down ? held | (1u << key) : held & ~(1u << key);
+    }
+  }
+
+  return held;
+}
+
+int main(int argc, char** argv) {
+  int seconds = 5;
+  long rate = 100000;
+  bool paused = false;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "d:e:ph")) != -1) {
+    switch (opt) {
+      case 'd':
+        seconds = atoi(optarg);
+        break;
+      case 'e':
+        rate = atol(optarg);
+        break;
+      case 'p':
+        paused = true;
+        break;
+      default:
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+  }
+
+  if (seconds <= 0 || rate <= 0) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  rmp_app_t app;
+  if (rmp_app_init(&app) != RMP_APP_OK) {
+    return EXIT_FAILURE;
+  }
+  // Running, the sim drains the queue once a step. Paused, every push has to wake it
+  app.paused = paused;
+
+  pthread_t app_tid;
+  if (pthread_create(&app_tid, NULL, rmp_app_run, &app) != 0) {
+    rmp_log_error("bench", "Failed to create app thread\n");
+    return EXIT_FAILURE;
+  }
+
+  long push_total_ns = 0;
+  long push_max_ns = 0;
+  unsigned held = produce(&app, seconds, rate, &push_total_ns, &push_max_ns);
+
+  while (!rmp_input_is_empty(&app.input)) {
+    usleep(1000);
+  }
+
+  pthread_mutex_lock(&app.mutex);
+  int dir = (int)((held >> RMP_EVENT_PAD_A_DOWN) & 1) - (int)((held >> RMP_EVENT_PAD_A_UP) & 1);
+  bool drift = app.keys_held != held || app.pad_a.vel.y != app.pad_speed * dir;
+  rmp_app_stats_t stats = app.stats;
+  rmp_app_quit(&app);
+  pthread_mutex_unlock(&app.mutex);
+  pthread_join(app_tid, NULL);
+
+  unsigned long pushed = app.input.pushed;
+  unsigned long dropped = app.input.dropped;
+  printf("%d s at %ld events/s, %s game, %d event queue\n", seconds, rate,
+         paused ? "paused" : "running", RMP_CONFIG_INPUT_QUEUE_SIZE);
+  printf("\npush avg ns  push max ns  pushed     dropped    applied    latency avg us  max us\n");
+  printf("%-12.1f %-12ld %-10lu %-10lu %-10lu %-15.1f %ld\n",
+         push_total_ns / (double)(pushed + dropped), push_max_ns, pushed, dropped,
+         stats.input_events, stats.input_events ? stats.input_latency_total_us /
+         (double)stats.input_events : 0.0, (long)stats.input_latency_max_us);
+  printf("pad a held 0x%x, sim holds 0x%x, vel %.0f: %s\n", held, app.keys_held, app.pad_a.vel.y,
+         drift ? "drift" : "ok");
+
+  rmp_app_free(&app);
+  return !drift && stats.input_events == pushed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,278 @@
+#include "rmp_app.h"
+#include "rmp_keypad.h"
+#include "rmp_event.h"
+#include "rmp_time.h"
+#include "rmp_log.h"
+#include "rmp_config.h"
+#include "external/rpi_gpio.h"
+#include "external/rpi_gpio_mock.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/resource.h>
+
+#define BENCH_KEYPAD_MAX_PRESSES 1000
+#define BENCH_KEYPAD_SCANS 20000
+
+static void usage(const char* prog) {
+  fprintf(stderr,
+          "Usage: %s [-d seconds] [-n presses] [-s settle us] [-f fall us] [-r rise us] "
+          "[-m socket]\n",
+          prog);
+}
+
+static double get_cpu_us(void) {
+  struct rusage resources;
+  if (getrusage(RUSAGE_SELF, &resources) != 0) {
+    return 0;
+  }
+
+  return resources.ru_utime.tv_sec * 1e6 + resources.ru_utime.tv_usec +
+         resources.ru_stime.tv_sec * 1e6 + resources.ru_stime.tv_usec;
+}
+
+static int compare_time(const void* a, const void* b) {
+  time_t x = *(const time_t*)a;
+  time_t y = *(const time_t*)b;
+  return (x > y) - (x < y);
+}
+
+// Presses a key on the mock matrix and returns the time until the event reached the game
+static time_t press(rmp_app_t* app, int key, bool down) {
+  pthread_mutex_lock(&app->mutex);
+  unsigned long generation = app->snapshot.generation;
+  pthread_mutex_unlock(&app->mutex);
+
+  time_t start = rmp_time_get_us();
+  rpi_gpio_mock_set_key(key, down);
+  rmp_app_wait_for_change(app, generation);
+  return rmp_time_get_us() - start;
+}
+
+// Holds a key down on the mock and lets the keypad find the shortest settle that reads it right
+static int bench_calibrate(void) {
+  rmp_app_t app;
+  rmp_app_init(&app);
+
+  rmp_keypad_t keypad;
+  if (rmp_keypad_init(&keypad, &app) != RMP_KEYPAD_OK) {
+    return EXIT_FAILURE;
+  }
+  rpi_gpio_mock_wire(keypad.row_pins, keypad.col_pins);
+
+  rpi_gpio_mock_set_key(RMP_KEY5, true);
+  time_t settle_us;
+  rmp_keypadRet_e ret = rmp_keypad_calibrate(&keypad, &settle_us);
+  rpi_gpio_mock_set_key(RMP_KEY5, false);
+  if (ret != RMP_KEYPAD_OK) {
+    return EXIT_FAILURE;
+  }
+
+  printf("self-test: shortest stable settle %ld us\n", (long)settle_us);
+  rmp_keypad_free(&keypad);
+  rmp_app_free(&app);
+  return EXIT_SUCCESS;
+}
+
+// Scans the way the keypad did before the mask messages, a write and a read per pin
+static void scan_per_pin(const rmp_keypad_t* keypad, int keys[16]) {
+  for (int r = 0; r < 4; ++r) {
+    rpi_gpio_output(keypad->row_pins[r], GPIO_LOW);
+    for (int c = 0; c < 4; ++c) {
+      unsigned level = GPIO_HIGH;
+      rpi_gpio_input(keypad->col_pins[c], &level);
+      keys[c * 4 + r] = level == GPIO_LOW;
+    }
+    rpi_gpio_output(keypad->row_pins[r], GPIO_HIGH);
+  }
+}
+
+// Times back to back scans without settling, what is left is the cost of the messages
+static int bench_scan(void) {
+  rmp_app_t app;
+  rmp_app_init(&app);
+
+  rmp_keypad_t keypad;
+  if (rmp_keypad_init(&keypad, &app) != RMP_KEYPAD_OK ||
+      rmp_keypad_set_settle(&keypad, 0) != RMP_KEYPAD_OK) {
+    return EXIT_FAILURE;
+  }
+  rpi_gpio_mock_wire(keypad.row_pins, keypad.col_pins);
+  rpi_gpio_mock_set_key(RMP_KEY5, true);
+
+  for (int mask = 0; mask < 2; ++mask) {
+    rpi_gpio_mock_stats_t gpio_start;
+    rpi_gpio_mock_get_stats(&gpio_start);
+    time_t start = rmp_time_get_us();
+
+    int keys[16];
+    for (int i = 0; i < BENCH_KEYPAD_SCANS; ++i) {
+      if (mask) {
+        rmp_keypad_step(&keypad, keypad.next_scan_us);
+      }
+      else {
+        scan_per_pin(&keypad, keys);
+      }
+    }
+
+    time_t duration = rmp_time_get_us() - start;
+    rpi_gpio_mock_stats_t gpio;
+    rpi_gpio_mock_get_stats(&gpio);
+    printf("%-9s %-12.1f %.2f\n", mask ? "mask" : "per pin",
+           (gpio.messages - gpio_start.messages) / (double)BENCH_KEYPAD_SCANS,
+           duration / (double)BENCH_KEYPAD_SCANS);
+  }
+
+  rpi_gpio_mock_set_key(RMP_KEY5, false);
+  rmp_keypad_free(&keypad);
+  rmp_app_free(&app);
+  return EXIT_SUCCESS;
+}
+
+// Runs the keypad thread on an untouched keypad, then presses and releases the pad keys at random
+static int bench_keypad(bool edge_wait, time_t settle_us, int seconds, int presses) {
+  rmp_app_t app;
+  rmp_app_init(&app);
+
+  rmp_keypad_t keypad;
+  if (rmp_keypad_init(&keypad, &app) != RMP_KEYPAD_OK) {
+    return EXIT_FAILURE;
+  }
+  rpi_gpio_mock_wire(keypad.row_pins, keypad.col_pins);
+  if (rmp_keypad_set_settle(&keypad, settle_us) != RMP_KEYPAD_OK ||
+      rmp_keypad_set_edge_wait(&keypad, edge_wait) != RMP_KEYPAD_OK) {
+    return EXIT_FAILURE;
+  }
+
+  // The paused sim sleeps until the keypad queues an event, then applies it and publishes
+  pthread_t app_tid;
+  pthread_t keypad_tid;
+  if (pthread_create(&app_tid, NULL, rmp_app_run, &app) != 0 ||
+      pthread_create(&keypad_tid, NULL, rmp_keypad_run, &keypad) != 0) {
+    rmp_log_error("bench", "Failed to create threads\n");
+    return EXIT_FAILURE;
+  }
+
+  sleep(1);
+  double cpu_start = get_cpu_us();
+  time_t start = rmp_time_get_us();
+  unsigned long wakeups_start = atomic_load(&app.loop_wakeups);
+  rpi_gpio_mock_stats_t gpio_start;
+  rpi_gpio_mock_get_stats(&gpio_start);
+
+  sleep(seconds);
+
+  double cpu_us = get_cpu_us() - cpu_start;
+  time_t duration = rmp_time_get_us() - start;
+  unsigned long wakeups = atomic_load(&app.loop_wakeups) - wakeups_start;
+  rpi_gpio_mock_stats_t gpio;
+  rpi_gpio_mock_get_stats(&gpio);
+  unsigned long messages = gpio.messages - gpio_start.messages;
+
+  const int keys[4] = {RMP_EVENT_PAD_A_UP, RMP_EVENT_PAD_A_DOWN, RMP_EVENT_PAD_B_UP,
+                       RMP_EVENT_PAD_B_DOWN};
+  static time_t latency[BENCH_KEYPAD_MAX_PRESSES];
+  srand(1);
+  for (int i = 0; i < presses; ++i) {
+    int key = keys[rand() % 4];
+    latency[i] = press(&app, key, true);
+    usleep(20000 + rand() % 40000);
+    press(&app, key, false);
+    usleep(20000 + rand() % 40000);
+  }
+  qsort(latency, presses, sizeof(latency[0]), compare_time);
+
+  time_t total = 0;
+  for (int i = 0; i < presses; ++i) {
+    total += latency[i];
+  }
+
+  pthread_mutex_lock(&app.mutex);
+  rmp_app_quit(&app);
+  pthread_mutex_unlock(&app.mutex);
+  rmp_keypad_wake(&keypad);
+  pthread_join(app_tid, NULL);
+  pthread_join(keypad_tid, NULL);
+
+  const rmp_keypad_stats_t* stats = &keypad.stats;
+  printf("%-6s %-8.3f %-11.1f %-9.1f %-9.1f %-10.0f %-10ld %ld\n", edge_wait ? "edge" : "scan",
+         cpu_us * 100 / duration, wakeups * 1e6 / duration, messages * 1e6 / duration,
+         stats->scans ? stats->scan_total_us / (double)stats->scans : 0.0,
+         total / (double)presses, (long)latency[(presses * 99 + 99) / 100 - 1],
+         (long)latency[presses - 1]);
+
+  rmp_keypad_free(&keypad);
+  rmp_app_free(&app);
+  return EXIT_SUCCESS;
+}
+
+int main(int argc, char** argv) {
+  int seconds = 5;
+  int presses = 100;
+  time_t settle_us = RMP_CONFIG_KEYPAD_SETTLE_US;
+  long fall_us = 1;
+  long rise_us = 10;
+  const char* path = "/tmp/bench_keypad_gpio.sock";
+
+  int opt;
+  while ((opt = getopt(argc, argv, "d:n:s:f:r:m:h")) != -1) {
+    switch (opt) {
+      case 'd':
+        seconds = atoi(optarg);
+        break;
+      case 'n':
+        presses = atoi(optarg);
+        break;
+      case 's':
+        settle_us = atol(optarg);
+        break;
+      case 'f':
+        fall_us = atol(optarg);
+        break;
+      case 'r':
+        rise_us = atol(optarg);
+        break;
+      case 'm':
+        path = optarg;
+        break;
+      default:
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+  }
+
+  if (seconds <= 0 || presses <= 0 || presses > BENCH_KEYPAD_MAX_PRESSES) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  // The client finds the mock through the environment, every GPIO call is then a socket round trip
+  if (rpi_gpio_mock_start(path) != 0 || setenv("RPI_GPIO_MOCK_PATH", path, 1) != 0) {
+    return EXIT_FAILURE;
+  }
+
+  printf("scan      ipc/scan     us/scan\n");
+  if (bench_scan() != EXIT_SUCCESS) {
+    return EXIT_FAILURE;
+  }
+
+  // Columns are pulled low hard through a key and recover through the weak pull-up
+  rpi_gpio_mock_set_rc(fall_us, rise_us);
+  if (bench_calibrate() != EXIT_SUCCESS) {
+    return EXIT_FAILURE;
+  }
+
+  printf("untouched keypad %d s, then %d presses, %ld us settle, %ld/%ld us fall/rise\n", seconds,
+         presses, (long)settle_us, fall_us, rise_us);
+  printf("\nkeypad idle cpu %% wakeups/s  ipc/s     scan us   press us   p99 us     max us\n");
+  if (bench_keypad(false, settle_us, seconds, presses) != EXIT_SUCCESS ||
+      bench_keypad(true, settle_us, seconds, presses) != EXIT_SUCCESS) {
+    return EXIT_FAILURE;
+  }
+
+  rpi_gpio_mock_stop();
+  return EXIT_SUCCESS;
+}
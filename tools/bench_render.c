@@ -0,0 +1,216 @@
+#include "rmp_app.h"
+#include "rmp_screen.h"
+#include "rmp_render.h"
+#include "rmp_fb.h"
+#include "rmp_capture.h"
+#include "rmp_hud.h"
+#include "rmp_config.h"
+#include "rmp_time.h"
+#include "rmp_log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <unistd.h>
+
+static void usage(const char* prog) {
+  fprintf(stderr, "Usage: %s [-f] [-H] [-S 1|2|4] [-T threads] [-p rgba8888|rgb565] [-s seed] "
+          "[-n frames] [-b balls] [-x expected_hash] [-o frame.ppm] [-c capture]\n", prog);
+  fprintf(stderr, "  -f  Repaint the whole frame every time instead of only the damage\n");
+  fprintf(stderr, "  -H  Draw the performance overlay, its text and so the hash vary run to run\n");
+  fprintf(stderr, "  -S  Draw 1/1, 1/2 or 1/4 of the window area and scale it up\n");
+  fprintf(stderr, "  -T  Threads drawing a frame in tiles, small frames stay on one\n");
+  fprintf(stderr, "  -p  Pixel format drawn in, rgb565 hashes differ where colors lose depth\n");
+  fprintf(stderr, "  -c  Capture every frame to a .y4m, .rmpd or numbered .ppm path\n");
+}
+
+int main(int argc, char** argv) {
+  uint32_t seed = 1;
+  int frames = 1200;
+  int balls = 0;
+  const char* expected = NULL;
+  const char* ppm_path = NULL;
+  const char* capture_path = NULL;
+  bool full = false;
+  bool show_hud = false;
+  int render_scale = 1;
+  int render_threads = 1;
+  rmp_fb_format_e format = RMP_FB_RGBA8888;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "fHS:T:p:s:n:b:x:o:c:h")) != -1) {
+    switch (opt) {
+      case 'f':
+        full = true;
+        break;
+      case 'H':
+        show_hud = true;
+        break;
+      case 'S':
+        render_scale = atoi(optarg);
+        break;
+      case 'T':
+        render_threads = atoi(optarg);
+        break;
+      case 'p':
+        if (rmp_fb_parse_format(optarg, &format) != RMP_FB_OK) {
+          usage(argv[0]);
+          return EXIT_FAILURE;
+        }
+        break;
+      case 's':
+        seed = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'n':
+        frames = atoi(optarg);
+        break;
+      case 'b':
+        balls = atoi(optarg);
+        break;
+      case 'x':
+        expected = optarg;
+        break;
+      case 'o':
+        ppm_path = optarg;
+        break;
+      case 'c':
+        capture_path = optarg;
+        break;
+      default:
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+  }
+
+  rmp_app_t app;
+  rmp_app_init(&app);
+  rmp_app_seed(&app, seed);
+  app.paused = false;
+  app.governor = false;
+  if (balls > 0 && rmp_app_spawn_balls(&app, balls) != RMP_APP_OK) {
+    return EXIT_FAILURE;
+  }
+
+  rmp_screen_t screen;
+  if (rmp_screen_init(&screen, &app, render_scale, format) != RMP_SCREEN_OK) {
+    return EXIT_FAILURE;
+  }
+
+  screen.damage_tracking = !full;
+
+  if (rmp_render_fb_set_threads(&screen.render, render_threads) != RMP_RENDER_OK) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  rmp_capture_t capture;
+  if (capture_path) {
+    if (rmp_capture_init(&capture, capture_path, screen.render.width, screen.render.height,
+                         screen.render.refresh_hz, RMP_CONFIG_CAPTURE_SLOTS) != RMP_CAPTURE_OK) {
+      return EXIT_FAILURE;
+    }
+    screen.capture = &capture;
+  }
+
+  rmp_hud_t hud;
+  if (show_hud) {
+    if (rmp_hud_init(&hud, screen.render.format) != RMP_HUD_OK) {
+      return EXIT_FAILURE;
+    }
+    screen.hud = &hud;
+  }
+
+  rmp_fb_t* fb = rmp_render_fb_get(&screen.render);
+  if (!fb) {
+    rmp_log_error("bench", "Screen is not on the framebuffer backend\n");
+    return EXIT_FAILURE;
+  }
+
+  // Simulated clock jumping from vblank to vblank, with the first vblank on the first sim step so
+  // every run steps and interpolates the same way
+  time_t now = app.next_step_us;
+  screen.next_frame_us = now;
+  screen.swapchain.next_vblank_us = now;
+  time_t total = 0;
+  time_t worst = 0;
+  for (int f = 0; f < frames; ++f) {
+    // The simulated clock runs ahead of any writer, wait for room so every frame is captured. The
+    // screen itself never waits, it would drop the frame
+    while (capture_path && rmp_capture_pending(&capture) >= RMP_CONFIG_CAPTURE_SLOTS) {
+      usleep(100);
+    }
+
+    rmp_app_tick(&app, now);
+
+    time_t start = rmp_time_get_us();
+    time_t next = rmp_screen_step(&screen, now);
+    time_t duration = rmp_time_get_us() - start;
+
+    total += duration;
+    if (duration > worst) {
+      worst = duration;
+    }
+    now = next;
+  }
+
+  if (capture_path) {
+    rmp_capture_free(&capture);
+  }
+
+  // The buffer presented last, the swapchain moves on every frame
+  fb = rmp_render_fb_get(&screen.render);
+  uint64_t hash = rmp_fb_hash(fb);
+  double avg = frames > 0 ? (double)total / frames : 0;
+  printf("%dx%d drawn at %dx%d in %s, %d frames, %d balls, %s spans\n", fb->width, fb->height,
+         screen.render.width, screen.render.height, rmp_fb_format_name(fb->format), frames, balls,
+         rmp_fb_simd_name());
+  printf("render : %.1f us/frame avg, %ld us max, %.1f%% of a %d Hz frame\n", avg, (long)worst,
+         avg / screen.swapchain.period_us * 100, screen.render.refresh_hz);
+  printf("pixels : %llu avg, %lu max per frame, %lu of %lu frames rendered\n",
+         screen.stats.frames ? screen.stats.pixels_total / screen.stats.frames : 0,
+         screen.stats.pixels_max, screen.stats.rendered, screen.stats.frames);
+  // What the draw wrote, scaling up to the window on present comes on top
+  int pixel_bytes = rmp_fb_bytes_per_pixel(fb->format);
+  printf("bytes  : %llu avg, %lu max written per frame\n",
+         screen.stats.frames ? screen.stats.pixels_total * pixel_bytes / screen.stats.frames : 0,
+         screen.stats.pixels_max * pixel_bytes);
+  printf("cmds   : %llu pushed, %llu submitted per rendered frame\n",
+         screen.stats.rendered ? screen.commands.stats.pushed / screen.stats.rendered : 0,
+         screen.stats.rendered ? screen.commands.stats.submitted / screen.stats.rendered : 0);
+  const rmp_raster_stats_t* raster = rmp_render_fb_raster_stats(&screen.render);
+  if (raster) {
+    printf("raster : %d threads, %lu frames tiled, %lu on one thread, %llu tiles per tiled frame\n",
+           render_threads, raster->parallel_frames, raster->single_frames,
+           raster->parallel_frames ? raster->tiles / raster->parallel_frames : 0);
+  }
+  printf("swap   : %lu presented, %lu dropped, %lu late\n", screen.swapchain.stats.presented,
+         screen.swapchain.stats.dropped, screen.swapchain.stats.late);
+  if (capture_path) {
+    printf("capture: %lu captured, %lu dropped, %llu bytes\n", capture.stats.captured,
+           capture.stats.dropped, capture.stats.bytes);
+  }
+  if (show_hud) {
+    printf("hud    : \"%s\", %lu updates, %.1f us/update\n", hud.text, hud.stats.updates,
+           hud.stats.updates ? hud.stats.update_total_us / (double)hud.stats.updates : 0.0);
+  }
+  printf("hash   : %016" PRIx64 "\n", hash);
+
+  if (ppm_path) {
+    rmp_fb_write_ppm(fb, ppm_path);
+  }
+
+  int status = EXIT_SUCCESS;
+  if (expected && strtoull(expected, NULL, 16) != hash) {
+    rmp_log_error("bench", "Frame hash mismatch, expected %s\n", expected);
+    status = EXIT_FAILURE;
+  }
+
+  rmp_screen_free(&screen);
+  if (show_hud) {
+    rmp_hud_free(&hud);
+  }
+  rmp_app_free(&app);
+  return status;
+}
@@ -0,0 +1,568 @@
+#include "rmp_app.h"
+#include "rmp_batch.h"
+#include "rmp_time.h"
+#include "rmp_log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <float.h>
+#include <math.h>
+#include <unistd.h>
+
+// Straight moves per step of the reference the swept ball is checked against
+#define BENCH_SIM_SUBSTEPS 1000
+// Bounces within one substep before the reference gives up on it
+#define BENCH_SIM_MAX_MIRRORS 100000
+
+static void usage(const char* prog) {
+  fprintf(stderr, "Usage: %s [-s seed] [-m matches] [-n steps] [-t max_threads]\n"
+          "          [-v max serve speed] [-o opponent speed]\n", prog);
+  fprintf(stderr, "       %s -b [-s seed] [-n steps]\n", prog);
+  fprintf(stderr, "       %s -p [-s seed] [-n hundreds of flights]\n", prog);
+  fprintf(stderr, "       %s -c [-s seed] [-n steps]\n", prog);
+}
+
+// A ball flight for the intercept check, everything predict_intercept reads
+typedef struct {
+  float field_height;
+  float ball_x;
+  float ball_y;
+  float vel_x;
+  float vel_y;
+} bench_flight_t;
+
+static uint32_t next_state(uint32_t* state) {
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+static float random_range(uint32_t* state, float lo, float hi) {
+  return lo + (next_state(state) % 1000001) / 1000000.0f * (hi - lo);
+}
+
+static void load_flight(rmp_app_t* app, const bench_flight_t* flight) {
+  rmp_vec2_set(&app->SCREEN_END, app->SCREEN_END.x, app->SCREEN_START.y + flight->field_height);
+  rmp_vec2_set(&app->ball.pos, flight->ball_x, flight->ball_y);
+  rmp_vec2_set(&app->ball.vel, flight->vel_x, flight->vel_y);
+}
+
+// The intercept as it was computed before the closed form, one reflection per pass. Counts the
+// reflections and keeps the unfolded height, every reflection rounds at the scale of it
+static float fold_loop_intercept(const rmp_app_t* app, int* reflections, float* unfolded) {
+  *reflections = 0;
+  *unfolded = 0;
+  if (app->ball.vel.x <= 0) {
+    return app->ball.pos.y + app->ball.size.y / 2.0f;
+  }
+
+  float dx = app->pad_b.pos.x - (app->ball.pos.x + app->ball.size.x);
+  float time_to_reach = dx / app->ball.vel.x;
+
+  float predicted_y = app->ball.pos.y + app->ball.vel.y * time_to_reach;
+  float ball_center_y = predicted_y + app->ball.size.y / 2.0f;
+
+  float field_height = SCREEN_HEIGHT_P(app);
+  *unfolded = ball_center_y;
+
+  while (ball_center_y < 0 || ball_center_y > field_height) {
+    if (ball_center_y < 0) {
+      ball_center_y = -ball_center_y;
+    }
+    else if (ball_center_y > field_height) {
+      ball_center_y = 2 * field_height - ball_center_y;
+    }
+    ++*reflections;
+  }
+
+  return ball_center_y;
+}
+
+static int bench_multiball(uint32_t seed, int steps) {
+  const int counts[] = {100, 1000, 10000};
+  const double budget_us = 1000000.0 / 30;
+
+  printf("seed %" PRIu32 ", %d steps per ball count\n", seed, steps);
+  printf("\nballs    avg us/step    max us/step    30 Hz budget\n");
+
+  for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); ++c) {
+    rmp_app_t app;
+    rmp_app_init(&app);
+    rmp_app_seed(&app, seed);
+    app.paused = false;
+
+    if (rmp_app_spawn_balls(&app, counts[c]) != RMP_APP_OK) {
+      rmp_app_free(&app);
+      return EXIT_FAILURE;
+    }
+
+    time_t total = 0;
+    time_t worst = 0;
+    for (int s = 0; s < steps; ++s) {
+      time_t start = rmp_time_get_us();
+      rmp_app_step(&app);
+      time_t duration = rmp_time_get_us() - start;
+
+      total += duration;
+      if (duration > worst) {
+        worst = duration;
+      }
+    }
+
+    double avg = steps > 0 ? (double)total / steps : 0;
+    printf("%-8d %-14.1f %-14ld %.1f%%\n", counts[c], avg, (long)worst, avg / budget_us * 100);
+
+    rmp_app_free(&app);
+  }
+
+  return EXIT_SUCCESS;
+}
+
+// Random flights in fields of random height, with the ball anywhere in the field moving right.
+// Both ways must agree to within the rounding of the loop's reflections, and the closed form must
+// match the same fold done in double. Then each is timed over the same flights. Returns the number
+// of flights that fail
+static int check_flights(rmp_app_t* app, bench_flight_t* flights, int count, uint32_t* state,
+                         const char* name, float min_vel_x, float max_vel_x) {
+  for (int i = 0; i < count; ++i) {
+    bench_flight_t* flight = &flights[i];
+    flight->field_height = random_range(state, 100, 2000);
+    flight->ball_x = random_range(state, app->SCREEN_START.x, app->pad_b.pos.x - app->ball.size.x);
+    flight->ball_y = random_range(state, 0, flight->field_height - app->ball.size.y);
+    flight->vel_x = random_range(state, min_vel_x, max_vel_x);
+    flight->vel_y = random_range(state, -24, 24);
+  }
+
+  int mismatches = 0;
+  long reflections_total = 0;
+  float error_max = 0;
+  for (int i = 0; i < count; ++i) {
+    load_flight(app, &flights[i]);
+
+    int reflections;
+    float unfolded;
+    float expected = fold_loop_intercept(app, &reflections, &unfolded);
+    float actual;
+    rmp_app_predict_intercept(app, &actual);
+
+    float period = 2 * flights[i].field_height;
+    float scale = fmaxf(fabsf(unfolded), period);
+    float error = fabsf(actual - expected);
+    reflections_total += reflections;
+    if (error > error_max) {
+      error_max = error;
+    }
+
+    double exact = fmod(unfolded, period);
+    exact = exact < 0 ? exact + period : exact;
+    exact = exact > period / 2 ? period - exact : exact;
+
+    if (!(error <= (reflections + 1) * scale * FLT_EPSILON) ||
+        !(fabs(actual - exact) <= 2 * period * FLT_EPSILON)) {
+      if (mismatches++ == 0) {
+        rmp_log_error("bench", "Flight %d: closed form %f, fold loop %f after %d reflections, "
+                      "exact %f\n", i, actual, expected, reflections, exact);
+      }
+    }
+  }
+
+  time_t start = rmp_time_get_us();
+  double loop_sum = 0;
+  for (int i = 0; i < count; ++i) {
+    load_flight(app, &flights[i]);
+    int reflections;
+    float unfolded;
+    loop_sum += fold_loop_intercept(app, &reflections, &unfolded);
+  }
+  time_t loop_us = rmp_time_get_us() - start;
+
+  start = rmp_time_get_us();
+  double closed_sum = 0;
+  for (int i = 0; i < count; ++i) {
+    load_flight(app, &flights[i]);
+    float intercept_y;
+    rmp_app_predict_intercept(app, &intercept_y);
+    closed_sum += intercept_y;
+  }
+  time_t closed_us = rmp_time_get_us() - start;
+
+  // The sums keep either loop from being optimized out, they agree up to the loop's rounding
+  printf("%-8s %-14.1f %-12.1f %-14.1f %-12d %-12g %.3g\n", name,
+         (double)reflections_total / count, loop_us * 1000.0 / count, closed_us * 1000.0 / count,
+         mismatches, error_max, fabs(loop_sum - closed_sum) / count);
+
+
+  return mismatches;
+}
+
+static int bench_predict(uint32_t seed, int count) {
+  bench_flight_t* flights = malloc(count * sizeof(*flights));
+  rmp_app_t* app = malloc(sizeof(*app));
+  if (!flights || !app || rmp_app_init(app) != RMP_APP_OK) {
+    return EXIT_FAILURE;
+  }
+
+  printf("seed %" PRIu32 ", %d flights per kind\n", seed, count);
+  printf("\nflights  reflections    loop ns/call closed ns/call mismatches   max diff px  "
+         "avg diff px\n");
+
+  // Game speeds, then slow and steep flights that bounce hundreds of times on the way
+  uint32_t state = seed ? seed : 1;
+  int mismatches = check_flights(app, flights, count, &state, "game", 0.5f, 24);
+  mismatches += check_flights(app, flights, count, &state, "long", 0.01f, 0.5f);
+
+  rmp_app_free(app);
+  free(app);
+  free(flights);
+  return mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// How far the ball is in past each side of the pad, it overlaps when all four are positive
+static bool overlap_depths(const rmp_app_entity_t* ball, const rmp_app_entity_t* pad,
+                           double depth[4]) {
+  depth[0] = ball->pos.x + ball->size.x - pad->pos.x;
+  depth[1] = pad->pos.x + pad->size.x - ball->pos.x;
+  depth[2] = ball->pos.y + ball->size.y - pad->pos.y;
+  depth[3] = pad->pos.y + pad->size.y - ball->pos.y;
+  return depth[0] > 0 && depth[1] > 0 && depth[2] > 0 && depth[3] > 0;
+}
+
+// A paddle that moved onto the ball pushes it out of the nearest side, over or under the pad only
+// where it fits against the wall, and sends it away from that side
+static void push_out(const rmp_app_t* app, rmp_app_entity_t* ball, const rmp_app_entity_t* pad) {
+  double depth[4];
+  if (!overlap_depths(ball, pad, depth)) {
+    return;
+  }
+
+  double push_x = depth[0] < depth[1] ? -depth[0] : depth[1];
+  double push_y = depth[2] < depth[3] ? -depth[2] : depth[3];
+  double y = ball->pos.y + push_y;
+  if (fabs(push_y) < fabs(push_x) && y >= app->SCREEN_START.y &&
+      y + ball->size.y <= app->SCREEN_END.y) {
+    ball->pos.y = y;
+    ball->vel.y = copysign(ball->vel.y, push_y);
+  }
+  else {
+    ball->pos.x += push_x;
+    ball->vel.x = copysign(ball->vel.x, push_x);
+  }
+}
+
+// Bounces the ball off a pad it ran into during this substep, mirrored about the face it crossed.
+// Its path over the substep is checked, not only where it ended, so grazing a corner still counts
+static bool bounce_pad(rmp_app_entity_t* ball, rmp_vec2_t prev, const rmp_app_entity_t* pad) {
+  double from[2] = {prev.x, prev.y};
+  double move[2] = {ball->pos.x - prev.x, ball->pos.y - prev.y};
+  double lo[2] = {pad->pos.x - ball->size.x, pad->pos.y - ball->size.y};
+  double hi[2] = {pad->pos.x + pad->size.x, pad->pos.y + pad->size.y};
+  double entry[2];
+  double exit[2];
+  for (int axis = 0; axis < 2; ++axis) {
+    if (move[axis] == 0) {
+      if (from[axis] <= lo[axis] || from[axis] >= hi[axis]) {
+        return false;
+      }
+      entry[axis] = -INFINITY;
+      exit[axis] = INFINITY;
+      continue;
+    }
+    double t_lo = (lo[axis] - from[axis]) / move[axis];
+    double t_hi = (hi[axis] - from[axis]) / move[axis];
+    entry[axis] = fmin(t_lo, t_hi);
+    exit[axis] = fmax(t_lo, t_hi);
+  }
+
+  double t_entry = fmax(entry[0], entry[1]);
+  if (t_entry < 0 || t_entry > 1 || t_entry >= fmin(exit[0], exit[1])) {
+    return false;
+  }
+
+  double depth[4];
+  overlap_depths(ball, pad, depth);
+  if (entry[0] > entry[1]) {
+    ball->pos.x -= copysign(2 * (ball->vel.x > 0 ? depth[0] : depth[1]), ball->vel.x);
+    ball->vel.x = -ball->vel.x;
+  }
+  else {
+    ball->pos.y -= copysign(2 * (ball->vel.y > 0 ? depth[2] : depth[3]), ball->vel.y);
+    ball->vel.y = -ball->vel.y;
+  }
+
+  return true;
+}
+
+// Mirrors the ball back inside off the wall it went past, if any
+static bool bounce_walls(rmp_app_entity_t* ball, double top, double bottom) {
+  if (ball->pos.y < top) {
+    ball->pos.y = 2 * top - ball->pos.y;
+    ball->vel.y = fabs(ball->vel.y);
+    return true;
+  }
+  if (ball->pos.y > bottom) {
+    ball->pos.y = 2 * bottom - ball->pos.y;
+    ball->vel.y = -fabs(ball->vel.y);
+    return true;
+  }
+  return false;
+}
+
+// The ball over one step in BENCH_SIM_SUBSTEPS straight moves, against the pads where the step
+// left them. Whatever it ends up in after a move turns it around, mirrored about the wall or face
+static void substep_ball(const rmp_app_t* app, rmp_app_entity_t* ball) {
+  push_out(app, ball, &app->pad_a);
+  push_out(app, ball, &app->pad_b);
+
+  double top = app->SCREEN_START.y;
+  double bottom = app->SCREEN_END.y - ball->size.y;
+  for (int i = 0; i < BENCH_SIM_SUBSTEPS; ++i) {
+    rmp_vec2_t prev = ball->pos;
+    ball->pos.x += ball->vel.x / BENCH_SIM_SUBSTEPS;
+    ball->pos.y += ball->vel.y / BENCH_SIM_SUBSTEPS;
+
+    // A fast ball can cross a narrow gap several times in a substep, mirror until it is clear
+    bool bounced = true;
+    for (int n = 0; n < BENCH_SIM_MAX_MIRRORS && bounced; ++n) {
+      bounced = bounce_walls(ball, top, bottom);
+      bounced = bounce_pad(ball, prev, &app->pad_a) || bounced;
+      bounced = bounce_pad(ball, prev, &app->pad_b) || bounced;
+    }
+  }
+}
+
+// Random steps with the ball anywhere, half of them next to a paddle, and paddles still or moving.
+// The ball moves at up to three times the game's speed, or in a quarter of the steps up and down
+// at 8 to 10 times the field height. The swept step must land where the substepped one does, up to
+// a substep, and with the same velocity. Steps that score are left out
+static int check_sweep(uint32_t seed, int count) {
+  rmp_app_t* app = malloc(sizeof(*app));
+  if (!app || rmp_app_init(app) != RMP_APP_OK) {
+    return EXIT_FAILURE;
+  }
+  app->paused = false;
+  app->ai_is_playing = false;
+
+  const rmp_app_entity_t* pads[2] = {&app->pad_a, &app->pad_b};
+  double field_top = app->SCREEN_START.y;
+  double field_bottom = app->SCREEN_END.y;
+  uint32_t state = seed ? seed : 1;
+  int checked = 0;
+  int scored = 0;
+  int fast = 0;
+  int mismatches = 0;
+  double error_max = 0;
+  time_t swept_us = 0;
+  time_t substep_us = 0;
+
+  for (int i = 0; i < count; ++i) {
+    for (int p = 0; p < 2; ++p) {
+      rmp_app_entity_t* pad = p ? &app->pad_b : &app->pad_a;
+      pad->pos.y = random_range(&state, field_top, field_bottom - pad->size.y);
+      pad->vel.y = app->pad_speed * ((int)(next_state(&state) % 3) - 1);
+    }
+
+    rmp_app_entity_t* ball = &app->ball;
+    const rmp_app_entity_t* near = pads[next_state(&state) % 2];
+    if (next_state(&state) % 2) {
+      ball->pos.x = random_range(&state, near->pos.x - 80, near->pos.x + 80);
+      ball->pos.y = random_range(&state, near->pos.y - 40, near->pos.y + near->size.y + 20);
+      ball->pos.y = fmax(field_top, fmin(ball->pos.y, field_bottom - ball->size.y));
+    }
+    else {
+      ball->pos.x = random_range(&state, app->SCREEN_START.x, app->SCREEN_END.x - ball->size.x);
+      ball->pos.y = random_range(&state, field_top, field_bottom - ball->size.y);
+    }
+    ball->vel.x = random_range(&state, -36, 36);
+    ball->vel.y = random_range(&state, -36, 36);
+    if (next_state(&state) % 4 == 0) {
+      double height = field_bottom - field_top;
+      ball->vel.y = copysign(random_range(&state, 8 * height, 10 * height), ball->vel.y);
+    }
+
+    rmp_app_entity_t start = *ball;
+    time_t start_us = rmp_time_get_us();
+    rmp_app_step(app);
+    swept_us += rmp_time_get_us() - start_us;
+
+    // The pads are where the step moved them, the substepped ball starts over from before it
+    rmp_app_entity_t expected = start;
+    start_us = rmp_time_get_us();
+    substep_ball(app, &expected);
+    substep_us += rmp_time_get_us() - start_us;
+
+    if (expected.pos.x < app->SCREEN_START.x ||
+        expected.pos.x + expected.size.x >= app->SCREEN_END.x) {
+      ++scored;
+      continue;
+    }
+    ++checked;
+    if (fabs(start.vel.y) > field_bottom - field_top) {
+      ++fast;
+    }
+
+    double error = fmax(fabs(ball->pos.x - expected.pos.x), fabs(ball->pos.y - expected.pos.y));
+    double tolerance = 2 * (fabs(start.vel.x) + fabs(start.vel.y)) / BENCH_SIM_SUBSTEPS + 1e-9;
+    if (error > error_max) {
+      error_max = error;
+    }
+    if (error > tolerance || ball->vel.x != expected.vel.x || ball->vel.y != expected.vel.y) {
+      if (mismatches++ == 0) {
+        rmp_log_error("bench", "Step %d from (%.3f, %.3f) moving (%.3f, %.3f): swept to "
+                      "(%.3f, %.3f) moving (%.3f, %.3f), substepped to (%.3f, %.3f) moving "
+                      "(%.3f, %.3f)\n", i, start.pos.x, start.pos.y, start.vel.x, start.vel.y,
+                      ball->pos.x, ball->pos.y, ball->vel.x, ball->vel.y, expected.pos.x,
+                      expected.pos.y, expected.vel.x, expected.vel.y);
+      }
+    }
+  }
+
+  printf("seed %" PRIu32 ", %d steps, %d substeps each\n", seed, count, BENCH_SIM_SUBSTEPS);
+  printf("checked    : %d, %d of them faster than the field, %d scored and left out\n", checked,
+         fast, scored);
+  printf("mismatches : %d, max difference %g px\n", mismatches, error_max);
+  printf("us/step    : %.3f swept, %.3f substepped\n", (double)swept_us / count,
+         (double)substep_us / count);
+
+  rmp_app_free(app);
+  free(app);
+  return mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int main(int argc, char** argv) {
+  uint32_t seed = 1;
+  int matches = 4096;
+  int steps = 10000;
+  int max_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  bool multiball = false;
+  bool predict = false;
+  bool sweep = false;
+  double serve_speed_max = 0;
+  double opponent_speed = -1;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "s:m:n:t:v:o:bpch")) != -1) {
+    switch (opt) {
+      case 's':
+        seed = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'm':
+        matches = atoi(optarg);
+        break;
+      case 'n':
+        steps = atoi(optarg);
+        break;
+      case 't':
+        max_threads = atoi(optarg);
+        break;
+      case 'v':
+        serve_speed_max = atof(optarg);
+        break;
+      case 'o':
+        opponent_speed = atof(optarg);
+        break;
+      case 'b':
+        multiball = true;
+        break;
+      case 'p':
+        predict = true;
+        break;
+      case 'c':
+        sweep = true;
+        break;
+      default:
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+  }
+
+  if (matches <= 0 || steps < 0 || max_threads <= 0) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  if (multiball) {
+    return bench_multiball(seed, steps);
+  }
+  if (predict) {
+    return bench_predict(seed, steps > 0 ? steps * 100 : 1);
+  }
+  if (sweep) {
+    return check_sweep(seed, steps > 0 ? steps : 1);
+  }
+
+  rmp_app_t config;
+  rmp_app_init(&config);
+  rmp_batch_params_t params;
+  rmp_batch_params_from_app(&params, &config);
+  rmp_app_free(&config);
+  if (serve_speed_max > 0) {
+    params.serve_speed_max = serve_speed_max;
+  }
+  if (opponent_speed >= 0) {
+    params.opponent_speed = opponent_speed;
+  }
+
+  printf("seed %" PRIu32 ", %d matches, %d steps\n", seed, matches, steps);
+  printf("serves %.0f to %.0f px/step, opponent at %.2f of pad speed\n", params.serve_speed_min,
+         params.serve_speed_max, params.opponent_speed);
+
+  // Same starting state for every thread count, the results must agree bit for bit
+  rmp_batch_result_t reference;
+  double base_rate = 0;
+  int threads = 1;
+  while (threads <= max_threads) {
+    rmp_batch_t batch;
+    if (rmp_batch_init(&batch, &params, matches, seed) != RMP_BATCH_OK) {
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+
+    time_t start = rmp_time_get_us();
+    rmp_batchRet_e ret = rmp_batch_run(&batch, steps, threads);
+    time_t duration = rmp_time_get_us() - start;
+    if (ret != RMP_BATCH_OK) {
+      rmp_batch_free(&batch);
+      return EXIT_FAILURE;
+    }
+
+    rmp_batch_result_t result;
+    rmp_batch_summarize(&batch, &result);
+    rmp_batch_free(&batch);
+
+    if (threads == 1) {
+      reference = result;
+      printf("score a %ld, score b %ld, checksum %016" PRIx64 "\n",
+             result.score_a, result.score_b, result.checksum);
+      printf("matches won by a %d, by b %d, drawn %d\n", result.wins_a, result.wins_b,
+             result.draws);
+      printf("\nthreads  steps/s        speedup\n");
+    }
+    else if (result.checksum != reference.checksum) {
+      rmp_log_error("bench", "Result with %d threads differs from the single thread run\n",
+                    threads);
+      return EXIT_FAILURE;
+    }
+
+    double rate = (double)matches * steps / (duration > 0 ? duration : 1) * 1e6;
+    if (threads == 1) {
+      base_rate = rate;
+    }
+    printf("%-8d %-14.0f %.2fx\n", threads, rate, rate / base_rate);
+
+    // Powers of two, always finishing on the full core count
+    if (threads < max_threads && threads * 2 > max_threads) {
+      threads = max_threads;
+    }
+    else {
+      threads *= 2;
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,77 @@
+#include "rmp_vec2.h"
+#include "rmp_time.h"
+#include "rmp_log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BENCH_COUNT (1 << 20)
+#define BENCH_ROUNDS 50
+
+int main(void) {
+  rmp_vec2_t* pos = malloc(BENCH_COUNT * sizeof(rmp_vec2_t));
+  rmp_vec2_t* vel = malloc(BENCH_COUNT * sizeof(rmp_vec2_t));
+  float* x = malloc(BENCH_COUNT * sizeof(float));
+  float* y = malloc(BENCH_COUNT * sizeof(float));
+  float* vx = malloc(BENCH_COUNT * sizeof(float));
+  float* vy = malloc(BENCH_COUNT * sizeof(float));
+
+  if (!pos || !vel || !x || !y || !vx || !vy) {
+    rmp_log_error("bench", "Failed to allocate %d vectors\n", BENCH_COUNT);
+    return EXIT_FAILURE;
+  }
+
+  for (int i = 0; i < BENCH_COUNT; ++i) {
+    rmp_vec2_set(&pos[i], i % 1920, i % 1080);
+    rmp_vec2_set(&vel[i], (i % 7) - 3, (i % 5) - 2);
+    x[i] = pos[i].x;
+    y[i] = pos[i].y;
+    vx[i] = vel[i].x;
+    vy[i] = vel[i].y;
+  }
+
+  rmp_vec2_t min, max;
+  rmp_vec2_set(&min, 50, 30);
+  rmp_vec2_set(&max, 1850, 1030);
+
+  // Per vector calls on rmp_vec2_t, the way the game uses the API
+  time_t start = rmp_time_get_us();
+  for (int r = 0; r < BENCH_ROUNDS; ++r) {
+    for (int i = 0; i < BENCH_COUNT; ++i) {
+      rmp_vec2_add(&pos[i], pos[i], vel[i]);
+      rmp_vec2_clamp(&pos[i], pos[i], min, max);
+    }
+  }
+  time_t single_us = rmp_time_get_us() - start;
+
+  start = rmp_time_get_us();
+  for (int r = 0; r < BENCH_ROUNDS; ++r) {
+    rmp_vec2_add_n(x, y, x, y, vx, vy, BENCH_COUNT);
+    rmp_vec2_clamp_n(x, y, x, y, min, max, BENCH_COUNT);
+  }
+  time_t batch_us = rmp_time_get_us() - start;
+
+  // Both paths must land on the same positions
+  int mismatches = 0;
+  for (int i = 0; i < BENCH_COUNT; ++i) {
+    if ((float)pos[i].x != x[i] || (float)pos[i].y != y[i]) {
+      ++mismatches;
+    }
+  }
+
+  double elements = (double)BENCH_COUNT * BENCH_ROUNDS;
+  printf("%d vectors x %d rounds of add + clamp, batch kernels use %s\n",
+         BENCH_COUNT, BENCH_ROUNDS, rmp_vec2_simd_name());
+  printf("single : %.3f ns/vector\n", single_us * 1000.0 / elements);
+  printf("batch  : %.3f ns/vector (%.2fx)\n", batch_us * 1000.0 / elements,
+         (double)single_us / (batch_us > 0 ? batch_us : 1));
+  printf("mismatches: %d\n", mismatches);
+
+  free(pos);
+  free(vel);
+  free(x);
+  free(y);
+  free(vx);
+  free(vy);
+  return mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+}
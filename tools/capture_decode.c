@@ -0,0 +1,93 @@
+#include "rmp_fb.h"
+#include "rmp_log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <unistd.h>
+
+static void usage(const char* prog) {
+  fprintf(stderr, "Usage: %s [-o frames/%%06lu.ppm] [-x expected_hash] capture.rmpd\n", prog);
+}
+
+int main(int argc, char** argv) {
+  const char* ppm_pattern = NULL;
+  const char* expected = NULL;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "o:x:h")) != -1) {
+    switch (opt) {
+      case 'o':
+        ppm_pattern = optarg;
+        break;
+      case 'x':
+        expected = optarg;
+        break;
+      default:
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+  }
+
+  if (optind != argc - 1) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  FILE* file = fopen(argv[optind], "rb");
+  if (!file) {
+    rmp_log_error("decode", "Failed to open %s\n", argv[optind]);
+    return EXIT_FAILURE;
+  }
+
+  uint32_t header[3];
+  rmp_fb_t fb;
+  if (fread(header, sizeof(header), 1, file) != 1 || header[0] != 0x444d5052 ||
+      rmp_fb_init(&fb, (int)header[1], (int)header[2], RMP_FB_RGBA8888) != RMP_FB_OK) {
+    rmp_log_error("decode", "%s is not a delta capture\n", argv[optind]);
+    fclose(file);
+    return EXIT_FAILURE;
+  }
+
+  // Every frame is the spans that changed against the one before, starting from zeroed pixels
+  unsigned long frames = 0;
+  uint32_t frame[2];
+  int status = EXIT_SUCCESS;
+  while (fread(frame, sizeof(frame), 1, file) == 1) {
+    for (uint32_t s = 0; s < frame[1]; ++s) {
+      uint32_t span[3];
+      if (fread(span, sizeof(span), 1, file) != 1 || span[1] >= (uint32_t)fb.height ||
+          span[0] + span[2] > (uint32_t)fb.width ||
+          fread((uint32_t*)fb.pixels + (size_t)span[1] * fb.stride + span[0], sizeof(uint32_t),
+                span[2], file) != span[2]) {
+        rmp_log_error("decode", "Truncated frame %" PRIu32 "\n", frame[0]);
+        status = EXIT_FAILURE;
+        break;
+      }
+    }
+    if (status != EXIT_SUCCESS) {
+      break;
+    }
+
+    if (ppm_pattern) {
+      char name[512];
+      snprintf(name, sizeof(name), ppm_pattern, (unsigned long)frame[0]);
+      rmp_fb_write_ppm(&fb, name);
+    }
+    ++frames;
+  }
+  fclose(file);
+
+  uint64_t hash = rmp_fb_hash(&fb);
+  printf("%dx%d, %lu frames\n", fb.width, fb.height, frames);
+  printf("hash   : %016" PRIx64 "\n", hash);
+
+  if (expected && strtoull(expected, NULL, 16) != hash) {
+    rmp_log_error("decode", "Frame hash mismatch, expected %s\n", expected);
+    status = EXIT_FAILURE;
+  }
+
+  rmp_fb_free(&fb);
+  return status;
+}
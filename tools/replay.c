@@ -0,0 +1,66 @@
+#include "rmp_app.h"
+#include "rmp_record.h"
+#include "rmp_time.h"
+#include "rmp_log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <unistd.h>
+
+static void usage(const char* prog) {
+  fprintf(stderr, "Usage: %s [-x expected_hash] recording\n", prog);
+}
+
+int main(int argc, char** argv) {
+  const char* expected = NULL;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "x:h")) != -1) {
+    switch (opt) {
+      case 'x':
+        expected = optarg;
+        break;
+      default:
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+  }
+
+  if (optind != argc - 1) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  rmp_app_t app;
+  rmp_app_init(&app);
+
+  rmp_record_stats_t stats;
+  time_t start = rmp_time_get_us();
+  rmp_recordRet_e ret = rmp_record_replay(&app, argv[optind], &stats);
+  time_t duration = rmp_time_get_us() - start;
+
+  if (ret != RMP_RECORD_OK) {
+    rmp_app_free(&app);
+    return EXIT_FAILURE;
+  }
+
+  uint64_t hash = rmp_app_hash_state(&app);
+
+  printf("events  : %lu\n", stats.events);
+  printf("ticks   : %lu in %ld us (%.0f ticks/s)\n", stats.ticks, (long)duration,
+         (double)stats.ticks / (duration > 0 ? duration : 1) * 1e6);
+  printf("score   : %d - %d\n", app.score_a, app.score_b);
+  printf("ball    : %a %a\n", app.ball.pos.x, app.ball.pos.y);
+  printf("state   : %016" PRIx64 "\n", hash);
+
+  rmp_app_free(&app);
+
+  if (expected && strtoull(expected, NULL, 16) != hash) {
+    rmp_log_error("replay", "Final state differs from %s\n", expected);
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
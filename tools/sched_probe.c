@@ -0,0 +1,99 @@
+#include "rmp_sched.h"
+#include "rmp_time.h"
+#include "rmp_log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <unistd.h>
+
+// Stand-in for one component thread: wakes on the component's period and burns its usual work
+typedef struct {
+  time_t period_us;
+  time_t work_us;
+  rmp_sched_probe_t probe;
+} probe_thread_t;
+
+static atomic_bool running = true;
+
+static void usage(const char* prog) {
+  fprintf(stderr, "Usage: %s [-P none|fifo|rr] [-d seconds]\n", prog);
+}
+
+static void* probe_run(void* args) {
+  probe_thread_t* thread = (probe_thread_t*)args;
+
+  time_t deadline = rmp_time_get_us();
+  while (atomic_load(&running)) {
+    time_t now = rmp_time_get_us();
+    rmp_sched_probe_record(&thread->probe, deadline, now);
+
+    while (rmp_time_get_us() - now < thread->work_us) {
+    }
+
+    deadline += thread->period_us;
+    if (deadline < now) {
+      deadline = now + thread->period_us;
+    }
+    rmp_time_sleep_until_us(deadline);
+  }
+
+  return NULL;
+}
+
+int main(int argc, char** argv) {
+  const char* policy = NULL;
+  int seconds = 10;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "P:d:h")) != -1) {
+    switch (opt) {
+      case 'P':
+        policy = optarg;
+        break;
+      case 'd':
+        seconds = atoi(optarg);
+        break;
+      default:
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+  }
+
+  rmp_sched_profile_t profile;
+  if (rmp_sched_profile_init(&profile, policy) != RMP_SCHED_OK || seconds <= 0) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  // Periods match the 30 Hz app step, 10 ms keypad row settle and 120 Hz screen
+  probe_thread_t threads[3] = {
+    {1000000 / 30, 500, {0}},
+    {10000, 20, {0}},
+    {1000000 / 120, 2000, {0}},
+  };
+  const rmp_sched_thread_t* sched[3] = {&profile.app, &profile.keypad, &profile.screen};
+  pthread_t tids[3];
+
+  for (int i = 0; i < 3; ++i) {
+    if (rmp_sched_spawn(&tids[i], profile.policy, sched[i], probe_run, &threads[i]) !=
+        RMP_SCHED_OK) {
+      rmp_log_error("probe", "Failed to create %s thread\n", sched[i]->name);
+      return EXIT_FAILURE;
+    }
+  }
+
+  sleep(seconds);
+  atomic_store(&running, false);
+
+  for (int i = 0; i < 3; ++i) {
+    pthread_join(tids[i], NULL);
+  }
+
+  for (int i = 0; i < 3; ++i) {
+    rmp_sched_probe_log(sched[i]->name, &threads[i].probe);
+  }
+
+  return EXIT_SUCCESS;
+}
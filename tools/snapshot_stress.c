@@ -0,0 +1,226 @@
+#include "rmp_app.h"
+#include "rmp_time.h"
+#include "rmp_log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#define SNAPSHOT_STRESS_MAX_READERS 16
+// Keeps every value a float holds exactly
+#define SNAPSHOT_STRESS_WRAP (1 << 20)
+
+typedef struct {
+  rmp_app_t* app;
+  bool unguarded;
+  unsigned long reads;
+  unsigned long torn;
+  unsigned long first_torn_k;
+} snapshot_stress_reader_t;
+
+static atomic_bool g_running;
+static atomic_ulong g_published;
+
+static void usage(const char* prog) {
+  fprintf(stderr, "Usage: %s [-d seconds] [-r readers] [-u]\n", prog);
+}
+
+static void set_entity(rmp_app_entity_t* entity, double k, double offset) {
+  rmp_vec2_set(&entity->pos, k + offset, -(k + offset));
+  rmp_vec2_set(&entity->vel, offset, k);
+  rmp_vec2_set(&entity->size, k, offset);
+}
+
+static bool check_entity(const rmp_app_entity_t* entity, double k, double offset) {
+  return entity->pos.x == k + offset && entity->pos.y == -(k + offset) &&
+         entity->vel.x == offset && entity->vel.y == k &&
+         entity->size.x == k && entity->size.y == offset;
+}
+
+// Every published field is derived from one counter k, so a copy mixing two publishes shows up
+static void write_state(rmp_app_t* app, unsigned long k) {
+  double kd = (double)k;
+  app->step_time_us = (time_t)k;
+  app->paused = k & 1;
+  app->recalibrating = k & 2;
+  app->ai_is_playing = k & 4;
+  rmp_vec2_set(&app->SCREEN_START, kd, kd + 1);
+  rmp_vec2_set(&app->SCREEN_END, kd + 2, kd + 3);
+  set_entity(&app->pad_a, kd, 10);
+  set_entity(&app->pad_b, kd, 20);
+  set_entity(&app->ball, kd, 30);
+  set_entity(&app->prev_pad_a, kd, 40);
+  set_entity(&app->prev_pad_b, kd, 50);
+  set_entity(&app->prev_ball, kd, 60);
+
+  app->balls.count = (int)(k % (RMP_APP_SNAPSHOT_MAX_BALLS + 1));
+  app->balls.size = (float)k;
+  for (int i = 0; i < app->balls.count; ++i) {
+    app->balls.x[i] = (float)(k + i);
+    app->balls.y[i] = -(float)(k + i);
+  }
+}
+
+static bool check_snapshot(const rmp_app_snapshot_t* snapshot, unsigned long* k_out) {
+  unsigned long k = (unsigned long)snapshot->step_time_us;
+  double kd = (double)k;
+  *k_out = k;
+
+  if (snapshot->paused != (bool)(k & 1) || snapshot->recalibrating != (bool)(k & 2) ||
+      snapshot->ai_is_playing != (bool)(k & 4) ||
+      snapshot->SCREEN_START.x != kd || snapshot->SCREEN_START.y != kd + 1 ||
+      snapshot->SCREEN_END.x != kd + 2 || snapshot->SCREEN_END.y != kd + 3 ||
+      !check_entity(&snapshot->pad_a, kd, 10) || !check_entity(&snapshot->pad_b, kd, 20) ||
+      !check_entity(&snapshot->ball, kd, 30) || !check_entity(&snapshot->prev_pad_a, kd, 40) ||
+      !check_entity(&snapshot->prev_pad_b, kd, 50) || !check_entity(&snapshot->prev_ball, kd, 60) ||
+      snapshot->ball_count != (int)(k % (RMP_APP_SNAPSHOT_MAX_BALLS + 1)) ||
+      snapshot->ball_size != (float)k) {
+    return false;
+  }
+
+  for (int i = 0; i < snapshot->ball_count; ++i) {
+    if (snapshot->ball_x[i] != (float)(k + i) || snapshot->ball_y[i] != -(float)(k + i)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// Publishes through rmp_app_notify, the same seqlock write the sim thread does after a step
+static void* publish(void* args) {
+  rmp_app_t* app = (rmp_app_t*)args;
+
+  unsigned long k = 0;
+  while (atomic_load_explicit(&g_running, memory_order_relaxed)) {
+    k = (k + 1) % SNAPSHOT_STRESS_WRAP;
+    pthread_mutex_lock(&app->mutex);
+    write_state(app, k);
+    rmp_app_notify(app);
+    pthread_mutex_unlock(&app->mutex);
+    atomic_fetch_add_explicit(&g_published, 1, memory_order_relaxed);
+  }
+
+  return NULL;
+}
+
+static void* read_snapshots(void* args) {
+  snapshot_stress_reader_t* reader = (snapshot_stress_reader_t*)args;
+
+  // On the heap, a snapshot is too large to keep on every reader's stack comfortably
+  rmp_app_snapshot_t* snapshot = malloc(sizeof(*snapshot));
+  if (!snapshot) {
+    return NULL;
+  }
+
+  unsigned long generation = 0;
+  while (atomic_load_explicit(&g_running, memory_order_relaxed)) {
+    if (reader->unguarded) {
+      memcpy(snapshot, (const void*)&reader->app->snapshot, sizeof(*snapshot));
+    }
+    else {
+      rmp_app_read_snapshot(reader->app, snapshot);
+    }
+    reader->reads++;
+
+    // A generation going backwards is a stale copy passed off as a new one
+    unsigned long k;
+    if (!check_snapshot(snapshot, &k) || snapshot->generation < generation) {
+      if (reader->torn++ == 0) {
+        reader->first_torn_k = k;
+      }
+    }
+    generation = snapshot->generation;
+  }
+
+  free(snapshot);
+  return NULL;
+}
+
+int main(int argc, char** argv) {
+  int seconds = 5;
+  int readers = 2;
+  bool unguarded = false;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "d:r:uh")) != -1) {
+    switch (opt) {
+      case 'd':
+        seconds = atoi(optarg);
+        break;
+      case 'r':
+        readers = atoi(optarg);
+        break;
+      case 'u':
+        unguarded = true;
+        break;
+      default:
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+  }
+
+  if (seconds <= 0 || readers <= 0 || readers > SNAPSHOT_STRESS_MAX_READERS) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  rmp_app_t* app = malloc(sizeof(*app));
+  if (!app || rmp_app_init(app) != RMP_APP_OK ||
+      rmp_app_spawn_balls(app, RMP_APP_SNAPSHOT_MAX_BALLS) != RMP_APP_OK) {
+    return EXIT_FAILURE;
+  }
+
+  pthread_mutex_lock(&app->mutex);
+  write_state(app, 0);
+  rmp_app_notify(app);
+  pthread_mutex_unlock(&app->mutex);
+
+  atomic_store(&g_running, true);
+  atomic_store(&g_published, 0);
+
+  pthread_t publisher;
+  pthread_t reader_tids[SNAPSHOT_STRESS_MAX_READERS];
+  snapshot_stress_reader_t reader_state[SNAPSHOT_STRESS_MAX_READERS];
+  if (pthread_create(&publisher, NULL, publish, app) != 0) {
+    rmp_log_error("stress", "Failed to create publisher thread\n");
+    return EXIT_FAILURE;
+  }
+  for (int i = 0; i < readers; ++i) {
+    reader_state[i] = (snapshot_stress_reader_t){app, unguarded, 0, 0, 0};
+    if (pthread_create(&reader_tids[i], NULL, read_snapshots, &reader_state[i]) != 0) {
+      rmp_log_error("stress", "Failed to create reader thread\n");
+      return EXIT_FAILURE;
+    }
+  }
+
+  sleep(seconds);
+  atomic_store(&g_running, false);
+  pthread_join(publisher, NULL);
+
+  unsigned long reads = 0;
+  unsigned long torn = 0;
+  for (int i = 0; i < readers; ++i) {
+    pthread_join(reader_tids[i], NULL);
+    reads += reader_state[i].reads;
+    torn += reader_state[i].torn;
+    if (reader_state[i].torn) {
+      rmp_log_error("stress", "Reader %d saw its first torn snapshot around publish %lu\n", i,
+                    reader_state[i].first_torn_k);
+    }
+  }
+
+  printf("%d s, 1 publisher, %d %s readers\n", seconds, readers,
+         unguarded ? "unguarded" : "seqlock");
+  printf("published : %lu\n", atomic_load(&g_published));
+  printf("read      : %lu\n", reads);
+  printf("torn      : %lu\n", torn);
+
+  rmp_app_free(app);
+  free(app);
+  return torn == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}